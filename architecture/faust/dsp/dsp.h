@@ -172,6 +172,29 @@ class decorator_dsp : public dsp {
        
 };
 
+/**
+ * DSP computing several instances ('lanes') in lockstep, as generated with the '-lanes <n>' option.
+ * The audio channels of the lanes are concatenated : lane v uses the inputs [v*ins, (v+1)*ins)
+ * and the outputs [v*outs, (v+1)*outs), where ins and outs are the channels of one instance.
+ */
+
+class lanes_dsp : public dsp {
+
+    public:
+
+        /* Return the number of instances computed in lockstep */
+        virtual int getNumLanes() = 0;
+
+        /**
+         * Trigger the UI* parameter with the calls building the UI of one lane.
+         *
+         * @param ui_interface - the UI* user interface builder
+         * @param lane - the lane in [0, getNumLanes())
+         */
+        virtual void buildLaneUserInterface(UI* ui_interface, int lane) = 0;
+
+};
+
 /**
  * On Intel set FZ (Flush to Zero) and DAZ (Denormals Are Zero)
  * flags to avoid costly denormals.
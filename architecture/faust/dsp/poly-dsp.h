@@ -50,6 +50,25 @@
 #include "faust/gui/MapUI.h"
 #include "faust/dsp/proxy-dsp.h"
 
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1700))
+#define POLY_STD_ATOMIC
+#include <atomic>
+#endif
+
+#ifdef POLY_THREADS
+#include <pthread.h>
+#include <errno.h>
+#include <atomic>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#else
+#include <semaphore.h>
+#endif
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#endif
+
 #define kActiveVoice      0
 #define kFreeVoice        -1
 #define kReleaseVoice     -2
@@ -60,6 +79,31 @@
 
 #define FLOAT_MAX(a, b) (((a) < (b)) ? (b) : (a))
 
+/**
+ * Flag set by the control threads (MIDI, GUI...) with release semantics, and tested and cleared 
+ * by the audio thread with acquire semantics : a std::atomic<bool> in C++11, the GCC atomic builtins 
+ * otherwise, so that the header still compiles as C++98 without POLY_THREADS.
+ */
+struct voice_flag {
+
+#ifdef POLY_STD_ATOMIC
+    std::atomic<bool> fValue;
+    
+    voice_flag():fValue(false) {}
+    
+    void set() { fValue.store(true, std::memory_order_release); }
+    bool testAndClear() { return fValue.load(std::memory_order_acquire) && fValue.exchange(false, std::memory_order_acquire); }
+#else
+    bool fValue;
+    
+    voice_flag():fValue(false) {}
+    
+    void set() { __atomic_store_n(&fValue, true, __ATOMIC_RELEASE); }
+    bool testAndClear() { return __atomic_load_n(&fValue, __ATOMIC_ACQUIRE) && __atomic_exchange_n(&fValue, false, __ATOMIC_ACQUIRE); }
+#endif
+
+};
+
 // ends_with(<str>,<end>) : returns true if <str> ends with <end>
 static inline bool ends_with(std::string const& str, std::string const& end)
 {
@@ -175,7 +219,9 @@ struct dsp_voice : public MapUI, public decorator_dsp {
     int fNote;          // Playing note actual pitch
     int fDate;          // KeyOn date
     bool fTrigger;      // True if stolen note and need for envelop re-trigger
-    FAUSTFLOAT fLevel;  // Last audio block level
+    FAUSTFLOAT fLevel;  // Last audio block level, only computed in release
+    int fRelease;       // Number of samples computed since the release
+    voice_flag fQueued;     // Allocated, and not yet added to the active voices by the audio thread
 
     dsp_voice(dsp* dsp):decorator_dsp(dsp)
     {
@@ -184,6 +230,7 @@ struct dsp_voice : public MapUI, public decorator_dsp {
         fLevel = FAUSTFLOAT(0);
         fDate = 0;
         fTrigger = false;
+        fRelease = 0;
     }
     
     void extractLabels(std::string& gate, std::string& freq, std::string& gain)
@@ -221,8 +268,248 @@ struct dsp_voice : public MapUI, public decorator_dsp {
  
 };
 
+/**
+ * One lane of a lanes_dsp (see the '-lanes' compiler option) used as a voice : 
+ * all the lanes of a lanes_dsp are computed together by mydsp_poly.
+ * The whole lanes_dsp is initialized by its first lane.
+ */
+class lane_dsp : public dsp {
+
+    private:
+    
+        lanes_dsp* fLanes;
+        int fLane;
+    
+    public:
+    
+        lane_dsp(lanes_dsp* lanes, int lane):fLanes(lanes), fLane(lane) {}
+        virtual ~lane_dsp() {}
+    
+        virtual int getNumInputs() { return fLanes->getNumInputs() / fLanes->getNumLanes(); }
+        virtual int getNumOutputs() { return fLanes->getNumOutputs() / fLanes->getNumLanes(); }
+        virtual void buildUserInterface(UI* ui_interface) { fLanes->buildLaneUserInterface(ui_interface, fLane); }
+        virtual int getSampleRate() { return fLanes->getSampleRate(); }
+        virtual void init(int samplingRate) { if (fLane == 0) fLanes->init(samplingRate); }
+        virtual void instanceInit(int samplingRate) { if (fLane == 0) fLanes->instanceInit(samplingRate); }
+        virtual void instanceConstants(int samplingRate) { if (fLane == 0) fLanes->instanceConstants(samplingRate); }
+        virtual void instanceResetUserInterface() { if (fLane == 0) fLanes->instanceResetUserInterface(); }
+        virtual void instanceClear() { if (fLane == 0) fLanes->instanceClear(); }
+        virtual lane_dsp* clone() { return new lane_dsp(fLanes, fLane); }
+        virtual void metadata(Meta* m) { fLanes->metadata(m); }
+        // Computed by mydsp_poly with the other lanes
+        virtual void compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs) {}
+    
+};
+
+#ifdef POLY_THREADS
+
+/**
+ * Semaphore used to wake up a worker : posting it does not take any lock, 
+ * so it can be done by the audio thread.
+ */
+class voice_semaphore {
+
+    private:
+    
+    #ifdef __APPLE__
+        semaphore_t fSemaphore;
+    #else
+        sem_t fSemaphore;
+    #endif
+    
+    public:
+    
+    #ifdef __APPLE__
+        voice_semaphore() { semaphore_create(mach_task_self(), &fSemaphore, SYNC_POLICY_FIFO, 0); }
+        virtual ~voice_semaphore() { semaphore_destroy(mach_task_self(), fSemaphore); }
+        void post() { semaphore_signal(fSemaphore); }
+        void wait() { while (semaphore_wait(fSemaphore) != KERN_SUCCESS) {} }
+    #else
+        voice_semaphore() { sem_init(&fSemaphore, 0, 0); }
+        virtual ~voice_semaphore() { sem_destroy(&fSemaphore); }
+        void post() { sem_post(&fSemaphore); }
+        void wait() { while (sem_wait(&fSemaphore) != 0 && errno == EINTR) {} }
+    #endif
+    
+};
+
+/**
+ * Pool of worker threads used by mydsp_poly to compute the voices in parallel 
+ * (see mydsp_poly::setVoiceThreads). A task is split in parts : part 0 is computed
+ * by the calling thread and part k by the worker k-1, so that the assignment of the 
+ * parts to the threads is always the same.
+ * The calling thread (the audio thread) never takes a lock : it posts the semaphore 
+ * of each worker it needs, then spins until they are done. The workers run just below 
+ * the audio thread, with the scheduling policy of scheduler.cpp.
+ */
+class voice_workers {
+
+    private:
+    
+        typedef void (*task)(void* arg, int part);
+    
+        struct worker {
+            voice_workers* fPool;
+            int fPart;
+            pthread_t fThread;
+            voice_semaphore fStart;
+            bool fRealTime;     // Scheduling of the worker already set
+        };
+    
+        std::vector<worker*> fWorkers;
+    
+        task fTask;
+        void* fArg;
+        std::atomic<int> fPending;  // Workers still running the current task
+        bool fQuit;
+    
+        // Scheduling of the audio thread, known after the first run when the workers are not created by it
+        bool fRealTimeKnown;
+        int fPolicy;
+        struct sched_param fParam;
+    
+        static void* runWorker(void* arg)
+        {
+            worker* w = static_cast<worker*>(arg);
+            w->fPool->loop(w);
+            return 0;
+        }
+    
+        // The workers run just below the audio thread
+        void setRealTime(worker* w)
+        {
+            if (!w->fRealTime && fRealTimeKnown) {
+                w->fRealTime = true;
+                if (fPolicy == SCHED_FIFO || fPolicy == SCHED_RR) {
+                    struct sched_param param = fParam;
+                    param.sched_priority = std::max(param.sched_priority - 1, sched_get_priority_min(fPolicy));
+                    pthread_setschedparam(pthread_self(), fPolicy, &param);
+                }
+            }
+        }
+    
+        void loop(worker* w)
+        {
+            while (true) {
+                w->fStart.wait();
+                if (fQuit) break;
+                fTask(fArg, w->fPart);
+                fPending.fetch_sub(1, std::memory_order_acq_rel);
+                setRealTime(w);
+            }
+        }
+    
+        // A real time caller gives its priority minus one to the workers, otherwise they take the one of the audio thread after its first run
+        bool startWorker(worker* w)
+        {
+            pthread_attr_t attributes;
+            pthread_attr_init(&attributes);
+            pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_JOINABLE);
+            pthread_getschedparam(pthread_self(), &fPolicy, &fParam);
+            if (fPolicy == SCHED_FIFO || fPolicy == SCHED_RR) {
+                struct sched_param param = fParam;
+                param.sched_priority = std::max(param.sched_priority - 1, sched_get_priority_min(fPolicy));
+                pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+                pthread_attr_setschedpolicy(&attributes, fPolicy);
+                pthread_attr_setschedparam(&attributes, &param);
+                w->fRealTime = true;
+            }
+            int res = pthread_create(&w->fThread, &attributes, runWorker, w);
+            if (res != 0 && w->fRealTime) {
+                // Not allowed to use a real time scheduling : the workers stay with the default one
+                w->fRealTime = false;
+                pthread_attr_setinheritsched(&attributes, PTHREAD_INHERIT_SCHED);
+                res = pthread_create(&w->fThread, &attributes, runWorker, w);
+            }
+            pthread_attr_destroy(&attributes);
+            return res == 0;
+        }
+    
+        static inline void spin()
+        {
+        #if defined(__SSE__)
+            _mm_pause();
+        #elif defined(__aarch64__) || defined(__arm__)
+            __asm__ __volatile__("yield");
+        #endif
+        }
+    
+    public:
+    
+        voice_workers(int threads):fTask(0), fArg(0), fPending(0), fQuit(false), fRealTimeKnown(false), fPolicy(SCHED_OTHER)
+        {
+            for (int i = 0; i < threads; i++) {
+                worker* w = new worker();
+                w->fPool = this;
+                w->fPart = i + 1;
+                w->fRealTime = false;
+                if (startWorker(w)) {
+                    fWorkers.push_back(w);
+                } else {
+                    std::cerr << "voice_workers : cannot create worker thread\n";
+                    delete w;
+                    break;
+                }
+            }
+        }
+    
+        virtual ~voice_workers()
+        {
+            fQuit = true;
+            for (int i = 0; i < fWorkers.size(); i++) {
+                fWorkers[i]->fStart.post();
+            }
+            for (int i = 0; i < fWorkers.size(); i++) {
+                pthread_join(fWorkers[i]->fThread, 0);
+                delete fWorkers[i];
+            }
+        }
+    
+        // Number of parts that can be computed at the same time
+        int getNumParts() { return int(fWorkers.size()) + 1; }
+    
+        // Run fun(arg, part) for part in [0, parts[ and wait for the end of all the parts
+        void run(task fun, void* arg, int parts)
+        {
+            if (!fRealTimeKnown) {
+                pthread_getschedparam(pthread_self(), &fPolicy, &fParam);
+                fRealTimeKnown = true;
+            }
+            fTask = fun;
+            fArg = arg;
+            fPending.store(parts - 1, std::memory_order_release);
+            for (int i = 0; i < parts - 1; i++) {
+                fWorkers[i]->fStart.post();
+            }
+        
+            fun(arg, 0);
+        
+            while (fPending.load(std::memory_order_acquire) > 0) {
+                spin();
+            }
+        }
+    
+};
+
+#endif
+
+/**
+ * Voice allocation counters of the last compute cycle (see mydsp_poly::getVoiceCounters).
+ */
+struct voice_counters {
+    
+    int fActive;        // Voices computed
+    int fStolen;        // Voices stolen by the notes received since the previous cycle
+    int fFreed;         // Voices freed, decayed or after the release timeout
+    
+    voice_counters():fActive(0), fStolen(0), fFreed(0) {}
+};
+
 /**
  * Polyphonic DSP : group a set of DSP to be played together or triggered by MIDI.
+ * When the DSP is a lanes_dsp, the voices are the lanes of groups of voices computed in lockstep.
+ * The free voices of a group are computed with the playing ones, so a new voice starts from
+ * the state reached by its lane, and not from the state it had when it was released.
  */
 
 class mydsp_poly : public dsp, public midi {
@@ -247,10 +534,41 @@ class mydsp_poly : public dsp, public midi {
         FAUSTFLOAT** fMixBuffer;
         int fNumOutputs;
         int fDate;
+    
+        std::vector<lanes_dsp*> fLaneGroups; // Groups of voices computed in lockstep, when the DSP is a lanes_dsp
+        FAUSTFLOAT** fLaneBuffer;            // Outputs of all the lanes of a group
+        int fNumLanes;
         
         std::vector<MidiUI*> fMidiUIList;
+    
+        std::vector<int> fActiveList;        // Voices not free, in the voice order, the only ones computed in controlled mode (audio thread only)
+        int fNumActive;                      // Voices in fActiveList, allocated once for fPolyphony voices
+        double fReleaseTimeout;              // Maximum release duration in seconds, 0 to wait for the voice to decay
+        voice_counters fCounters;            // Counters of the last cycle
+        int fStolen;                         // Voices stolen since the last cycle
+        int fFreed;                          // Voices freed in the current cycle
+    
+    #ifdef POLY_THREADS
+        voice_workers* fWorkers;             // Threads computing the voices, when setVoiceThreads has been used
+        FAUSTFLOAT*** fVoiceBuffer;          // Outputs of each voice, mixed in the voice order after the parallel computation
+        int fCount;
+        FAUSTFLOAT** fInputs;
+        int fParts;
+    #endif
         
-        inline FAUSTFLOAT mixVoice(int count, FAUSTFLOAT** outputBuffer, FAUSTFLOAT** mixBuffer) 
+        inline void mixVoice(int count, FAUSTFLOAT** outputBuffer, FAUSTFLOAT** mixBuffer) 
+        {
+            for (int i = 0; i < fNumOutputs; i++) {
+                FAUSTFLOAT* mixChannel = mixBuffer[i];
+                FAUSTFLOAT* outChannel = outputBuffer[i];
+                for (int j = 0; j < count; j++) {
+                    mixChannel[j] += outChannel[j];
+                }
+            }
+        }
+    
+        // Mix a voice and compute its level in the same loop
+        inline FAUSTFLOAT mixVoiceLevel(int count, FAUSTFLOAT** outputBuffer, FAUSTFLOAT** mixBuffer) 
         {
             FAUSTFLOAT level = 0;
             for (int i = 0; i < fNumOutputs; i++) {
@@ -264,15 +582,222 @@ class mydsp_poly : public dsp, public midi {
             return level;
         }
         
+        /**
+         * Mix a voice in controlled mode. The level of a voice in release is computed with the mix, 
+         * and the voice is freed once decayed or after the release timeout.
+         */
+        inline void mixPlayingVoice(int voice, int count, FAUSTFLOAT** outputBuffer, FAUSTFLOAT** mixBuffer)
+        {
+            dsp_voice* v = fVoiceTable[voice];
+            if (v->fNote == kReleaseVoice) {
+                v->fLevel = mixVoiceLevel(count, outputBuffer, mixBuffer);
+                v->fRelease += count;
+                if ((v->fLevel < VOICE_STOP_LEVEL)
+                    || ((fReleaseTimeout > 0) && (v->fRelease >= fReleaseTimeout * v->getSampleRate()))) {
+                    freeVoice(voice);
+                }
+            } else {
+                mixVoice(count, outputBuffer, mixBuffer);
+            }
+        }
+    
+        /**
+         * Called by the control threads once the voice is set up. Each voice has its own flag, so that
+         * the MIDI thread (keyOn) and the GUI thread (newVoice) can both hand voices to the audio thread.
+         * The voice search itself (getVoice) is not thread safe : keyOn and newVoice calls made from 
+         * different threads still have to be serialized by the host.
+         */
+        inline void activateVoice(int voice)
+        {
+            fVoiceTable[voice]->fQueued.set();
+        }
+    
+        // Called by the audio thread at the beginning of each cycle : the flagged voices are added in the voice order
+        inline void updateActiveList()
+        {
+            for (int voice = 0; voice < fPolyphony; voice++) {
+                if (fVoiceTable[voice]->fQueued.testAndClear()) {
+                    int* first = &fActiveList[0];
+                    int* it = std::lower_bound(first, first + fNumActive, voice);
+                    if (it == first + fNumActive || *it != voice) {
+                        std::copy_backward(it, first + fNumActive, first + fNumActive + 1);
+                        *it = voice;
+                        fNumActive++;
+                    }
+                }
+            }
+        }
+    
+        inline void freeVoice(int voice)
+        {
+            int* first = &fActiveList[0];
+            int* it = std::lower_bound(first, first + fNumActive, voice);
+            if (it != first + fNumActive && *it == voice) {
+                std::copy(it + 1, first + fNumActive, it);
+                fNumActive--;
+            }
+            fVoiceTable[voice]->fNote = kFreeVoice;
+            fFreed++;
+        }
+    
+        inline void releaseVoice(dsp_voice* voice)
+        {
+            voice->setParamValue(fGateLabel, 0.0f);
+            voice->fNote = kReleaseVoice;
+            voice->fRelease = 0;
+        }
+    
+        // Compute a voice, with a re-trigger of the envelop for a new note
+        inline void computeVoice(dsp_voice* voice, int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs)
+        {
+            if (voice->fTrigger) {
+                voice->fTrigger = false;
+                voice->setParamValue(fGateLabel, 0.0f);
+                voice->computeSlice(0, 1, inputs, outputs);
+                voice->setParamValue(fGateLabel, 1.0f);
+                voice->computeSlice(1, count - 1, inputs, outputs);
+            } else {
+                voice->compute(count, inputs, outputs);
+            }
+        }
+    
+    #ifdef POLY_THREADS
+        // The active voices are split in fParts contiguous parts, part k computing its voices in their own buffer
+        static void computeVoicesPart(void* arg, int part)
+        {
+            mydsp_poly* poly = static_cast<mydsp_poly*>(arg);
+            int voices = (poly->fVoiceControl) ? poly->fNumActive : poly->fPolyphony;
+            for (int v = part * voices / poly->fParts; v < (part + 1) * voices / poly->fParts; v++) {
+                int i = (poly->fVoiceControl) ? poly->fActiveList[v] : v;
+                poly->computeVoice(poly->fVoiceTable[i], poly->fCount, poly->fInputs, poly->fVoiceBuffer[i]);
+            }
+        }
+    
+        /**
+         * The voices are computed in parallel, then mixed by the calling thread in the voice order, 
+         * which gives the same result as the serial computation.
+         */
+        void computeParallel(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs)
+        {
+            int voices = (fVoiceControl) ? fNumActive : fPolyphony;
+            fCount = count;
+            fInputs = inputs;
+            fParts = std::min(fWorkers->getNumParts(), voices);
+            if (fParts > 1) {
+                fWorkers->run(computeVoicesPart, this, fParts);
+            } else if (fParts == 1) {
+                computeVoicesPart(this, 0);
+            }
+        
+            if (fVoiceControl) {
+                for (int v = 0; v < fNumActive; ) {
+                    int i = fActiveList[v];
+                    // Mix it in result, the voice being possibly freed
+                    mixPlayingVoice(i, count, fVoiceBuffer[i], outputs);
+                    if (v < fNumActive && fActiveList[v] == i) {
+                        v++;
+                    }
+                }
+            } else {
+                for (int i = 0; i < fPolyphony; i++) {
+                    mixVoice(count, fVoiceBuffer[i], outputs);
+                }
+            }
+        }
+    
+        void deleteVoiceThreads()
+        {
+            if (fWorkers) {
+                delete fWorkers;
+                for (int i = 0; i < fPolyphony; i++) {
+                    for (int chan = 0; chan < fNumOutputs; chan++) {
+                        delete[] fVoiceBuffer[i][chan];
+                    }
+                    delete[] fVoiceBuffer[i];
+                }
+                delete[] fVoiceBuffer;
+                fWorkers = 0;
+                fVoiceBuffer = 0;
+            }
+        }
+    #endif
+    
         inline void clearOutput(int count, FAUSTFLOAT** mixBuffer) 
         {
             for (int i = 0; i < fNumOutputs; i++) {
                 memset(mixBuffer[i], 0, count * sizeof(FAUSTFLOAT));
             }
         }
+    
+        inline void computeGroupSlice(int group, int offset, int slice, FAUSTFLOAT** inputs)
+        {
+            if (slice > 0) {
+                int numInputs = getNumInputs();
+                FAUSTFLOAT** inputs_slice = (FAUSTFLOAT**)alloca(fNumLanes * numInputs * sizeof(FAUSTFLOAT*));
+                FAUSTFLOAT** outputs_slice = (FAUSTFLOAT**)alloca(fNumLanes * fNumOutputs * sizeof(FAUSTFLOAT*));
+                // All the lanes get the same inputs
+                for (int lane = 0; lane < fNumLanes; lane++) {
+                    for (int chan = 0; chan < numInputs; chan++) {
+                        inputs_slice[lane * numInputs + chan] = &(inputs[chan][offset]);
+                    }
+                    for (int chan = 0; chan < fNumOutputs; chan++) {
+                        outputs_slice[lane * fNumOutputs + chan] = &(fLaneBuffer[lane * fNumOutputs + chan][offset]);
+                    }
+                }
+                fLaneGroups[group]->compute(slice, inputs_slice, outputs_slice);
+            }
+        }
+    
+        void computeLanes(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs)
+        {
+            for (int group = 0; group < fLaneGroups.size(); group++) {
+                int first = group * fNumLanes;
+                int last = std::min(first + fNumLanes, fPolyphony);
+                bool active = !fVoiceControl;
+                bool trigger = false;
+                for (int i = first; i < last; i++) {
+                    if (fVoiceControl && fVoiceTable[i]->fNote != kFreeVoice) {
+                        active = true;
+                        trigger |= fVoiceTable[i]->fTrigger;
+                    }
+                }
+                // A group without playing voice is not computed
+                if (!active) continue;
+                
+                if (trigger) {
+                    // New notes, so re-trigger : the gate of the new voices is 0 for the first sample
+                    for (int i = first; i < last; i++) {
+                        if (fVoiceTable[i]->fNote != kFreeVoice && fVoiceTable[i]->fTrigger) {
+                            fVoiceTable[i]->setParamValue(fGateLabel, 0.0f);
+                        }
+                    }
+                    computeGroupSlice(group, 0, 1, inputs);
+                    for (int i = first; i < last; i++) {
+                        if (fVoiceTable[i]->fNote != kFreeVoice && fVoiceTable[i]->fTrigger) {
+                            fVoiceTable[i]->fTrigger = false;
+                            fVoiceTable[i]->setParamValue(fGateLabel, 1.0f);
+                        }
+                    }
+                    computeGroupSlice(group, 1, count - 1, inputs);
+                } else {
+                    computeGroupSlice(group, 0, count, inputs);
+                }
+                
+                // Mix the voices of the group
+                for (int i = first; i < last; i++) {
+                    FAUSTFLOAT** laneBuffer = &fLaneBuffer[(i - first) * fNumOutputs];
+                    if (!fVoiceControl) {
+                        mixVoice(count, laneBuffer, outputs);
+                    } else if (fVoiceTable[i]->fNote != kFreeVoice) {
+                        mixPlayingVoice(i, count, laneBuffer, outputs);
+                    }
+                }
+            }
+        }
           
         inline int getVoice(int note, bool steal = false)
         {
+            // fActiveList belongs to the audio thread, so all the voices are searched
             for (int i = 0; i < fPolyphony; i++) {
                 if (fVoiceTable[i]->fNote == note) {
                     if (steal) {
@@ -291,6 +816,7 @@ class mydsp_poly : public dsp, public midi {
                         std::cout << "Steal release voice : voice_date " << fVoiceTable[i]->fDate << " cur_date = " << fDate << " voice = " << i << std::endl;
                         fVoiceTable[i]->fDate = fDate++;
                         fVoiceTable[i]->fTrigger = true;
+                        fStolen++;
                         return i;
                     // Otherwise steal oldest voice...
                     } else if (fVoiceTable[i]->fDate < date) {
@@ -301,6 +827,7 @@ class mydsp_poly : public dsp, public midi {
                 std::cout << "Steal playing voice : voice_date " << fVoiceTable[voice]->fDate << " cur_date = " << fDate << " voice = " << voice << std::endl;
                 fVoiceTable[voice]->fDate = fDate++;
                 fVoiceTable[voice]->fTrigger = true;
+                fStolen++;
                 return voice;
             } else {
                 return kNoVoice;
@@ -316,8 +843,18 @@ class mydsp_poly : public dsp, public midi {
             fFreqLabel = fGateLabel = fGainLabel = "";
             
             // Create voices
+            lanes_dsp* lanes = dynamic_cast<lanes_dsp*>(dsp);
+            fNumLanes = (lanes) ? lanes->getNumLanes() : 1;
             for (int i = 0; i < fPolyphony; i++) {
-                fVoiceTable.push_back(new dsp_voice(dsp->clone()));
+                if (lanes) {
+                    // Voice i is the lane (i % fNumLanes) of the group (i / fNumLanes)
+                    if (i % fNumLanes == 0) {
+                        fLaneGroups.push_back(static_cast<lanes_dsp*>(dsp->clone()));
+                    }
+                    fVoiceTable.push_back(new dsp_voice(new lane_dsp(fLaneGroups.back(), i % fNumLanes)));
+                } else {
+                    fVoiceTable.push_back(new dsp_voice(dsp->clone()));
+                }
             }
             
             // Init audio output buffers
@@ -326,6 +863,13 @@ class mydsp_poly : public dsp, public midi {
             for (int i = 0; i < fNumOutputs; i++) {
                 fMixBuffer[i] = new FAUSTFLOAT[MIX_BUFFER_SIZE];
             }
+            fLaneBuffer = 0;
+            if (lanes) {
+                fLaneBuffer = new FAUSTFLOAT*[fNumLanes * fNumOutputs];
+                for (int i = 0; i < fNumLanes * fNumOutputs; i++) {
+                    fLaneBuffer[i] = new FAUSTFLOAT[MIX_BUFFER_SIZE];
+                }
+            }
             
             // Groups all uiItem for a given path
             fVoiceGroup = new proxy_dsp(fVoiceTable[0]);
@@ -334,7 +878,19 @@ class mydsp_poly : public dsp, public midi {
                 fVoiceTable[i]->buildUserInterface(&fGroups);
             }
             
+            // Allocated once, so that the audio thread never allocates the active voices
+            fActiveList.resize(fPolyphony);
+            fNumActive = 0;
+            
             fDate = 0;
+            fReleaseTimeout = 0;
+            fStolen = 0;
+            fFreed = 0;
+        
+        #ifdef POLY_THREADS
+            fWorkers = 0;
+            fVoiceBuffer = 0;
+        #endif
             
             // Keep gain, freq and gate labels
             fVoiceTable[0]->extractLabels(fGateLabel, fFreqLabel, fGainLabel);
@@ -381,7 +937,7 @@ class mydsp_poly : public dsp, public midi {
             }
         }
     
-        // Always returns a voice
+        // Always returns a voice, to be activated by the caller once set up
         int newVoiceAux()
         {
             int voice = getVoice(kFreeVoice, true);
@@ -416,6 +972,10 @@ class mydsp_poly : public dsp, public midi {
 
         virtual ~mydsp_poly()
         {
+        #ifdef POLY_THREADS
+            deleteVoiceThreads();
+        #endif
+        
             for (int i = 0; i < fNumOutputs; i++) {
                 delete[] fMixBuffer[i];
             }
@@ -425,6 +985,16 @@ class mydsp_poly : public dsp, public midi {
                 delete fVoiceTable[i];
             }
             
+            if (fLaneBuffer) {
+                for (int i = 0; i < fNumLanes * fNumOutputs; i++) {
+                    delete[] fLaneBuffer[i];
+                }
+                delete[] fLaneBuffer;
+            }
+            for (int i = 0; i < fLaneGroups.size(); i++) {
+                delete fLaneGroups[i];
+            }
+            
             delete fVoiceGroup;
             
             // Remove object from all MidiUI interfaces that handle it
@@ -487,27 +1057,27 @@ class mydsp_poly : public dsp, public midi {
             // First clear the outputs
             clearOutput(count, outputs);
             
-            if (fVoiceControl) {
+            fFreed = 0;
+            updateActiveList();
+            fCounters.fActive = (fVoiceControl) ? fNumActive : fPolyphony;
+            
+            if (fLaneGroups.size() > 0) {
+                // Voices computed in lockstep
+                computeLanes(count, inputs, outputs);
+        #ifdef POLY_THREADS
+            } else if (fWorkers) {
+                // Voices computed by several threads
+                computeParallel(count, inputs, outputs);
+        #endif
+            } else if (fVoiceControl) {
                 // Mix all playing voices
-                for (int i = 0; i < fPolyphony; i++) {
-                    if (fVoiceTable[i]->fNote != kFreeVoice) {
-                        if (fVoiceTable[i]->fTrigger) {
-                            // New note, so re-trigger
-                            fVoiceTable[i]->fTrigger = false;
-                            fVoiceTable[i]->setParamValue(fGateLabel, 0.0f);
-                            fVoiceTable[i]->computeSlice(0, 1, inputs, fMixBuffer);
-                            fVoiceTable[i]->setParamValue(fGateLabel, 1.0f);
-                            fVoiceTable[i]->computeSlice(1, count - 1, inputs, fMixBuffer);
-                        } else {
-                            // Compute regular voice
-                            fVoiceTable[i]->compute(count, inputs, fMixBuffer);
-                        }
-                        // Mix it in result
-                        fVoiceTable[i]->fLevel = mixVoice(count, fMixBuffer, outputs);
-                        // Check the level to possibly set the voice in kFreeVoice again
-                        if ((fVoiceTable[i]->fLevel < VOICE_STOP_LEVEL) && (fVoiceTable[i]->fNote == kReleaseVoice)) {
-                            fVoiceTable[i]->fNote = kFreeVoice;
-                        }
+                for (int v = 0; v < fNumActive; ) {
+                    int i = fActiveList[v];
+                    computeVoice(fVoiceTable[i], count, inputs, fMixBuffer);
+                    // Mix it in result, the voice being possibly freed
+                    mixPlayingVoice(i, count, fMixBuffer, outputs);
+                    if (v < fNumActive && fActiveList[v] == i) {
+                        v++;
                     }
                 }
             } else {
@@ -517,8 +1087,48 @@ class mydsp_poly : public dsp, public midi {
                     mixVoice(count, fMixBuffer, outputs);
                 }
             }
+            
+            fCounters.fStolen = fStolen;
+            fCounters.fFreed = fFreed;
+            fStolen = 0;
         }
+    
+        /**
+         * Free the voices in release after a given duration, even if they have not decayed yet.
+         *
+         * @param seconds - the maximum release duration, 0 (the default) to wait for the voices to decay
+         */
+        void setReleaseTimeout(double seconds) { fReleaseTimeout = seconds; }
+    
+        // Number of active, stolen and freed voices of the last compute cycle, to tune the polyphony
+        voice_counters getVoiceCounters() { return fCounters; }
         
+    #ifdef POLY_THREADS
+        /**
+         * Compute the voices with several threads (only available when compiled with POLY_THREADS). 
+         * The active voices are split in contiguous parts computed by the calling thread and 
+         * the workers, each voice in its own buffer. The voices are then mixed in the voice order, 
+         * so the output is bit-exact with the serial computation. Not used with a lanes_dsp.
+         * To be called when the audio is not running.
+         *
+         * @param threads - the number of worker threads added to the calling thread, 0 to go back to the serial computation
+         */
+        void setVoiceThreads(int threads)
+        {
+            deleteVoiceThreads();
+            if (threads > 0 && fLaneGroups.size() == 0) {
+                fWorkers = new voice_workers(threads);
+                fVoiceBuffer = new FAUSTFLOAT**[fPolyphony];
+                for (int i = 0; i < fPolyphony; i++) {
+                    fVoiceBuffer[i] = new FAUSTFLOAT*[fNumOutputs];
+                    for (int chan = 0; chan < fNumOutputs; chan++) {
+                        fVoiceBuffer[i][chan] = new FAUSTFLOAT[MIX_BUFFER_SIZE];
+                    }
+                }
+            }
+        }
+    #endif
+    
         int getNumInputs()
         {
             return fVoiceTable[0]->getNumInputs();
@@ -547,16 +1157,17 @@ class mydsp_poly : public dsp, public midi {
     
         MapUI* newVoice()
         {
-            return fVoiceTable[newVoiceAux()];
+            int voice = newVoiceAux();
+            activateVoice(voice);
+            return fVoiceTable[voice];
         }
         
         void deleteVoice(MapUI* voice)
         {
             std::vector<dsp_voice*>::iterator it = find(fVoiceTable.begin(), fVoiceTable.end(), reinterpret_cast<dsp_voice*>(voice));
             if (it != fVoiceTable.end()) {
-                (*it)->setParamValue(fGateLabel, 0.0f);
                 // Release voice
-                (*it)->fNote = kReleaseVoice;
+                releaseVoice(*it);
             } else {
                 std::cout << "Voice not found\n";
             }
@@ -571,6 +1182,7 @@ class mydsp_poly : public dsp, public midi {
                 fVoiceTable[voice]->setParamValue(fGainLabel, float(velocity)/127.f);
                 fVoiceTable[voice]->fNote = pitch;
                 fVoiceTable[voice]->fTrigger = true; // so that envelop is always re-initialized
+                activateVoice(voice);
                 return fVoiceTable[voice];
             }
             
@@ -583,9 +1195,8 @@ class mydsp_poly : public dsp, public midi {
                 int voice = getVoice(pitch);
                 if (voice != kNoVoice) {
                     // No use of velocity for now...
-                    fVoiceTable[voice]->setParamValue(fGateLabel, 0.0f);
                     // Release voice
-                    fVoiceTable[voice]->fNote = kReleaseVoice;
+                    releaseVoice(fVoiceTable[voice]);
                 } else {
                     std::cout << "Playing pitch = " << pitch << " not found\n";
                 }
@@ -618,10 +1229,13 @@ class mydsp_poly : public dsp, public midi {
         void allNotesOff()
         {
             if (checkPolyphony()) {
+                // The free voices stay free
                 for (int i = 0; i < fPolyphony; i++) {
                     fVoiceTable[i]->setParamValue(fGateLabel, 0.0f);
-                    fVoiceTable[i]->fNote = kReleaseVoice;
                     fVoiceTable[i]->fTrigger = false;
+                    if (fVoiceTable[i]->fNote != kFreeVoice) {
+                        releaseVoice(fVoiceTable[i]);
+                    }
                 }
             }
         }
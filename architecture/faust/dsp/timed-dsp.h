@@ -31,6 +31,8 @@
 #include "faust/gui/ring-buffer.h"
 
 #include <set>
+#include <queue>
+#include <vector>
 #include <float.h>
 #include <assert.h>
 
@@ -134,10 +136,50 @@ struct ZoneUI : public UI
 
 };
 
+#define TIMED_CONTROLS_SIZE 1024
+
+/**
+ * Dated control change waiting to be applied by a timed_dsp.
+ */
+
+struct TimedControl {
+    
+    double fDate;
+    FAUSTFLOAT fValue;
+    FAUSTFLOAT* fZone;
+    unsigned int fOrder;    // Arrival order, for the controls with the same date
+    
+    TimedControl(double date, FAUSTFLOAT value, FAUSTFLOAT* zone, unsigned int order)
+        :fDate(date), fValue(value), fZone(zone), fOrder(order) {}
+    
+    // Ordering of the queue : the earliest control first
+    bool operator<(const TimedControl& control) const
+    {
+        return (fDate > control.fDate) || ((fDate == control.fDate) && (fOrder > control.fOrder));
+    }
+    
+};
+
+/**
+ * Queue of the dated controls, with a preallocated storage.
+ */
+
+struct TimedControls : public std::priority_queue<TimedControl> {
+    
+    TimedControls(size_t size)
+    {
+        c.reserve(size);
+    }
+    
+};
+
 /**
  * Timed signal processor that allows to handle the decorated DSP by 'slices'
  * that is, calling the 'compute' method several times and changing control
  * parameters between slices.
+ * At the beginning of each buffer, the dated controls of all the zones are moved
+ * from their ring buffers to a single queue ordered by date, so that each control
+ * is found in O(log n) whatever the number of zones.
  */
 
 class timed_dsp : public decorator_dsp {
@@ -148,6 +190,9 @@ class timed_dsp : public decorator_dsp {
         double fOffsetUsec;     // Compute call offset in usec
         bool fFirstCallback;
         ZoneUI fZoneUI;
+        TimedControls fControls;    // Controls received and not applied yet, the earliest first
+        unsigned int fOrder;
+        int fMinSlice;
         
         void computeSlice(int offset, int slice, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs) 
         {
@@ -171,56 +216,51 @@ class timed_dsp : public decorator_dsp {
             return std::max(0., (double(getSampleRate()) * (usec - fDateUsec)) / 1000000.);
         }
         
-        ztimedmap::iterator getNextControl(DatedControl& res, bool convert_ts)
+        // Move the controls received since the previous buffer to the queue
+        void receiveControls()
         {
-            DatedControl date1(DBL_MAX, 0);
-            ztimedmap::iterator it1, it2 = GUI::gTimedZoneMap.end();
-            std::set<FAUSTFLOAT*>::iterator it3;
-              
-            // Find date of next audio slice to compute
-            for (it3 = fZoneUI.fZoneSet.begin(); it3 != fZoneUI.fZoneSet.end(); it3++) {
-                // If value list is not empty, get the date and keep the minimal one
-                it1 = GUI::gTimedZoneMap.find(*it3);
-                if (it1 != GUI::gTimedZoneMap.end()) { // Check if zone still in global GUI::gTimedZoneMap (since MidiUI may have been desallocated)
-                    DatedControl date2;
-                    if (ringbuffer_peek((*it1).second, (char*)&date2, sizeof(DatedControl)) == sizeof(DatedControl) 
-                        && date2.fDate < date1.fDate) {
-                        it2 = it1;
-                        date1 = date2;
+            std::set<FAUSTFLOAT*>::iterator it1;
+            for (it1 = fZoneUI.fZoneSet.begin(); it1 != fZoneUI.fZoneSet.end(); it1++) {
+                ztimedmap::iterator it2 = GUI::gTimedZoneMap.find(*it1);
+                if (it2 != GUI::gTimedZoneMap.end()) { // Check if zone still in global GUI::gTimedZoneMap (since MidiUI may have been desallocated)
+                    DatedControl control;
+                    while (ringbuffer_read_space((*it2).second) >= sizeof(DatedControl)) {
+                        ringbuffer_read((*it2).second, (char*)&control, sizeof(DatedControl));
+                        fControls.push(TimedControl(control.fDate, control.fValue, *it1, fOrder++));
                     }
                 }
             }
-            
-            // If needed, convert date1 in samples from begining of the buffer, possible moving to 0 (if negative)
-            if (convert_ts) {
-                date1.fDate = convertUsecToSample(date1.fDate);
-            }
-                
-            res = date1;
-            return it2;
         }
         
         virtual void computeAux(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs, bool convert_ts)
         {
             int slice, offset = 0;
-            ztimedmap::iterator it;
-            DatedControl next_control;
-             
+            
+            receiveControls();
+            
             // Do audio computation "slice" by "slice"
-            while ((it = getNextControl(next_control, convert_ts)) != GUI::gTimedZoneMap.end()) {
-                     
-                // Compute audio slice
-                slice = int(next_control.fDate) - offset;
-                computeSlice(offset, slice, inputs, outputs);
-                offset += slice;
-               
-                // Update control
-                ringbuffer_t* control_values = (*it).second;
-                *((*it).first) = next_control.fValue;
+            while (!fControls.empty()) {
                 
-                // Move ringbuffer pointer
-                ringbuffer_read_advance(control_values, sizeof(DatedControl));
-            } 
+                // Date in samples from begining of the buffer, possible moving to 0 (if negative)
+                const TimedControl& control = fControls.top();
+                double date = (convert_ts) ? convertUsecToSample(control.fDate) : control.fDate;
+                if (date >= count) {
+                    // Keep the control for a next buffer
+                    if (convert_ts) break;
+                    date = count;
+                }
+                
+                // Compute audio slice : a slice shorter than fMinSlice is not computed and its controls are applied at its beginning
+                slice = int(date) - offset;
+                if (slice >= fMinSlice) {
+                    computeSlice(offset, slice, inputs, outputs);
+                    offset += slice;
+                }
+                
+                // Update control
+                *(control.fZone) = control.fValue;
+                fControls.pop();
+            }
             
             // Compute last audio slice
             slice = count - offset;
@@ -229,7 +269,8 @@ class timed_dsp : public decorator_dsp {
 
     public:
 
-        timed_dsp(dsp* dsp):decorator_dsp(dsp), fDateUsec(0),fOffsetUsec(0), fFirstCallback(true)
+        // The queue is preallocated, so that no memory is allocated in the audio thread in the usual case
+        timed_dsp(dsp* dsp):decorator_dsp(dsp), fDateUsec(0),fOffsetUsec(0), fFirstCallback(true), fControls(TIMED_CONTROLS_SIZE), fOrder(0), fMinSlice(1)
         {}
         virtual ~timed_dsp() 
         {}
@@ -248,9 +289,20 @@ class timed_dsp : public decorator_dsp {
     
         virtual timed_dsp* clone()
         {
-            return new timed_dsp(fDSP->clone());
+            timed_dsp* dsp = new timed_dsp(fDSP->clone());
+            dsp->setMinSlice(fMinSlice);
+            return dsp;
         }
     
+        /**
+         * Set the minimum length of the slices, so that dense automation does not split 
+         * the buffers in too many 'compute' calls : the controls dated less than 'frames' 
+         * samples after the previous slice are applied at its end.
+         *
+         * @param frames - the minimum slice length, 1 (the default) to apply each control at its exact date
+         */
+        void setMinSlice(int frames) { fMinSlice = std::max(1, frames); }
+    
         // Default method take a timestamp at 'compute' call time
         virtual void compute(int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs)
         {
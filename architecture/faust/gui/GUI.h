@@ -46,6 +46,9 @@ class clist : public std::list<uiItem*>
 {
     public:
     
+        int fIndex;     // Index of the zone in the flat copy of GUI, -1 until it is built
+    
+        clist() : fIndex(-1) {}
         virtual ~clist();
         
 };
@@ -62,10 +65,20 @@ class GUI : public UI
         static std::list<GUI*>  fGuiList;
         zmap                    fZoneMap;
         bool                    fStopped;
+    
+        // Flat copy of fZoneMap used by updateAllZones, rebuilt when a zone or an item has been registered
+        std::vector<FAUSTFLOAT*> fZones;        // Registered zones
+        std::vector<FAUSTFLOAT>  fValues;       // Zone values the items have last been updated with
+        std::vector<int>         fFirstItem;    // Index in fItems of the first item of each zone (and end of the last one)
+        std::vector<uiItem*>     fItems;        // Items of all zones, grouped by zone
+        bool                     fModified;     // Registration has changed since the flat copy was built
+        bool                     fUpdateAll;    // Next update has to check all items
+    
+        void buildZones();
         
      public:
             
-        GUI() : fStopped(false) 
+        GUI() : fStopped(false), fModified(false), fUpdateAll(false)
         {	
             fGuiList.push_back(this);
         }
@@ -87,6 +100,7 @@ class GUI : public UI
         {
             if (fZoneMap.find(z) == fZoneMap.end()) fZoneMap[z] = new clist();
             fZoneMap[z]->push_back(c);
+            fModified = true;
         } 	
 
         void updateAllZones();
@@ -215,24 +229,58 @@ inline void GUI::updateZone(FAUSTFLOAT* z)
 	for (clist::iterator c = l->begin(); c != l->end(); c++) {
 		if ((*c)->cache() != v) (*c)->reflectZone();
 	}
+    // The items now reflect v : a later return of the zone to its previous value has to be seen by updateAllZones
+    if (!fModified && l->fIndex >= 0) fValues[l->fIndex] = v;
 }
 
 /**
- * Update all user items not up to date
+ * Build the flat copy of the zones and items, so that updateAllZones only
+ * walks contiguous arrays
+ */
+
+inline void GUI::buildZones()
+{
+    fZones.clear();
+    fFirstItem.clear();
+    fItems.clear();
+    
+    for (zmap::iterator m = fZoneMap.begin(); m != fZoneMap.end(); m++) {
+        if (m->first) {
+            m->second->fIndex = int(fZones.size());
+            fZones.push_back(m->first);
+            fFirstItem.push_back(int(fItems.size()));
+            fItems.insert(fItems.end(), m->second->begin(), m->second->end());
+        }
+    }
+    fFirstItem.push_back(int(fItems.size()));
+    fValues.resize(fZones.size());
+    
+    // New items have to be checked even if their zone has not changed
+    fModified = false;
+    fUpdateAll = true;
+}
+
+/**
+ * Update all user items not up to date : the items of a zone are only checked 
+ * when the zone value differs from the one they have last been updated with
+ * (by the previous updateAllZones or by updateZone when an item has modified the zone)
  */
 
 inline void GUI::updateAllZones()
 {
-	for (zmap::iterator m = fZoneMap.begin(); m != fZoneMap.end(); m++) {
-		FAUSTFLOAT* z = m->first;
-		clist*	l = m->second;
-        if (z) {
-            FAUSTFLOAT	v = *z;
-            for (clist::iterator c = l->begin(); c != l->end(); c++) {
-                if ((*c)->cache() != v) (*c)->reflectZone();
+    if (fModified) buildZones();
+    
+    for (size_t i = 0; i < fZones.size(); i++) {
+        FAUSTFLOAT v = *fZones[i];
+        if (fUpdateAll || v != fValues[i]) {
+            fValues[i] = v;
+            for (int c = fFirstItem[i]; c < fFirstItem[i+1]; c++) {
+                if (fItems[c]->cache() != v) fItems[c]->reflectZone();
             }
         }
-	}
+    }
+    
+    fUpdateAll = false;
 }
 
 inline void GUI::addCallback(FAUSTFLOAT* zone, uiCallback foo, void* data) 
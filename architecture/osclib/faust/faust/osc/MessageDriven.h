@@ -24,6 +24,7 @@
 #ifndef __MessageDriven__
 #define __MessageDriven__
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -48,7 +49,9 @@ typedef class SMARTP<MessageDriven>	SMessageDriven;
 	
 	The principle of the dispatch is the following:
 	- first the processMessage() method should be called on the top level node
-	- next processMessage call propose 
+	- a literal address is looked up in the address map of the top level node,
+	  and the message is accepted by the corresponding nodes
+	- otherwise processMessage call propose 
 */
 class MessageDriven : public MessageProcessor, public smartable
 {
@@ -56,8 +59,15 @@ class MessageDriven : public MessageProcessor, public smartable
 	std::string						fOSCPrefix;		///< the node OSC address prefix (OSCAddress = fOSCPrefix + '/' + fName)
 	std::vector<SMessageDriven>		fSubNodes;		///< the subnodes of the current node
 
+	std::map<std::string, std::vector<MessageDriven*> >	fAddressMap;	///< the nodes of the tree indexed by their address (used on the top level node)
+	int								fMapRevision;	///< the tree revision when fAddressMap has been built
+	static int						fTreeRevision;	///< incremented each time a node is added to a tree
+
+	void	buildAddressMap(const std::string& address);
+	void	addToMap(MessageDriven* node, const std::string& address);
+
 	protected:
-				 MessageDriven(const char *name, const char *oscprefix) : fName (name), fOSCPrefix(oscprefix) {}
+				 MessageDriven(const char *name, const char *oscprefix) : fName (name), fOSCPrefix(oscprefix), fMapRevision(-1) {}
 		virtual ~MessageDriven() {}
 
 	public:
@@ -117,7 +127,7 @@ class MessageDriven : public MessageProcessor, public smartable
 		*/
 		virtual void	get (unsigned long ipdest, const std::string & what) const {}
 
-		void			add(SMessageDriven node)	{ fSubNodes.push_back (node); }
+		void			add(SMessageDriven node)	{ fSubNodes.push_back (node); fTreeRevision++; }
 		const char*		getName() const				{ return fName.c_str(); }
 		std::string		getOSCAddress() const;
 		int				size() const				{ return fSubNodes.size (); }
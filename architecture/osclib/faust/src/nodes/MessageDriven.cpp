@@ -36,12 +36,44 @@ namespace oscfaust
 
 static const char * kGetMsg = "get";
 
+int MessageDriven::fTreeRevision = 0;
+
+//--------------------------------------------------------------------------
+// indexes the node and its subnodes by their address, in the propose() order
+void MessageDriven::addToMap(MessageDriven* node, const string& address)
+{
+	fAddressMap[address].push_back(node);
+	for (vector<SMessageDriven>::iterator i = node->fSubNodes.begin(); i != node->fSubNodes.end(); i++) {
+		addToMap(*i, address + '/' + (*i)->getName());
+	}
+}
+
+//--------------------------------------------------------------------------
+void MessageDriven::buildAddressMap(const string& address)
+{
+	fAddressMap.clear();
+	addToMap(this, address);
+	fMapRevision = fTreeRevision;
+}
+
 //--------------------------------------------------------------------------
 void MessageDriven::processMessage(const Message* msg)
 {
 	const string addr = msg->address();
 
-	// create a regular expression
+	// a literal address is directly looked up in the address map
+	if (!OSCAddress::isPattern(addr)) {
+		if (fMapRevision != fTreeRevision) buildAddressMap(string("/") + getName());
+		map<string, vector<MessageDriven*> >::const_iterator i = fAddressMap.find(addr);
+		if (i != fAddressMap.end()) {
+			for (vector<MessageDriven*>::const_iterator n = i->second.begin(); n != i->second.end(); n++) {
+				(*n)->accept(msg);
+			}
+		}
+		return;
+	}
+
+	// otherwise create a regular expression
 	OSCRegexp r(OSCAddress::addressFirst(addr).c_str());
 	// and call propose with this regexp and with the dest osc address tail
 	propose(msg, &r, OSCAddress::addressTail(addr));
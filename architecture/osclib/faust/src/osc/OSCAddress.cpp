@@ -60,5 +60,10 @@ string OSCAddress::addressTail (const string& a)
 	return "";
 }
 
+//--------------------------------------------------------------------------
+bool OSCAddress::isPattern (const string& a)
+{
+	return a.find_first_of("*?[]{},.^$()|+\\") != string::npos;
+}
 
 } // end namespoace
@@ -59,6 +59,13 @@ class OSCAddress
 			\return the tail of an address after its first part.
 		*/
 		static std::string	addressTail (const std::string& address);
+		/*!
+			\brief address decoding utility.
+			\param address the osc address to be processed
+			\return true when the address contains characters interpreted by the regexp matching
+			(OSC wildcards or regular expression special characters), false for a literal address.
+		*/
+		static bool			isPattern (const std::string& address);
 };
 
 
@@ -1,24 +1,33 @@
-
 #include <stdlib.h>
 #include <assert.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
-#include <semaphore.h>
 #include <sys/types.h>
-#include <sys/stat.h>
-#include <errno.h>
-#include <fcntl.h>
 #include <unistd.h>
 #include <math.h>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 using namespace std;
 
-// Globals
+/*
+ Version of the contract with the code generated by 'faust -sch', checked by the generated class :
+  1 : TaskQueue(cur_thread), TaskQueue::Init(), TaskQueue::GetNextTask(thread, num_threads),
+      DSPThreadPool::Init(), DSPThreadPool::Destroy(), DSPThreadPool::IsFinished(), volatile fIsFinished
+  2 : the client (this) is given to the TaskQueue and DSPThreadPool calls, StopMeasure also gets
+      the block size and the sample rate, Prepare() and TaskGraph::Init() are called at init time,
+      fIsFinished is a std::atomic<bool>
+ Code of an older contract must be generated again.
+*/
+#define FAUST_SCHEDULER_VERSION 2
 
-#define THREAD_SIZE 64
-#define QUEUE_SIZE 4096
+// Globals
 
 #define WORK_STEALING_INDEX 0
 #define LAST_TASK_INDEX 1
@@ -32,7 +41,7 @@ using namespace std;
 
 
 // On Intel set FZ (Flush to Zero) and DAZ (Denormals Are Zero)
-// flags to avoid costly denormals
+// flags to avoid costly denormals, on ARM64 set FZ
 #ifdef __SSE__
 #include <xmmintrin.h>
 #ifdef __SSE2__
@@ -40,338 +49,590 @@ using namespace std;
 #else
 #define AVOIDDENORMALS _mm_setcsr(_mm_getcsr() | 0x8000)
 #endif
+#elif defined(__aarch64__)
+#define AVOIDDENORMALS { unsigned long fpcr; __asm__ __volatile__("mrs %0, fpcr" : "=r" (fpcr)); \
+                         __asm__ __volatile__("msr fpcr, %0" : : "r" (fpcr | (1UL << 24))); }
 #else
-#define AVOIDDENORMALS 
-#endif
-
-#ifdef __linux__
-
-// handle 32/64 bits int size issues
-#ifdef __x86_64__
-#define UInt32	unsigned int
-#define UInt64	unsigned long int
-#else
-#define UInt32	unsigned int
-#define UInt64	unsigned long long int
-#endif
-
+#define AVOIDDENORMALS
 #endif
 
 #ifdef __APPLE__
 //#include <CoreServices/../Frameworks/CarbonCore.framework/Headers/MacTypes.h>
 #include <MacTypes.h>
+#include <mach/mach.h>
+#else
+#include <semaphore.h>
 #endif
 
-class TaskQueue;
+class WorkDeque;
 struct DSPThreadPool;
 
-extern TaskQueue* gTaskQueueList[THREAD_SIZE];
 extern DSPThreadPool* gThreadPool;
 extern int gClientCount;
-extern UInt64 gMaxStealing;
-    
+extern mutex gPoolMutex;
+extern long gMaxStealing;
+extern long gMaxSpinning;
+
 void Yield();
 
 /**
- * Returns the number of clock cycles elapsed since the last reset
- * of the processor
+ * Monotonic time in nanoseconds
  */
-static INLINE UInt64 DSP_rdtsc(void)
-{
-	union {
-		UInt32 i32[2];
-		UInt64 i64;
-	} count;
-	
-	__asm__ __volatile__("rdtsc" : "=a" (count.i32[0]), "=d" (count.i32[1]));
-     return count.i64;
+static INLINE long DSP_now()
+{
+    return long(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
 }
 
-#if defined(__i386__) || defined(__x86_64__)
-
-#define LOCK "lock ; "
-
+/**
+ * Hint to the processor that we are spinning
+ */
 static INLINE void NOP(void)
 {
-	__asm__ __volatile__("nop \n\t");
+#if defined(__SSE__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
 }
 
-static INLINE char CAS1(volatile void* addr, volatile int value, int newvalue)
-{
-    char ret;
-    __asm__ __volatile__ (
-						  "# CAS \n\t"
-						  LOCK "cmpxchg %2, (%1) \n\t"
-						  "sete %0               \n\t"
-						  : "=a" (ret)
-						  : "c" (addr), "d" (newvalue), "a" (value)
-                          : "memory"
-						  );
-    return ret;
+static INLINE int INC_ATOMIC(atomic<int>* val)
+{
+    return val->fetch_add(1, memory_order_acq_rel);
 }
 
-static INLINE int atomic_xadd(volatile int* atomic, int val) 
-{ 
-    int result;
-    __asm__ __volatile__ ("# atomic_xadd \n\t"
-                          LOCK "xaddl %0,%1 \n\t"
-                          : "=r" (result), "=m" (*atomic) 
-                          : "0" (val), "m" (*atomic));
-    return result;
-} 
-
-#endif
-
-
-/*
-static INLINE int INC_ATOMIC(volatile int* val)
+static INLINE int DEC_ATOMIC(atomic<int>* val)
 {
-    int actual;
-    do {
-        actual = *val;
-    } while (!CAS1(val, actual, actual + 1));
-    return actual;
+    return val->fetch_sub(1, memory_order_acq_rel);
 }
 
-static INLINE int DEC_ATOMIC(volatile int* val)
+int get_max_cpu()
 {
-    int actual;
-    do {
-        actual = *val;
-    } while (!CAS1(val, actual, actual - 1));
-    return actual;
+    int n = thread::hardware_concurrency();
+    return (n > 0) ? n : int(sysconf(_SC_NPROCESSORS_ONLN));
 }
-*/
 
-static INLINE int INC_ATOMIC(volatile int* val)
+#define MASTER_THREAD 0
+
+#define MAX_STEAL_DUR 50                    // in usec
+#define MAX_SPIN_DUR 200                    // in usec
+#define MAX_CLIENTS 256                     // DSP instances sharing the thread pool
+#define MAX_THREADS 64                      // workers in the thread pool
+
+/**
+ * Chase-Lev work stealing deque of task numbers (Le, Pop, Cohen, Zappa Nardelli,
+ * "Correct and efficient work-stealing for weak memory models", PPoPP 2013).
+ * The owner thread pushes and pops at the bottom, other threads steal at the top.
+ * A task is pushed at most once per cycle : the buffer is allocated once for the
+ * number of tasks of the graph and never grows.
+ */
+class WorkDeque
 {
-    return atomic_xadd(val, 1);
-}
- 
-static INLINE int DEC_ATOMIC(volatile int* val)
+    private:
+
+        atomic<long> fTop;
+        atomic<long> fBottom;
+        long fMask;
+        atomic<int>* fTasks;
+
+        INLINE int Get(long i) { return fTasks[i & fMask].load(memory_order_relaxed); }
+        INLINE void Put(long i, int task) { fTasks[i & fMask].store(task, memory_order_relaxed); }
+
+    public:
+
+        long fStealingStart;
+
+        WorkDeque(int tasks):fTop(0), fBottom(0), fStealingStart(0)
+        {
+            long size = 64;
+            while (size < tasks) size *= 2;
+            fMask = size - 1;
+            fTasks = new atomic<int>[size];
+        }
+
+        ~WorkDeque()
+        {
+            delete [] fTasks;
+        }
+
+        // Only when no thread uses the deque
+        void Reset()
+        {
+            fTop.store(0, memory_order_relaxed);
+            fBottom.store(0, memory_order_relaxed);
+            fStealingStart = 0;
+        }
+
+        // Owner only
+        INLINE void Push(int task)
+        {
+            long b = fBottom.load(memory_order_relaxed);
+            assert(b - fTop.load(memory_order_relaxed) <= fMask);
+            Put(b, task);
+            fBottom.store(b + 1, memory_order_release);
+        }
+
+        // Owner only
+        INLINE int Pop()
+        {
+            long b = fBottom.load(memory_order_relaxed) - 1;
+            fBottom.store(b, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            long t = fTop.load(memory_order_relaxed);
+            int task = WORK_STEALING_INDEX;
+            if (t <= b) {
+                task = Get(b);
+                if (t == b) {
+                    // Last task : race against thieves
+                    if (!fTop.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+                        task = WORK_STEALING_INDEX;
+                    }
+                    fBottom.store(b + 1, memory_order_relaxed);
+                }
+            } else {
+                fBottom.store(b + 1, memory_order_relaxed);
+            }
+            return task;
+        }
+
+        // Any thread
+        INLINE int Steal()
+        {
+            long t = fTop.load(memory_order_acquire);
+            atomic_thread_fence(memory_order_seq_cst);
+            long b = fBottom.load(memory_order_acquire);
+            if (t < b) {
+                int task = Get(t);
+                if (fTop.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+                    return task;
+                }
+            }
+            return WORK_STEALING_INDEX;
+        }
+};
+
+#define KDSPMESURE 50
+
+// Adaptive thread count : load thresholds (compute time / deadline) and number of measure windows
+// during which the thread count is kept after a change that did not pay
+#define KHIGHLOAD 0.75f
+#define KLOWLOAD 0.40f
+#define KHOLDWINDOWS 4
+
+static INLINE int Range(int min, int max, int val)
 {
-    return atomic_xadd(val, -1);
+    if (val < min) {
+        return min;
+    } else if (val > max) {
+        return max;
+    } else {
+        return val;
+    }
 }
- 
-// To be used in lock-free queue
-struct AtomicCounter
-{
-    union {
-        struct {
-            short fHead;	
-            short fTail;	
-        }
-        scounter;
-        int fValue;
-    }info;
-    
-	INLINE AtomicCounter()
-	{
-        info.fValue = 0;
-    }
-     
- 	INLINE  AtomicCounter& operator=(AtomicCounter& obj)
+
+/**
+ * State of the adaptive thread count controller, see Runnable::GetAdaptState
+ */
+struct AdaptState {
+
+    enum { kStable, kGrowing, kShrinking, kHold };
+
+    int fThreads;           ///< number of threads (including the audio thread) used by the last cycle
+    int fState;             ///< last decision of the controller
+    float fLoad;            ///< mean compute time / deadline over the last measure window
+    long fMeanTime;         ///< mean compute time of a cycle over the last measure window, in nsec
+    long fBudget;           ///< deadline of the last cycle in nsec, 0 when unknown
+    long fCycles;           ///< number of measured cycles
+    long fDeadlineMisses;   ///< number of cycles that took longer than their deadline
+    long fCPUTime;          ///< time spent in the cycles by the audio thread and the workers, in nsec
+};
+
+/**
+ * A client of the thread pool (the generated DSP class). Each client has its own deques, one for each
+ * thread slot of a cycle : slot 0 is the audio thread, the other slots are taken by the workers of the
+ * pool that join the cycle (see JoinCycle).
+ *
+ * It also measures the duration of each cycle and, when OMP_DYN_THREAD is set, adapts the number of threads.
+ * When the deadline of the cycles is known (count / sample rate), the controller compares the load
+ * to two thresholds : above KHIGHLOAD, or after a deadline miss, one thread is added, below KLOWLOAD
+ * one thread is removed. A change that does not pay (no gain after growing, overload after shrinking)
+ * is reverted and the thread count is kept for KHOLDWINDOWS windows.
+ * Without deadline, the thread count follows the variations of the mean compute time.
+ */
+struct Runnable {
+
+    long fTiming[KDSPMESURE];
+    long fStart;
+    long fStop;
+    int fCounter;
+    float fOldMean;
+    int fOldfDynamicNumThreads;
+    bool fDynAdapt;
+
+    // deadline based controller
+    float fLoadSum;
+    float fPrevLoad;
+    int fPrevThreads;
+    int fHold;
+    int fWindowMisses;
+
+    // slots of the current cycle : (last slot << 16) | next free slot, 0 when closed
+    atomic<int> fSlots;
+    atomic<int> fDoneSlots;
+    int fClaimedSlots;
+    vector<WorkDeque*> fTaskQueueList;
+
+    // published state, can be read from another thread
+    atomic<long> fCPUTime;
+    atomic<int> fThreads;
+    atomic<int> fState;
+    atomic<float> fLoad;
+    atomic<long> fMeanTime;
+    atomic<long> fBudget;
+    atomic<long> fCycles;
+    atomic<long> fDeadlineMisses;
+
+    virtual void computeThread(int cur_thread) = 0;
+
+    Runnable():fCounter(0), fOldMean(1000000000.f), fOldfDynamicNumThreads(1),
+        fLoadSum(0.f), fPrevLoad(0.f), fPrevThreads(0), fHold(0), fWindowMisses(0),
+        fSlots(0), fDoneSlots(0), fClaimedSlots(0), fCPUTime(0), fThreads(0), fState(AdaptState::kStable), fLoad(0.f), fMeanTime(0), fBudget(0), fCycles(0), fDeadlineMisses(0)
     {
-        info.fValue = obj.info.fValue;
-        return *this;
+    	memset(fTiming, 0, sizeof(long) * KDSPMESURE);
+        fDynAdapt = getenv("OMP_DYN_THREAD") ? strtol(getenv("OMP_DYN_THREAD"), NULL, 10) : false;
     }
-    
-	INLINE  AtomicCounter& operator=(volatile AtomicCounter& obj)
-	{
-        info.fValue = obj.info.fValue;
-        return *this;
+
+    virtual ~Runnable()
+    {
+        for (size_t i = 0; i < fTaskQueueList.size(); i++) {
+            delete fTaskQueueList[i];
+        }
     }
-    
-};
 
-int get_max_cpu()
-{
-    return sysconf(_SC_NPROCESSORS_ONLN);
-}
+    // Called at init time, before any cycle : allocates the deques of 'threads' slots for a graph of 'tasks' tasks
+    void Prepare(int threads, int tasks)
+    {
+        for (size_t i = 0; i < fTaskQueueList.size(); i++) {
+            delete fTaskQueueList[i];
+        }
+        fTaskQueueList.clear();
+        for (int i = 0; i < max(threads, 1); i++) {
+            fTaskQueueList.push_back(new WorkDeque(tasks));
+        }
+    }
 
-static int GetPID()
-{
-#ifdef WIN32
-    return  _getpid();
-#else
-    return getpid();
-#endif
-}
+    // Called by the audio thread : open 'num' slots for the workers, returns the number of opened slots
+    int OpenCycle(int num)
+    {
+        num = min(num, int(fTaskQueueList.size()) - 1);
+        fDoneSlots.store(0, memory_order_relaxed);
+        fClaimedSlots = -1;
+        fSlots.store((num << 16) | 1, memory_order_release);
+        return num;
+    }
+
+    // Called by a worker : returns the slot to use in computeThread, or -1 when the cycle is closed or full
+    INLINE int JoinCycle()
+    {
+        int slots = fSlots.load(memory_order_acquire);
+        while (true) {
+            int next = slots & 0xFFFF;
+            if (next == 0 || next > (slots >> 16)) {
+                return -1;
+            } else if (fSlots.compare_exchange_weak(slots, slots + 1, memory_order_acq_rel, memory_order_acquire)) {
+                return next;
+            }
+        }
+    }
 
-#define Value(e) (e).info.fValue
+    // Called by a worker at the end of computeThread
+    INLINE void LeaveCycle(long time)
+    {
+        fCPUTime.fetch_add(time, memory_order_relaxed);
+        fDoneSlots.fetch_add(1, memory_order_release);
+    }
 
-#define Head(e) (e).info.scounter.fHead
-#define IncHead(e) (e).info.scounter.fHead++
-#define DecHead(e) (e).info.scounter.fHead--
+    // Called by the audio thread when its own computeThread is done : no more worker can join,
+    // returns true when the ones that joined are done
+    INLINE bool CloseCycle()
+    {
+        if (fClaimedSlots < 0) {
+            int slots = fSlots.exchange(0, memory_order_acq_rel);
+            fClaimedSlots = (slots & 0xFFFF) - 1;
+        }
+        return fDoneSlots.load(memory_order_acquire) == fClaimedSlots;
+    }
 
-#define Tail(e) (e).info.scounter.fTail
-#define IncTail(e) (e).info.scounter.fTail++
-#define DecTail(e) (e).info.scounter.fTail--
+    INLINE float ComputeMean()
+    {
+        float mean = 0;
+        for (int i = 0; i < KDSPMESURE; i++) {
+            mean += float(fTiming[i]);
+        }
+        mean /= float(KDSPMESURE);
+        return mean;
+    }
 
-#define MASTER_THREAD 0
+    INLINE void StartMeasure()
+    {
+        fStart = DSP_now();
+    }
 
-#define MAX_STEAL_DUR 50                    // in usec
-#define DEFAULT_CLOCKSPERSEC 2500000000     // in cycles (2,5 Ghz)
+    // Without deadline : follow the variations of the mean compute time
+    INLINE void AdaptToMean(float mean, int staticthreadnum, int& dynthreadnum)
+    {
+        if (fabs(mean - fOldMean) > 2000) {     // in nsec
+            if (mean > fOldMean) { // Worse...
+                if (fOldfDynamicNumThreads > dynthreadnum) {
+                    fOldfDynamicNumThreads = dynthreadnum;
+                    dynthreadnum += 1;
+                } else {
+                    fOldfDynamicNumThreads = dynthreadnum;
+                    dynthreadnum -= 1;
+                }
+             } else { // Better...
+                if (fOldfDynamicNumThreads > dynthreadnum) {
+                    fOldfDynamicNumThreads = dynthreadnum;
+                    dynthreadnum -= 1;
+                } else {
+                    fOldfDynamicNumThreads = dynthreadnum;
+                    dynthreadnum += 1;
+                }
+            }
+            fOldMean = mean;
+            dynthreadnum = Range(1, staticthreadnum, dynthreadnum);
+        }
+    }
+
+    // With deadline : keep the load between KLOWLOAD and KHIGHLOAD
+    INLINE void AdaptToDeadline(float load, int staticthreadnum, int& dynthreadnum)
+    {
+        int state = fState.load(memory_order_relaxed);
+
+        if (fHold > 0) {
+            fHold--;
+            state = AdaptState::kHold;
+        } else if (state == AdaptState::kGrowing && load >= fPrevLoad * 0.95f) {
+            // the added thread did not pay
+            dynthreadnum = fPrevThreads;
+            fHold = KHOLDWINDOWS;
+            state = AdaptState::kHold;
+        } else if (state == AdaptState::kShrinking && (load > KHIGHLOAD || fWindowMisses > 0)) {
+            // the removed thread was needed
+            dynthreadnum = fPrevThreads;
+            fHold = KHOLDWINDOWS;
+            state = AdaptState::kHold;
+        } else if ((load > KHIGHLOAD || fWindowMisses > 0) && dynthreadnum < staticthreadnum) {
+            fPrevLoad = load;
+            fPrevThreads = dynthreadnum;
+            dynthreadnum += 1;
+            state = AdaptState::kGrowing;
+        } else if (load < KLOWLOAD && dynthreadnum > 1) {
+            fPrevLoad = load;
+            fPrevThreads = dynthreadnum;
+            dynthreadnum -= 1;
+            state = AdaptState::kShrinking;
+        } else {
+            state = AdaptState::kStable;
+        }
+
+        dynthreadnum = Range(1, staticthreadnum, dynthreadnum);
+        fState.store(state, memory_order_relaxed);
+    }
+
+    // Deadline unknown : follow the mean compute time
+    INLINE void StopMeasure(int staticthreadnum, int& dynthreadnum)
+    {
+        StopMeasure(staticthreadnum, dynthreadnum, 0, 0);
+    }
+
+    INLINE void StopMeasure(int staticthreadnum, int& dynthreadnum, int count, int samplerate)
+    {
+        fStop = DSP_now();
+        long time = fStop - fStart;
+        fCPUTime.fetch_add(time, memory_order_relaxed);
+        long budget = (count > 0 && samplerate > 0) ? long((1000000000.0 * count) / samplerate) : 0;
+
+        fThreads.store(dynthreadnum, memory_order_relaxed);
+        fBudget.store(budget, memory_order_relaxed);
+        fCycles.fetch_add(1, memory_order_relaxed);
+        if (budget > 0) {
+            fLoadSum += float(time) / float(budget);
+            if (time > budget) {
+                fDeadlineMisses.fetch_add(1, memory_order_relaxed);
+                fWindowMisses++;
+            }
+        }
+
+        fCounter = (fCounter + 1) % KDSPMESURE;
+        fTiming[fCounter] = time;
+
+        if (fCounter == 0) {
+            float mean = ComputeMean();
+            float load = fLoadSum / float(KDSPMESURE);
+            fMeanTime.store(long(mean), memory_order_relaxed);
+            fLoad.store(load, memory_order_relaxed);
+            if (fDynAdapt) {
+                if (budget > 0) {
+                    AdaptToDeadline(load, staticthreadnum, dynthreadnum);
+                } else {
+                    AdaptToMean(mean, staticthreadnum, dynthreadnum);
+                }
+            }
+            fLoadSum = 0.f;
+            fWindowMisses = 0;
+        }
+    }
+
+    // Query API, can be called from any thread
+    void GetAdaptState(AdaptState& state)
+    {
+        state.fThreads = fThreads.load(memory_order_relaxed);
+        state.fState = fState.load(memory_order_relaxed);
+        state.fLoad = fLoad.load(memory_order_relaxed);
+        state.fMeanTime = fMeanTime.load(memory_order_relaxed);
+        state.fBudget = fBudget.load(memory_order_relaxed);
+        state.fCycles = fCycles.load(memory_order_relaxed);
+        state.fDeadlineMisses = fDeadlineMisses.load(memory_order_relaxed);
+        state.fCPUTime = fCPUTime.load(memory_order_relaxed);
+    }
+
+    void ResetDeadlineMisses()
+    {
+        fDeadlineMisses.store(0, memory_order_relaxed);
+    }
+};
+
+struct DSPThread;
 
-class TaskQueue 
+/**
+ * Used by the generated code : a handle on the deque of the current thread slot of a client
+ */
+class TaskQueue
 {
     private:
-    
-        int fTaskList[QUEUE_SIZE];
-        volatile AtomicCounter fCounter;
-        UInt64 fStealingStart;
-     
+
+        WorkDeque* fDeque;
+
     public:
-  
-        INLINE TaskQueue(int cur_thread)
+
+        INLINE TaskQueue(Runnable* client, int cur_thread)
         {
-            for (int i = 0; i < QUEUE_SIZE; i++) {
-                fTaskList[i] = -1;
-            }
-            gTaskQueueList[cur_thread] = this;	
-            fStealingStart = 0;
+            fDeque = client->fTaskQueueList[cur_thread];
         }
-         
+
         INLINE void PushHead(int item)
         {
-            fTaskList[Head(fCounter)] = item;
-            IncHead(fCounter);
+            fDeque->Push(item);
         }
-        
+
         INLINE int PopHead()
         {
-            AtomicCounter old_val;
-            AtomicCounter new_val;
-            
-            do {
-                old_val = fCounter;
-                new_val = old_val;
-                if (Head(old_val) == Tail(old_val)) {
-                    return WORK_STEALING_INDEX;
-                } else {
-                    DecHead(new_val);
-                }
-            } while (!CAS1(&fCounter, Value(old_val), Value(new_val)));
-            
-            return fTaskList[Head(old_val) - 1];
+            return fDeque->Pop();
         }
-        
+
         INLINE int PopTail()
         {
-            AtomicCounter old_val;
-            AtomicCounter new_val;
-            
-            do {
-                old_val = fCounter;
-                new_val = old_val;
-                if (Head(old_val) == Tail(old_val)) {
-                   return WORK_STEALING_INDEX;
-                } else {
-                    IncTail(new_val);
-                }
-            } while (!CAS1(&fCounter, Value(old_val), Value(new_val)));
-            
-            return fTaskList[Tail(old_val)];
+            return fDeque->Steal();
         }
 
-		INLINE void MeasureStealingDur()
+		static INLINE void MeasureStealingDur(Runnable* client, int thread)
 		{
-            // Takes first timetamp
-            if (fStealingStart == 0) {
-                fStealingStart = DSP_rdtsc();
-            } else if ((DSP_rdtsc() - fStealingStart) > gMaxStealing) {
+            // Takes first timetamp, then spin for gMaxStealing before yielding the processor
+            WorkDeque* deque = client->fTaskQueueList[thread];
+            if (deque->fStealingStart == 0) {
+                deque->fStealingStart = DSP_now();
+            } else if ((DSP_now() - deque->fStealingStart) > gMaxStealing) {
                 Yield();
+            } else {
+                NOP();
             }
 		}
 
-		INLINE void ResetStealingDur()
+		static INLINE void ResetStealingDur(Runnable* client, int thread)
 		{
-            fStealingStart = 0;
+            client->fTaskQueueList[thread]->fStealingStart = 0;
 		}
-        
-        static INLINE int GetNextTask(int thread, int num_threads)
+
+        static INLINE int GetNextTask(Runnable* client, int thread, int num_threads)
         {
-            int tasknum;
-            for (int i = 0; i < num_threads; i++) {
-                if ((i != thread) && gTaskQueueList[i] && (tasknum = gTaskQueueList[i]->PopTail()) != WORK_STEALING_INDEX) {
-                #ifdef __linux__
-					//if (thread != MASTER_THREAD)
-						gTaskQueueList[thread]->ResetStealingDur();
-                #endif
+            // Visit the other threads starting from the next one, so that thieves don't all hit the same deque
+            vector<WorkDeque*>& queues = client->fTaskQueueList;
+            num_threads = min(num_threads, int(queues.size()));
+            for (int i = 1; i < num_threads; i++) {
+                int victim = (thread + i) % num_threads;
+                int tasknum = queues[victim]->Steal();
+                if (tasknum != WORK_STEALING_INDEX) {
+                    ResetStealingDur(client, thread);
                     return tasknum;    // Task is found
                 }
             }
-            NOP();
-          #ifdef __linux__
-			//if (thread != MASTER_THREAD)
-				gTaskQueueList[thread]->MeasureStealingDur();
-        #endif
+            MeasureStealingDur(client, thread);
             return WORK_STEALING_INDEX;    // Otherwise will try "workstealing" again next cycle...
         }
-        
+
+        // The workers join the cycle when they are free, possibly late or not at all : the audio thread
+        // executes the first ready task and pushes the other ones, the workers start by stealing
         INLINE void InitTaskList(int task_list_size, int* task_list, int thread_num, int cur_thread, int& tasknum)
         {
-            int task_slice = task_list_size / thread_num;
-            int task_slice_rest = task_list_size % thread_num;
-
-            if (task_slice == 0) {
-                // Each thread directly executes one task
-                tasknum = task_list[cur_thread];
-                // Thread 0 takes remaining ready tasks 
-                if (cur_thread == 0) { 
-                    for (int index = 0; index < task_slice_rest - thread_num; index++) {
-                        PushHead(task_list[task_slice_rest + index]);
-                    }
+            if (cur_thread == MASTER_THREAD) {
+                for (int index = task_list_size - 1; index > 0; index--) {
+                    PushHead(task_list[index]);
                 }
+                tasknum = task_list[0];
             } else {
-                // Each thread takes a part of ready tasks
-                int index;
-                for (index = 0; index < task_slice - 1; index++) {
-                    PushHead(task_list[cur_thread * task_slice + index]);
-                }
-                // Each thread directly executes one task 
-                tasknum = task_list[cur_thread * task_slice + index];
-                // Thread 0 takes remaining ready tasks 
-                if (cur_thread == 0) {
-                    for (index = 0; index < task_slice_rest; index++) {
-                        PushHead(task_list[thread_num * task_slice + index]);
-                    }
-                }
+                tasknum = WORK_STEALING_INDEX;
             }
         }
-        
-        static INLINE void Init()
+
+        // Called by the master thread before each cycle, when the other threads are idle
+        static INLINE void Init(Runnable* client)
         {
-            for (int i = 0; i < THREAD_SIZE; i++) {
-                gTaskQueueList[i] = 0;
+            vector<WorkDeque*>& queues = client->fTaskQueueList;
+            for (size_t i = 0; i < queues.size(); i++) {
+                queues[i]->Reset();
             }
         }
-     
+
 };
 
-struct TaskGraph 
+struct TaskGraph
 {
-    volatile int gTaskList[QUEUE_SIZE];
-    
-    TaskGraph()
+    atomic<int>* gTaskList;
+    int fSize;
+
+    TaskGraph():gTaskList(0), fSize(0)
+    {}
+
+    ~TaskGraph()
+    {
+        delete [] gTaskList;
+    }
+
+    // Called at init time, before any cycle : allocates the activation counters of 'size' tasks
+    void Init(int size)
     {
-        for (int i = 0; i < QUEUE_SIZE; i++) {
-            gTaskList[i] = 0;
-        } 
+        delete [] gTaskList;
+        gTaskList = new atomic<int>[size];
+        for (int i = 0; i < size; i++) {
+            gTaskList[i].store(0);
+        }
+        fSize = size;
     }
 
+    // Called by the master thread before each cycle, when the other threads are idle
     INLINE void InitTask(int task, int val)
     {
-        gTaskList[task] = val;
+        assert(task < fSize);
+        gTaskList[task].store(val, memory_order_relaxed);
     }
-    
+
     void Display()
     {
-        for (int i = 0; i < QUEUE_SIZE; i++) {
-            printf("Task = %d activation = %d\n", i, gTaskList[i]);
-        } 
+        for (int i = 0; i < fSize; i++) {
+            printf("Task = %d activation = %d\n", i, gTaskList[i].load());
+        }
     }
-      
+
     INLINE void ActivateOutputTask(TaskQueue& queue, int task, int& tasknum)
     {
         if (DEC_ATOMIC(&gTaskList[task]) == 1) {
@@ -380,37 +641,34 @@ struct TaskGraph
             } else {
                 queue.PushHead(task);
             }
-        }    
+        }
     }
-      
+
     INLINE void ActivateOutputTask(TaskQueue& queue, int task)
     {
         if (DEC_ATOMIC(&gTaskList[task]) == 1) {
             queue.PushHead(task);
         }
     }
-    
+
     INLINE void ActivateOneOutputTask(TaskQueue& queue, int task, int& tasknum)
     {
         if (DEC_ATOMIC(&gTaskList[task]) == 1) {
             tasknum = task;
         } else {
-            tasknum = queue.PopHead(); 
+            tasknum = queue.PopHead();
         }
     }
-    
+
     INLINE void GetReadyTask(TaskQueue& queue, int& tasknum)
     {
         if (tasknum == WORK_STEALING_INDEX) {
             tasknum = queue.PopHead();
         }
     }
- 
-};
 
+};
 
-#define THREAD_POOL_SIZE 16
-#define JACK_SCHED_POLICY SCHED_FIFO
 
 /* use 512KB stack per thread - the default is way too high to be feasible
  * with mlockall() on many systems */
@@ -456,11 +714,11 @@ static int SetThreadToPriority(pthread_t thread, UInt32 inPriority, Boolean inIs
         thread_extended_policy_data_t theFixedPolicy;
         thread_precedence_policy_data_t thePrecedencePolicy;
         SInt32 relativePriority;
-        
+
         // [1] SET FIXED / NOT FIXED
         theFixedPolicy.timeshare = !inIsFixed;
         thread_policy_set(pthread_mach_thread_np(thread), THREAD_EXTENDED_POLICY, (thread_policy_t)&theFixedPolicy, THREAD_EXTENDED_POLICY_COUNT);
-        
+
         // [2] SET PRECEDENCE
         // N.B.: We expect that if thread A created thread B, and the program wishes to change
         // the priority of thread B, then the call to change the priority of thread B must be
@@ -469,7 +727,7 @@ static int SetThreadToPriority(pthread_t thread, UInt32 inPriority, Boolean inIs
         // of the feeder thread (since precedency policy's importance is relative to the
         // spawning thread's priority.)
         relativePriority = inPriority - GetThreadSetPriority(pthread_self());
-        
+
         thePrecedencePolicy.importance = relativePriority;
         kern_return_t res = thread_policy_set(pthread_mach_thread_np(thread), THREAD_PRECEDENCE_POLICY, (thread_policy_t)&thePrecedencePolicy, THREAD_PRECEDENCE_POLICY_COUNT);
         return (res == KERN_SUCCESS) ? 0 : -1;
@@ -481,11 +739,11 @@ static UInt32 GetThreadPriority(pthread_t thread, int inWhichPriority)
     thread_basic_info_data_t threadInfo;
     policy_info_data_t thePolicyInfo;
     unsigned int count;
-    
+
     // get basic info
     count = THREAD_BASIC_INFO_COUNT;
     thread_info(pthread_mach_thread_np(thread), THREAD_BASIC_INFO, (thread_info_t)&threadInfo, &count);
-    
+
     switch (threadInfo.policy) {
         case POLICY_TIMESHARE:
             count = POLICY_TIMESHARE_INFO_COUNT;
@@ -496,7 +754,7 @@ static UInt32 GetThreadPriority(pthread_t thread, int inWhichPriority)
                 return thePolicyInfo.ts.base_priority;
             }
             break;
-            
+
         case POLICY_FIFO:
             count = POLICY_FIFO_INFO_COUNT;
             thread_info(pthread_mach_thread_np(thread), THREAD_SCHED_FIFO_INFO, (thread_info_t)&(thePolicyInfo.fifo), &count);
@@ -505,7 +763,7 @@ static UInt32 GetThreadPriority(pthread_t thread, int inWhichPriority)
             }
             return thePolicyInfo.fifo.base_priority;
             break;
-            
+
         case POLICY_RR:
             count = POLICY_RR_INFO_COUNT;
             thread_info(pthread_mach_thread_np(thread), THREAD_SCHED_RR_INFO, (thread_info_t)&(thePolicyInfo.rr), &count);
@@ -515,7 +773,7 @@ static UInt32 GetThreadPriority(pthread_t thread, int inWhichPriority)
             return thePolicyInfo.rr.base_priority;
             break;
     }
-    
+
     return 0;
 }
 
@@ -524,7 +782,7 @@ static int GetParams(pthread_t thread, UInt64* period, UInt64* computation, UInt
     thread_time_constraint_policy_data_t theTCPolicy;
     mach_msg_type_number_t count = THREAD_TIME_CONSTRAINT_POLICY_COUNT;
     boolean_t get_default = false;
-    
+
     kern_return_t res = thread_policy_get(pthread_mach_thread_np(thread),
                                           THREAD_TIME_CONSTRAINT_POLICY,
                                           (thread_policy_t)&theTCPolicy,
@@ -556,23 +814,10 @@ INLINE void SetRealTime()
     SetThreadToPriority(pthread_self(), 96, true, period, computation, constraint);
 }
 
-void CancelThread(pthread_t fThread)
-{
-    mach_port_t machThread = pthread_mach_thread_np(fThread);
-    thread_terminate(machThread);
-}
-
-INLINE void Yield()
-{
-    //sched_yield();
-}
-
-#endif
-
-#ifdef __linux__
+#elif defined(__linux__)
 
 static int faust_sched_policy = -1;
-static struct sched_param faust_rt_param; 
+static struct sched_param faust_rt_param;
 
 INLINE void GetRealTime()
 {
@@ -582,207 +827,186 @@ INLINE void GetRealTime()
     }
 }
 
+// The workers run just below the audio thread
 INLINE void SetRealTime()
 {
-	faust_rt_param.sched_priority--;
-    pthread_setschedparam(pthread_self(), faust_sched_policy, &faust_rt_param);
+    struct sched_param param = faust_rt_param;
+    param.sched_priority--;
+    pthread_setschedparam(pthread_self(), faust_sched_policy, &param);
 }
 
-void CancelThread(pthread_t fThread)
-{
-    pthread_cancel(fThread);
-    pthread_join(fThread, NULL);
-}
+#else
+
+INLINE void GetRealTime()
+{}
+
+INLINE void SetRealTime()
+{}
+
+#endif
 
 INLINE void Yield()
 {
-    pthread_yield();
+    this_thread::yield();
 }
 
+/**
+ * Semaphore used to wake up a sleeping worker : posting it does not take any lock,
+ * so it can be done by the audio thread.
+ */
+class DSPSemaphore {
 
-#endif
+    private:
 
-#define KDSPMESURE 50
+    #ifdef __APPLE__
+        semaphore_t fSemaphore;
+    #else
+        sem_t fSemaphore;
+    #endif
 
-static INLINE int Range(int min, int max, int val)
-{
-    if (val < min) {
-        return min;
-    } else if (val > max) {
-        return max;
-    } else {
-        return val;
-    }
-}
+    public:
 
-struct Runnable {
-    
-    UInt64 fTiming[KDSPMESURE];
-    UInt64 fStart;
-    UInt64 fStop;
-    int fCounter;
-    float fOldMean;
-    int fOldfDynamicNumThreads;
-    bool fDynAdapt;
-    
-    virtual void computeThread(int cur_thread) = 0;
-    
-    Runnable():fCounter(0), fOldMean(1000000000.f), fOldfDynamicNumThreads(1)
-    {
-    	memset(fTiming, 0, sizeof(long long int ) * KDSPMESURE);
-        fDynAdapt = getenv("OMP_DYN_THREAD") ? strtol(getenv("OMP_DYN_THREAD"), NULL, 10) : false;
-    }
-    
-    INLINE float ComputeMean()
-    {
-        float mean = 0;
-        for (int i = 0; i < KDSPMESURE; i++) {
-            mean += float(fTiming[i]);
-        }
-        mean /= float(KDSPMESURE);
-        return mean;
-    }
-    
-    INLINE void StartMeasure()
-    {
-        if (!fDynAdapt)
-            return;
-        
-        fStart = DSP_rdtsc();
-    }
-     
-    INLINE void StopMeasure(int staticthreadnum, int& dynthreadnum)
-    {
-        if (!fDynAdapt)
-            return;
-        
-        fStop = DSP_rdtsc();
-        fCounter = (fCounter + 1) % KDSPMESURE;
-        if (fCounter == 0) {
-            float mean = ComputeMean();
-            if (fabs(mean - fOldMean) > 5000) {
-                if (mean > fOldMean) { // Worse...
-                    //printf("Worse %f %f\n", mean, fOldMean);
-                    if (fOldfDynamicNumThreads > dynthreadnum) {
-                        fOldfDynamicNumThreads = dynthreadnum;
-                        dynthreadnum += 1;
-                    } else {
-                        fOldfDynamicNumThreads = dynthreadnum;
-                        dynthreadnum -= 1;
-                    }
-                 } else { // Better...
-                    //printf("Better %f %f\n", mean, fOldMean);
-                    if (fOldfDynamicNumThreads > dynthreadnum) {
-                        fOldfDynamicNumThreads = dynthreadnum;
-                        dynthreadnum -= 1;
-                    } else {
-                        fOldfDynamicNumThreads = dynthreadnum;
-                        dynthreadnum += 1;
-                    }
-                }
-                fOldMean = mean;
-                dynthreadnum = Range(1, staticthreadnum, dynthreadnum);
-                //printf("dynthreadnum %d\n", dynthreadnum);
-            }
-        }
-        fTiming[fCounter] = fStop - fStart; 
-    }
-};
+    #ifdef __APPLE__
+        DSPSemaphore() { semaphore_create(mach_task_self(), &fSemaphore, SYNC_POLICY_FIFO, 0); }
+        ~DSPSemaphore() { semaphore_destroy(mach_task_self(), fSemaphore); }
+        void Post() { semaphore_signal(fSemaphore); }
+        void Wait() { while (semaphore_wait(fSemaphore) != KERN_SUCCESS) {} }
+    #else
+        DSPSemaphore() { sem_init(&fSemaphore, 0, 0); }
+        ~DSPSemaphore() { sem_destroy(&fSemaphore); }
+        void Post() { sem_post(&fSemaphore); }
+        void Wait() { while (sem_wait(&fSemaphore) != 0 && errno == EINTR) {} }
+    #endif
 
-struct DSPThread;
+};
 
+/**
+ * The pool of worker threads, shared by all the clients (DSP instances) of the process. Its size
+ * follows the largest number of threads requested by a client, so that several clients don't
+ * oversubscribe the cores. When a client starts a cycle it opens slots (SignalAll) : free workers
+ * join it, and a worker that is done with a client looks for another client in its cycle.
+ */
 struct DSPThreadPool {
-    
-    DSPThread* fThreadPool[THREAD_POOL_SIZE];
-    int fThreadCount; 
-    volatile int fCurThreadCount;
-      
+
+    vector<DSPThread*> fThreadPool;
+    atomic<int> fThreadCount;       ///< number of started workers, fThreadPool is only read below it
+    bool fRealTime;
+
+    atomic<Runnable*> fClients[MAX_CLIENTS];
+    atomic<int> fClientsEnd;        ///< clients are in [0, fClientsEnd[
+    atomic<int> fScanning;          ///< number of workers looking for a client
+    atomic<int> fEpoch;             ///< incremented each time a client opens a cycle
+    atomic<int> fSleeping;          ///< number of workers going to sleep or sleeping
+    atomic<bool> fStopping;
+    mutex fStartMutex;
+
     DSPThreadPool();
     ~DSPThreadPool();
-    
+
     void StartAll(int num, bool realtime);
     void StopAll();
-    void SignalAll(int num, Runnable* runnable);
-    
-    void SignalOne();
-    bool IsFinished();
-    
-    static DSPThreadPool* Init();
-    static void Destroy();
-    
+    void Grow(int num);
+    void SignalAll(int num, Runnable* client);
+    bool IsFinished(Runnable* client);
+
+    void AddClient(Runnable* client);
+    void RemoveClient(Runnable* client);
+    Runnable* FindClient(int start, int& slot);
+    void Wait(DSPThread* thread, int epoch);
+    bool WakeUp(DSPThread* thread);
+
+    static DSPThreadPool* Init(Runnable* client);
+    static void Destroy(Runnable* client);
+
 };
 
+/**
+ * A worker thread. It helps the clients of the pool that are in their cycle, then spins for
+ * gMaxSpinning, then sleeps on its semaphore until a client opens a new cycle.
+ */
 struct DSPThread {
 
     pthread_t fThread;
     DSPThreadPool* fThreadPool;
-    Runnable* fRunnable;
-    sem_t* fSemaphore;
-    char fName[128];
     bool fRealTime;
     int fNum;
-    
-    DSPThread(int num, DSPThreadPool* pool)
+    atomic<bool> fParked;           ///< true when the thread sleeps or is going to, until it is woken up
+    DSPSemaphore fWakeUp;
+
+    DSPThread(int num, DSPThreadPool* pool):fParked(false)
     {
         fNum = num;
         fThreadPool = pool;
-        fRunnable = NULL;
         fRealTime = false;
-        
-        sprintf(fName, "faust_sem_%d_%p", GetPID(), this);
-        
-        if ((fSemaphore = sem_open(fName, O_CREAT, 0777, 0)) == (sem_t*)SEM_FAILED) {
-            printf("Allocate: can't check in named semaphore name = %s err = %s", fName, strerror(errno));
-        }
     }
 
     virtual ~DSPThread()
+    {}
+
+    // Run the cycles of the clients until there is nothing to do, returns false when the thread has to quit
+    bool Run()
     {
-        sem_unlink(fName);
-        sem_close(fSemaphore);
-    }
-    
-    void Run()
-    {
-        while (sem_wait(fSemaphore) != 0) {}
-        fRunnable->computeThread(fNum + 1);
-        fThreadPool->SignalOne();
+        long start = DSP_now();
+        for (int i = 0; !fThreadPool->fStopping.load(memory_order_acquire); i++) {
+            int epoch = fThreadPool->fEpoch.load(memory_order_acquire);
+            int slot;
+            Runnable* client = fThreadPool->FindClient(fNum + i, slot);
+            if (client) {
+                long time = DSP_now();
+                client->computeThread(slot);
+                client->LeaveCycle(DSP_now() - time);
+                return true;
+            } else if ((DSP_now() - start) > gMaxSpinning) {
+                fThreadPool->Wait(this, epoch);
+                start = DSP_now();
+            } else {
+                NOP();
+            }
+        }
+        return false;
     }
-    
+
     static void* ThreadHandler(void* arg)
     {
         DSPThread* thread = static_cast<DSPThread*>(arg);
-        
+
         AVOIDDENORMALS;
-        
+
         // One "dummy" cycle to setup thread
         if (thread->fRealTime) {
-            thread->Run();
+            if (!thread->Run()) {
+                return NULL;
+            }
             SetRealTime();
         }
-                  
-        while (true) {
-            thread->Run();
-        }
-        
+
+        while (thread->Run()) {}
+
         return NULL;
     }
-    
+    // A real time worker is given the priority of the calling thread minus one when the caller is real time,
+    // otherwise it takes the scheduling of the audio thread after its first cycle (SetRealTime)
     int Start(bool realtime)
     {
         pthread_attr_t attributes;
         struct sched_param rt_param;
         pthread_attr_init(&attributes);
-        
-        int priority = 60; // TODO
+
+        int policy;
         int res;
-        
+
         if (realtime) {
             fRealTime = true;
         }else {
             fRealTime = getenv("OMP_REALTIME") ? strtol(getenv("OMP_REALTIME"), NULL, 10) : true;
         }
-                               
+
+        memset(&rt_param, 0, sizeof(rt_param));
+        pthread_getschedparam(pthread_self(), &policy, &rt_param);
+        if (policy != SCHED_FIFO && policy != SCHED_RR) {
+            realtime = false;
+        }
+
         if ((res = pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_JOINABLE))) {
             printf("Cannot request joinable thread creation for real-time thread res = %d err = %s\n", res, strerror(errno));
             return -1;
@@ -794,19 +1018,18 @@ struct DSPThread {
         }
 
         if (realtime) {
-            
+
             if ((res = pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED))) {
                 printf("Cannot request explicit scheduling for RT thread res = %d err = %s\n", res, strerror(errno));
                 return -1;
             }
-        
-            if ((res = pthread_attr_setschedpolicy(&attributes, JACK_SCHED_POLICY))) {
+
+            if ((res = pthread_attr_setschedpolicy(&attributes, policy))) {
                 printf("Cannot set RR scheduling class for RT thread res = %d err = %s\n", res, strerror(errno));
                 return -1;
             }
-            
-            memset(&rt_param, 0, sizeof(rt_param));
-            rt_param.sched_priority = priority;
+
+            rt_param.sched_priority = max(rt_param.sched_priority - 1, sched_get_priority_min(policy));
 
             if ((res = pthread_attr_setschedparam(&attributes, &rt_param))) {
                 printf("Cannot set scheduling priority for RT thread res = %d err = %s\n", res, strerror(errno));
@@ -814,18 +1037,18 @@ struct DSPThread {
             }
 
         } else {
-            
+
             if ((res = pthread_attr_setinheritsched(&attributes, PTHREAD_INHERIT_SCHED))) {
                 printf("Cannot request explicit scheduling for RT thread res = %d err = %s\n", res, strerror(errno));
                 return -1;
             }
         }
-     
+
         if ((res = pthread_attr_setstacksize(&attributes, THREAD_STACK))) {
             printf("Cannot set thread stack size res = %d err = %s\n", res, strerror(errno));
             return -1;
         }
-        
+
         if ((res = pthread_create(&fThread, &attributes, ThreadHandler, this))) {
             printf("Cannot create thread res = %d err = %s\n", res, strerror(errno));
             return -1;
@@ -834,88 +1057,182 @@ struct DSPThread {
         pthread_attr_destroy(&attributes);
         return 0;
     }
-    
-    void Signal(bool stop, Runnable* runnable)
-    {
-        fRunnable = runnable;
-        sem_post(fSemaphore);
-    }
-    
+
     void Stop()
     {
-        CancelThread(fThread);
+        pthread_join(fThread, NULL);
     }
 
 };
 
-DSPThreadPool::DSPThreadPool()
+DSPThreadPool::DSPThreadPool():fThreadCount(0), fRealTime(false), fClientsEnd(0), fScanning(0), fEpoch(0), fSleeping(0), fStopping(false)
 {
-    for (int i = 0; i < THREAD_POOL_SIZE; i++) {
-        fThreadPool[i] = NULL;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        fClients[i].store(NULL);
     }
-    fThreadCount = 0;
-    fCurThreadCount = 0;
 }
 
 DSPThreadPool::~DSPThreadPool()
 {
     StopAll();
-    
-    for (int i = 0; i < fThreadCount; i++) {
+
+    for (size_t i = 0; i < fThreadPool.size(); i++) {
         delete(fThreadPool[i]);
-        fThreadPool[i] = NULL;
     }
-    
-    fThreadCount = 0;
+    fThreadPool.clear();
  }
 
+// Can be called several times (by each client), the pool only grows
 void DSPThreadPool::StartAll(int num, bool realtime)
 {
-    if (fThreadCount == 0) {  // Protection for multiple call...  (like LADSPA plug-ins in Ardour)
-        for (int i = 0; i < num; i++) {
-            fThreadPool[i] = new DSPThread(i, this);
-            fThreadPool[i]->Start(realtime);
-            fThreadCount++;
+    lock_guard<mutex> lock(fStartMutex);
+    fRealTime = realtime;
+    Grow(num);
+}
+
+// Clients may grow the pool concurrently, fStartMutex must be held
+void DSPThreadPool::Grow(int num)
+{
+    if (fThreadPool.capacity() < MAX_THREADS) {
+        fThreadPool.reserve(MAX_THREADS);
+    }
+
+    num = min(num, MAX_THREADS);
+    while (int(fThreadPool.size()) < num) {
+        DSPThread* thread = new DSPThread(int(fThreadPool.size()), this);
+        if (thread->Start(fRealTime) != 0) {
+            delete thread;
+            break;
         }
+        fThreadPool.push_back(thread);
+        fThreadCount.store(int(fThreadPool.size()), memory_order_release);
     }
 }
 
 void DSPThreadPool::StopAll()
 {
-    for (int i = 0; i < fThreadCount; i++) {
+    fStopping.store(true);
+    for (size_t i = 0; i < fThreadPool.size(); i++) {
+        WakeUp(fThreadPool[i]);
+    }
+    for (size_t i = 0; i < fThreadPool.size(); i++) {
         fThreadPool[i]->Stop();
     }
 }
 
-void DSPThreadPool::SignalAll(int num, Runnable* runnable)
+// Called by the audio thread : the workers are started by StartAll at init time, the pool does not grow here.
+// No lock is taken : the sleeping workers are woken up by posting their semaphore.
+void DSPThreadPool::SignalAll(int num, Runnable* client)
+{
+    int count = fThreadCount.load(memory_order_acquire);
+    num = client->OpenCycle(min(num, count));
+
+    // Wake up sleeping workers, the workers checking the epoch after this increment won't sleep
+    fEpoch.fetch_add(1);
+    for (int i = 0; i < count && num > 0 && fSleeping.load() > 0; i++) {
+        if (WakeUp(fThreadPool[i])) {
+            num--;
+        }
+    }
+}
+
+// Wake up a sleeping worker, returns false if it was not sleeping
+bool DSPThreadPool::WakeUp(DSPThread* thread)
+{
+    if (thread->fParked.load() && thread->fParked.exchange(false)) {
+        thread->fWakeUp.Post();
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool DSPThreadPool::IsFinished(Runnable* client)
+{
+    if (client->CloseCycle()) {
+        return true;
+    } else {
+        NOP();
+        return false;
+    }
+}
+
+// Sleep until a client opens a new cycle : the thread is parked before checking the epoch, so that
+// a client opening a cycle after the check sees it parked and wakes it up (SignalAll)
+void DSPThreadPool::Wait(DSPThread* thread, int epoch)
+{
+    fSleeping.fetch_add(1);
+    thread->fParked.store(true);
+    if (fEpoch.load() != epoch || fStopping.load()) {
+        // not woken up by a client : the thread unparks itself, otherwise the semaphore is posted
+        if (thread->fParked.exchange(false)) {
+            fSleeping.fetch_sub(1);
+            return;
+        }
+    }
+    thread->fWakeUp.Wait();
+    fSleeping.fetch_sub(1);
+}
+
+// Look for a client with a free slot, visiting the clients from 'start' for fairness
+Runnable* DSPThreadPool::FindClient(int start, int& slot)
 {
-    fCurThreadCount = num;
-        
-    for (int i = 0; i < num; i++) {  // Important : use local num here...
-        fThreadPool[i]->Signal(false, runnable);
+    Runnable* found = NULL;
+    fScanning.fetch_add(1);
+    int end = fClientsEnd.load(memory_order_acquire);
+    for (int i = 0; i < end && !found; i++) {
+        Runnable* client = fClients[(start + i) % end].load(memory_order_acquire);
+        if (client && (slot = client->JoinCycle()) > 0) {
+            found = client;
+        }
     }
+    fScanning.fetch_sub(1);
+    return found;
 }
 
-void DSPThreadPool::SignalOne()
+void DSPThreadPool::AddClient(Runnable* client)
 {
-    DEC_ATOMIC(&fCurThreadCount);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Runnable* empty = NULL;
+        if (fClients[i].compare_exchange_strong(empty, client)) {
+            int end = fClientsEnd.load();
+            while (end < i + 1 && !fClientsEnd.compare_exchange_weak(end, i + 1)) {}
+            return;
+        }
+    }
+    printf("DSPThreadPool : too many clients, the workers won't help the new one\n");
 }
 
-bool DSPThreadPool::IsFinished()
+void DSPThreadPool::RemoveClient(Runnable* client)
 {
-    return (fCurThreadCount == 0);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Runnable* cur = client;
+        if (fClients[i].compare_exchange_strong(cur, NULL)) {
+            break;
+        }
+    }
+    // A worker may still be reading the client
+    while (fScanning.load() > 0) {
+        Yield();
+    }
 }
 
-DSPThreadPool* DSPThreadPool::Init()
+DSPThreadPool* DSPThreadPool::Init(Runnable* client)
 {
+    lock_guard<mutex> lock(gPoolMutex);
     if (gClientCount++ == 0 && !gThreadPool) {
         gThreadPool = new DSPThreadPool();
     }
+    gThreadPool->AddClient(client);
     return gThreadPool;
 }
 
-void DSPThreadPool::Destroy()
+void DSPThreadPool::Destroy(Runnable* client)
 {
+    lock_guard<mutex> lock(gPoolMutex);
+    if (gThreadPool) {
+        gThreadPool->RemoveClient(client);
+    }
     if (--gClientCount == 0 && gThreadPool) {
         delete gThreadPool;
         gThreadPool = NULL;
@@ -925,18 +1242,12 @@ void DSPThreadPool::Destroy()
 #ifndef PLUG_IN
 
 // Globals
-TaskQueue* gTaskQueueList[THREAD_SIZE] = {0};
-
 DSPThreadPool* gThreadPool = 0;
 int gClientCount = 0;
+mutex gPoolMutex;
 
-int clock_per_microsec = (getenv("CLOCKSPERSEC") 
-                ? strtoll(getenv("CLOCKSPERSEC"), NULL, 10) 
-                : DEFAULT_CLOCKSPERSEC) / 1000000;
-                
-UInt64  gMaxStealing = getenv("OMP_STEALING_DUR") 
-                ? strtoll(getenv("OMP_STEALING_DUR"), NULL, 10) * clock_per_microsec 
-                : MAX_STEAL_DUR * clock_per_microsec;
+// Durations in nsec, the environment variables are in usec
+long gMaxStealing = (getenv("OMP_STEALING_DUR") ? strtol(getenv("OMP_STEALING_DUR"), NULL, 10) : MAX_STEAL_DUR) * 1000;
+long gMaxSpinning = (getenv("OMP_SPINNING_DUR") ? strtol(getenv("OMP_SPINNING_DUR"), NULL, 10) : MAX_SPIN_DUR) * 1000;
 
 #endif
-
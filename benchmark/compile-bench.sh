@@ -0,0 +1,18 @@
+#!/bin/bash
+# Measure the compilation time of the .dsp files of this folder and collect the
+# phase durations, tree and property statistics printed by 'faust -time'.
+# usage : ./compile-bench.sh [faust options]
+FAUST=${FAUST:-faust}
+DST=compile-results-$(date +%y%m%d.%H%M%S)
+
+echo "Faust compilation benchmark : " $@ > $DST
+uname -a >> $DST
+date >> $DST
+for f in *.dsp; do
+	echo $f >> $DST
+	$FAUST -time $@ $f -o /dev/null 2> $DST.log
+	grep -E "^end " $DST.log | sed -e 's/^end /	/' >> $DST
+	grep -E "^(parser|tree|properties)" $DST.log | sed -e 's/^/	/' >> $DST
+done
+rm -f $DST.log
+cat $DST
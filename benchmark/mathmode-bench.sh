@@ -0,0 +1,28 @@
+#!/bin/bash
+# Compare the implementations of the elementary functions (faust -mm exact, fast
+# and table) on the .dsp files of this folder : throughput of the generated code
+# and maximum difference of the output samples with the exact mode.
+# usage : ./mathmode-bench.sh [faust options]
+FAUST=${FAUST:-faust}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-O3 -march=native"}
+DST=mathmode-results-$(date +%y%m%d.%H%M%S)
+TMP=mathmode-dir
+
+install -d $TMP
+echo "Faust math modes benchmark : " $@ > $DST
+uname -a >> $DST
+date >> $DST
+for f in *.dsp; do
+	for m in exact fast table; do
+		b=$TMP/${f%.dsp}-$m
+		$FAUST -mm $m $@ -a offline-bench.cpp $f -o $b.cpp || continue
+		$CXX $CXXFLAGS -I../architecture $b.cpp -o $b || continue
+		if [ $m == exact ]; then
+			printf "%-20s %-6s" $f $m >> $DST; $b -w $TMP/${f%.dsp}.raw >> $DST
+		else
+			printf "%-20s %-6s" $f $m >> $DST; $b -r $TMP/${f%.dsp}.raw >> $DST
+		fi
+	done
+done
+cat $DST
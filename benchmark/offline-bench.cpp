@@ -0,0 +1,111 @@
+/* link with : "" */
+/*
+ * Offline architecture used by 'mathmode-bench.sh' : the DSP processes
+ * kCycles buffers of white noise with the default values of its controls.
+ * The throughput of the compute method is printed in MB/s. The output
+ * samples can be written to a file (-w <file>) and compared to the ones
+ * of a previous run (-r <file>) to measure the maximum difference.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "faust/dsp/dsp.h"
+#include "faust/gui/UI.h"
+#include "faust/audio/channels.h"
+
+using namespace std;
+
+struct Meta
+{
+    void declare(const char* key, const char* value) {}
+};
+
+//----------------------------------------------------------------------------
+//FAUST generated code
+// ----------------------------------------------------------------------------
+
+<<includeIntrinsic>>
+
+<<includeclass>>
+
+mydsp DSP;
+
+#define kFrames 256
+#define kCycles 2000
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* wfile = 0;
+    const char* rfile = 0;
+
+    for (int i = 1; i < argc-1; i++) {
+        if (strcmp(argv[i], "-w") == 0) wfile = argv[i+1];
+        if (strcmp(argv[i], "-r") == 0) rfile = argv[i+1];
+    }
+
+    DSP.init(44100);
+
+    int nins = DSP.getNumInputs();
+    int nouts = DSP.getNumOutputs();
+    channels ichan(kFrames, nins);
+    channels ochan(kFrames, nouts);
+    vector<float> output;
+    unsigned int seed = 12345;
+    double duration = 0;
+
+    for (int c = 0; c < kCycles; c++) {
+        for (int i = 0; i < nins; i++) {
+            for (int f = 0; f < kFrames; f++) {
+                seed = seed * 1103515245 + 12345;
+                ichan.buffers()[i][f] = FAUSTFLOAT(int(seed >> 16) & 0x7fff) / FAUSTFLOAT(16384) - FAUSTFLOAT(1);
+            }
+        }
+        double start = now();
+        DSP.compute(kFrames, ichan.buffers(), ochan.buffers());
+        duration += now() - start;
+        for (int i = 0; i < nouts; i++) {
+            output.insert(output.end(), ochan.buffers()[i], ochan.buffers()[i] + kFrames);
+        }
+    }
+
+    double bytes = double(kCycles) * kFrames * (nins + nouts) * sizeof(FAUSTFLOAT);
+    printf("%10.2f MB/s", bytes / duration / 1e6);
+
+    if (wfile) {
+        FILE* f = fopen(wfile, "wb");
+        if (f) {
+            fwrite(&output[0], sizeof(float), output.size(), f);
+            fclose(f);
+        }
+    }
+    if (rfile) {
+        vector<float> ref(output.size());
+        FILE* f = fopen(rfile, "rb");
+        if (f && fread(&ref[0], sizeof(float), ref.size(), f) == ref.size()) {
+            double error = 0;
+            for (size_t i = 0; i < ref.size(); i++) {
+                error = max(error, fabs(double(output[i]) - double(ref[i])));
+            }
+            printf("   max error %g", error);
+        } else {
+            printf("   no reference");
+        }
+        if (f) fclose(f);
+    }
+    printf("\n");
+    return 0;
+}
@@ -50,6 +50,7 @@ HEADERS += boxes/boxcomplexity.h \
            evaluate/environment.hh \
            evaluate/eval.hh \
            evaluate/loopDetector.hh \
+           extended/mathmode.hh \
            extended/xtended.hh \
            generator/compile.hh \
            generator/compile_scal.hh \
@@ -61,6 +62,9 @@ HEADERS += boxes/boxcomplexity.h \
            generator/klass.hh \
            generator/occurences.hh \
            generator/Text.hh \
+           generator/fieldlayout.hh \
+           generator/lanesklass.hh \
+           generator/simdkernel.hh \
            generator/uitree.hh \
            normalize/aterm.hh \
            normalize/mterm.hh \
@@ -72,6 +76,7 @@ HEADERS += boxes/boxcomplexity.h \
            parallelize/loop.hh \
            parser/enrobage.hh \
            parser/faustparser.hpp \
+           parser/parsecache.hh \
            parser/sourcefetcher.hh \
            parser/sourcereader.hh \
            patternmatcher/patternmatcher.hh \
@@ -79,9 +84,12 @@ HEADERS += boxes/boxcomplexity.h \
            propagate/propagate.hh \
            signals/binop.hh \
            signals/interval.hh \
+           signals/intervalreport.hh \
            signals/ppsig.hh \
            signals/prim2.hh \
            signals/recursivness.hh \
+           signals/sigcost.hh \
+           signals/sigeval.hh \
            signals/signals.hh \
            signals/sigorderrules.hh \
            signals/sigprint.hh \
@@ -99,6 +107,7 @@ HEADERS += boxes/boxcomplexity.h \
            tlib/symbol.hh \
            tlib/tlib.hh \
            tlib/tree.hh \
+           utils/compilecache.hh \
            utils/files.hh \
            utils/names.hh \
            draw/device/device.h \
@@ -152,6 +161,7 @@ SOURCES += main.cpp \
            extended/fmodprim.cpp \
            extended/log10prim.cpp \
            extended/logprim.cpp \
+           extended/mathmode.cpp \
            extended/maxprim.cpp \
            extended/minprim.cpp \
            extended/powprim.cpp \
@@ -171,6 +181,9 @@ SOURCES += main.cpp \
            generator/occurences.cpp \
            generator/sharing.cpp \
            generator/Text.cpp \
+           generator/fieldlayout.cpp \
+           generator/lanesklass.cpp \
+           generator/simdkernel.cpp \
            generator/uitree.cpp \
            normalize/aterm.cpp \
            normalize/mterm.cpp \
@@ -183,15 +196,19 @@ SOURCES += main.cpp \
            parser/enrobage.cpp \
            parser/faustlexer.cpp \
            parser/faustparser.cpp \
+           parser/parsecache.cpp \
            parser/sourcefetcher.cpp \
            parser/sourcereader.cpp \
            patternmatcher/patternmatcher.cpp \
            propagate/labels.cpp \
            propagate/propagate.cpp \
            signals/binop.cpp \
+           signals/intervalreport.cpp \
            signals/ppsig.cpp \
            signals/prim2.cpp \
            signals/recursivness.cpp \
+           signals/sigcost.cpp \
+           signals/sigeval.cpp \
            signals/signals.cpp \
            signals/sigorderrules.cpp \
            signals/sigprint.cpp \
@@ -203,10 +220,12 @@ SOURCES += main.cpp \
            tlib/list.cpp \
            tlib/node.cpp \
            tlib/occurrences.cpp \
+           tlib/property.cpp \
            tlib/recursive-tree.cpp \
            tlib/shlysis.cpp \
            tlib/symbol.cpp \
            tlib/tree.cpp \
+           utils/compilecache.cpp \
            utils/files.cpp \
            utils/names.cpp \
            draw/device/PSDev.cpp \
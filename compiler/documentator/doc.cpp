@@ -90,7 +90,7 @@ using namespace std ;
  *****************************************************************************/
 
 extern Tree						gExpandedDefList;
-extern map<Tree, set<Tree> > 	gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> 	gMetaDataSet;
 extern map<string, string>		gDocMetadatasStringMap;
 extern map<string, string>		gDocMathStringMap;
 extern bool            			gDetailsSwitch;
@@ -301,9 +301,9 @@ static void printDocMetadata(const Tree expr, ostream& docout)
 {
 	if (gMetaDataSet.count(expr)) {
 		string sep = "";
-		set<Tree> mset = gMetaDataSet[expr];
+		set<Tree, treeLess> mset = gMetaDataSet[expr];
 		
-		for (set<Tree>::iterator j = mset.begin(); j != mset.end(); j++) {
+		for (set<Tree, treeLess>::iterator j = mset.begin(); j != mset.end(); j++) {
 			docout << sep << unquote(tree2str(*j));
 			sep = ", ";
 		}
@@ -32,7 +32,7 @@
 
 extern SourceReader				gReader;
 extern string					gDocName;
-extern map<Tree, set<Tree> > 	gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> 	gMetaDataSet;
 extern map<string, string>		gDocMetadatasStringMap;
 
 map<string, string>		gDocAutodocStringMap;
@@ -95,7 +95,7 @@ void declareAutoDoc()
 	if (! gMetaDataSet.empty()) {
 		autodoc = cons(docTxt("\\begin{tabular}{ll}\n"), autodoc);
 		autodoc = cons(docTxt("\t\\hline\n"), autodoc);
-		for (map<Tree, set<Tree> >::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
+		for (map<Tree, set<Tree, treeLess>, treeLess>::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
 			string mtdkey = tree2str(i->first);
 			string mtdTranslatedKey = gDocMetadatasStringMap[mtdkey];
 			if (mtdTranslatedKey.empty()) {
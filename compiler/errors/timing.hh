@@ -9,6 +9,8 @@ void startTiming (const char* msg);
 
 void endTiming (const char* msg);
 
+double mysecond();     ///< current time in seconds, to accumulate the duration of repeated tasks
+
 #endif
 
 
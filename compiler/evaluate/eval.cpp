@@ -43,6 +43,7 @@
 #include "names.hh"
 #include "compatibility.hh"
 #include <assert.h>
+#include <algorithm>
 
 extern SourceReader	gReader;
 extern int  gMaxNameSize;
@@ -81,6 +82,10 @@ static Tree 	patternSimplification (Tree pattern);
 static bool 	isBoxNumeric (Tree in, Tree& out);
 
 static Tree 	vec2list(const vector<Tree>& v);
+static Tree 	loadFile(Tree label);
+static void 	beginLoadedFiles();
+static void 	endLoadedFiles(Tree exp, Tree key);
+static void 	reloadFiles(Tree exp, Tree key);
 static void 	list2vec(Tree l, vector<Tree>& v);
 static Tree 	listn (int n, Tree e);
 
@@ -109,6 +114,48 @@ Tree evalprocess (Tree eqlist)
 }
 
 
+/**
+ * The environment of the definitions of a component or library file. It is
+ * built once per file and shared by all its uses, including by the following
+ * compilations in batch mode, so that the values memoized with setEvalProperty
+ * in this environment are computed only once.
+ *
+ * @param eqlst the expanded list of definitions of the file
+ * @return the environment of these definitions
+ */
+
+static property<Tree> gFileEnvProperty;
+
+static Tree fileEnv(Tree eqlst)
+{
+    Tree lenv;
+    if (!gFileEnvProperty.get(eqlst, lenv)) {
+        lenv = pushMultiClosureDefs(eqlst, nil, nil);
+        gFileEnvProperty.set(eqlst, lenv);
+    }
+    return lenv;
+}
+
+
+static void preloadrec(Tree t, set<Tree>& visited)
+{
+    Tree label;
+    if (!visited.insert(t).second) return;
+    if (isBoxComponent(t, label) || isBoxLibrary(t, label)) {
+        Tree eqlst = loadFile(label);
+        fileEnv(eqlst);
+        preloadrec(eqlst, visited);
+    }
+    for (int i = 0; i < t->arity(); i++) preloadrec(t->branch(i), visited);
+}
+
+void preloadLibraries(Tree eqlist)
+{
+    set<Tree> visited;
+    preloadrec(eqlist, visited);
+}
+
+
 /* Eval a documentation expression. */
 
 Tree evaldocexpr (Tree docexpr, Tree eqlist)
@@ -129,6 +176,7 @@ Tree evaldocexpr (Tree docexpr, Tree eqlist)
  */
 
 property<Tree> gSymbolicBoxProperty;
+static Tree A2SBFILESPROPERTY = tree(symbol("A2sbFilesProperty"));
 
 static Tree real_a2sb(Tree exp);
 
@@ -138,14 +186,17 @@ static Tree a2sb(Tree exp)
     Tree    id;
 
     if (gSymbolicBoxProperty.get(exp, result)) {
+        if (gReader.reused()) reloadFiles(exp, A2SBFILESPROPERTY);
         return result;
     }
 
+    beginLoadedFiles();
 	result = real_a2sb(exp);
 	if (result != exp && getDefNameProperty(exp, id)) {
 		setDefNameProperty(result, id);		// propagate definition name property when needed
 	}
     gSymbolicBoxProperty.set(exp, result);
+    endLoadedFiles(exp, A2SBFILESPROPERTY);
 	return result;
 }
 
@@ -277,6 +328,8 @@ bool getEvalProperty(Tree box, Tree env, Tree& value)
 }
 
 
+static Node EVALFILESPROPERTY(symbol("EvalFilesProperty"));
+
 static Tree eval (Tree exp, Tree visited, Tree localValEnv)
 {
 	Tree	id;
@@ -285,16 +338,83 @@ static Tree eval (Tree exp, Tree visited, Tree localValEnv)
     if (!getEvalProperty(exp, localValEnv, result)) {
         LD.detect(cons(exp,localValEnv));
         //cerr << "ENTER eval("<< *exp << ") with env " << *localValEnv << endl;
+        beginLoadedFiles();
 		result = realeval(exp, visited, localValEnv);
 		setEvalProperty(exp, localValEnv, result);
         //cerr << "EXIT eval(" << *exp << ") IS " << *result << " with env " << *localValEnv << endl;
 		if (getDefNameProperty(exp, id)) {
 			setDefNameProperty(result, id);		// propagate definition name property 
 		}
-	}
+        endLoadedFiles(exp, tree(EVALFILESPROPERTY, localValEnv));
+	} else if (gReader.reused()) {
+        reloadFiles(exp, tree(EVALFILESPROPERTY, localValEnv));
+    }
 	return result;
 }
 
+
+/**
+ * The files loaded by component() and library() during the computations in progress.
+ * They are memoized with the values computed (see endLoadedFiles), so that a value
+ * computed by a previous compilation in batch mode loads them again and declares their
+ * metadata, like its computation would have done.
+ */
+static vector<vector<Tree> > gLoadedFiles;
+
+static void addLoadedFile(Tree label)
+{
+    if (!gLoadedFiles.empty()) {
+        vector<Tree>& files = gLoadedFiles.back();
+        if (find(files.begin(), files.end(), label) == files.end()) files.push_back(label);
+    }
+}
+
+/**
+ * Load a component or library file : its expanded list of definitions.
+ */
+static Tree loadFile(Tree label)
+{
+    addLoadedFile(label);
+    return gReader.expandlist(gReader.getlist(tree2str(label)));
+}
+
+static void beginLoadedFiles()
+{
+    gLoadedFiles.push_back(vector<Tree>());
+}
+
+/**
+ * Memoize the files loaded since beginLoadedFiles with the value of exp, as property key.
+ */
+static void endLoadedFiles(Tree exp, Tree key)
+{
+    vector<Tree> files;
+    files.swap(gLoadedFiles.back());
+    gLoadedFiles.pop_back();
+    if (!files.empty()) {
+        setProperty(exp, key, vec2list(files));
+        for (size_t i = 0; i < files.size(); i++) addLoadedFile(files[i]);
+    }
+}
+
+/**
+ * Load again the files memoized with the value of exp, when they are not yet used
+ * by the current compilation.
+ */
+static void reloadFiles(Tree exp, Tree key)
+{
+    Tree files;
+    if (getProperty(exp, key, files)) {
+        for (; !isNil(files); files = tl(files)) {
+            if (gReader.used(tree2str(hd(files)))) {
+                addLoadedFile(hd(files));
+            } else {
+                loadFile(hd(files));
+            }
+        }
+    }
+}
+
 /**
  * Eval a block diagram expression.
  *
@@ -386,17 +506,15 @@ static Tree realeval (Tree exp, Tree visited, Tree localValEnv)
 ///////////////////////////////////////////////////////////////////
 
     } else if (isBoxComponent(exp, label)) {
-        const char* fname = tree2str(label);
-        Tree eqlst = gReader.expandlist(gReader.getlist(fname));
-        Tree res = closure(boxIdent("process"), nil, nil, pushMultiClosureDefs(eqlst, nil, nil));
+        Tree eqlst = loadFile(label);
+        Tree res = closure(boxIdent("process"), nil, nil, fileEnv(eqlst));
         setDefNameProperty(res, label);
         //cerr << "component is " << boxpp(res) << endl;
         return res;
 
     } else if (isBoxLibrary(exp, label)) {
-        const char* fname = tree2str(label);
-        Tree eqlst = gReader.expandlist(gReader.getlist(fname));
-        Tree res = closure(boxEnvironment(), nil, nil, pushMultiClosureDefs(eqlst, nil, nil));
+        Tree eqlst = loadFile(label);
+        Tree res = closure(boxEnvironment(), nil, nil, fileEnv(eqlst));
         setDefNameProperty(res, label);
         //cerr << "component is " << boxpp(res) << endl;
         return res;
@@ -50,6 +50,14 @@
 Tree evalprocess (Tree eqlist);
 Tree evaldocexpr (Tree docexpr, Tree eqlist);
 
+/**
+ * Load the component and library files used by a list of definitions, and build their
+ * environments, recursively. Used in batch mode to share them between the compilations.
+ * @param eqlist a list of definitions
+ **/
+
+void preloadLibraries (Tree eqlist);
+
 
 /**
  * Push a new layer and add a single definition.
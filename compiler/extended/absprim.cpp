@@ -50,14 +50,14 @@ class AbsPrim : public xtended
 		}
 	}
 
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
 
 		Type t = infereSigType(types);
 		if (t->nature() == kReal) {
-            return subst("fabs$1($0)", args[0], isuffix());
+            return subst("fabs$1($0)", args[0], isuffix(precision));
 		} else {
 			return subst("abs($0)", args[0]);
 		}
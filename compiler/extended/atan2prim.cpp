@@ -39,12 +39,12 @@ class Atan2Prim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
 		
-        return subst("atan2$2($0,$1)", args[0], args[1], isuffix());
+        return subst("atan2$2($0,$1)", args[0], args[1], isuffix(precision));
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
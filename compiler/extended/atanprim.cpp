@@ -37,12 +37,12 @@ class AtanPrim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
 		
-        return subst("atan$1($0)", args[0], isuffix());
+        return subst("atan$1($0)", args[0], isuffix(precision));
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
@@ -18,7 +18,7 @@ class CeilPrim : public xtended
 	virtual Type 	infereSigType (const vector<Type>& args)
 	{
 		assert (args.size() == arity());
-		return floatCast(args[0]);
+		return castInterval(floatCast(args[0]), integral(args[0]->getInterval()));
 	}
 	
 	virtual void 	sigVisit (Tree sig, sigvisitor* visitor) {}	
@@ -39,12 +39,12 @@ class CeilPrim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
         
-		return subst("ceil$1($0)", args[0], isuffix());
+		return subst("ceil$1($0)", args[0], isuffix(precision));
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
@@ -3,6 +3,7 @@
 #include <math.h>
 
 #include "floats.hh"
+#include "mathmode.hh"
 
 class CosPrim : public xtended
 {
@@ -37,12 +38,12 @@ class CosPrim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
 		
-        return subst("cos$1($0)", args[0], isuffix());
+        return generateMathCall(klass, "cos", args[0], types[0]->getInterval(), types[0]->variability(), precision);
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
@@ -3,6 +3,7 @@
 #include <math.h>
 
 #include "floats.hh"
+#include "intervalreport.hh"
 
 class FmodPrim : public xtended
 {
@@ -46,12 +47,27 @@ class FmodPrim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
+
+        interval i = types[0]->getInterval();
+        interval j = types[1]->getInterval();
+        if (i.valid && j.valid && (j.lo > 0 || j.hi < 0)) {
+            if (max(fabs(i.lo), fabs(i.hi)) < min(fabs(j.lo), fabs(j.hi))) {
+                // |x| < |y| : fmod(x,y) = x
+                countIntervalUse("useless fmod/remainder removed");
+                return argAsResult(args[0], types[0], types, precision);
+            } else if (j.lo == j.hi && i.lo >= 0 && i.hi < 2*j.lo) {
+                // 0 <= x < 2y : at most one subtraction, exact since y <= x < 2y
+                countIntervalUse("fmod replaced by a conditional subtraction");
+                string x = argAsResult(args[0], types[0], types, precision);
+                return subst("(($0 >= $1) ? ($0 - $1) : $0)", x, args[1]);
+            }
+        }
         
-		return subst("fmod$2($0,$1)", args[0], args[1], isuffix());
+		return subst("fmod$2($0,$1)", args[0], args[1], isuffix(precision));
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
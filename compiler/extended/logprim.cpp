@@ -3,6 +3,8 @@
 #include <math.h>
 
 #include "floats.hh"
+#include "mathmode.hh"
+#include "signals.hh"
 
 class LogPrim : public xtended
 {
@@ -39,17 +41,20 @@ class LogPrim : public xtended
 		assert (args.size() == arity());
 		if (isNum(args[0],n)) {
 			return tree(log(double(n)));
+		} else if (getUserData(args[0]) == gExpPrim) {
+			// log(exp(x)) => x
+			return sigFloatCast(args[0]->branch(0));
 		} else {
 			return tree(symbol(), args[0]);
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
         
-		return subst("log$1($0)", args[0], isuffix());
+		return generateMathCall(klass, "log", args[0], types[0]->getInterval(), types[0]->variability(), precision);
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
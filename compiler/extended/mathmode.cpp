@@ -0,0 +1,310 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#include <math.h>
+#include <map>
+#include <set>
+
+#include "mathmode.hh"
+#include "floats.hh"
+#include "Text.hh"
+
+using namespace std;
+
+extern int gFloatSize;
+
+/**
+ * Fast functions in single precision. exp and log use Cody-Waite range reductions
+ * followed by a Taylor polynomial of degree 7 (exp) and a 9th order atanh series
+ * (log). sin and cos are reduced to [-pi/4, pi/4] by a multiple of pi/2 (three
+ * parts constant, accurate for |x| < 1e4) and use the minimax polynomials of
+ * Cephes for sin and cos on this interval, chosen by the quadrant.
+ * The exponent of exp is clamped as an integer : a float clamp before the conversion
+ * prevents gcc from vectorizing the loops.
+ */
+static const char* gFastMathFloat[] = {
+    "inline float faustfastexp(float x)",
+    "{",
+    "    int n = int(x * 1.44269504f + 128.5f) - 128;",
+    "    n = (n < -126) ? -126 : ((n > 127) ? 127 : n);",
+    "    float f = (x - float(n) * 0.693359375f) + float(n) * 2.12194440e-4f;",
+    "    f = (f < -0.5f) ? -0.5f : ((f > 0.5f) ? 0.5f : f);",
+    "    float p = 1.0f + f * (1.0f + f * (0.5f + f * (0.166666667f + f * (0.0416666667f + f * (0.00833333333f + f * (0.00138888889f + f * 1.98412698e-4f))))));",
+    "    union { float f; int i; } u;",
+    "    u.i = (n + 127) << 23;",
+    "    return p * u.f;",
+    "}",
+    "inline float faustfastlog(float x)",
+    "{",
+    "    union { float f; int i; } u;",
+    "    u.f = x;",
+    "    int e = ((u.i >> 23) & 255) - 127;",
+    "    u.i = (u.i & 0x7fffff) | 0x3f800000;",
+    "    float m = (u.f > 1.41421356f) ? u.f * 0.5f : u.f;",
+    "    e = (u.f > 1.41421356f) ? e + 1 : e;",
+    "    float s = (m - 1.0f) / (m + 1.0f);",
+    "    float s2 = s * s;",
+    "    return (float(e) * 0.693359375f - float(e) * 2.12194440e-4f) + 2.0f * s * (1.0f + s2 * (0.333333333f + s2 * (0.2f + s2 * (0.142857143f + s2 * 0.111111111f))));",
+    "}",
+    "inline float faustfastlog10(float x) { return faustfastlog(x) * 0.434294482f; }",
+    "inline float faustfastreduce(float a, int& k)",
+    "{",
+    "    k = int(a * 0.636619772f + 0.5f);",
+    "    float y = float(k);",
+    "    return ((a - y * 1.5703125f) - y * 4.83751297e-4f) - y * 7.54978995e-8f;",
+    "}",
+    "inline float faustfastquadrant(float r, int k)",
+    "{",
+    "    float r2 = r * r;",
+    "    float s = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));",
+    "    float c = (1.0f - 0.5f * r2) + r2 * r2 * (4.166664568e-2f + r2 * (-1.388731625e-3f + r2 * 2.443315711e-5f));",
+    "    float v = (k & 1) ? c : s;",
+    "    return (k & 2) ? -v : v;",
+    "}",
+    "inline float faustfastsin(float x)",
+    "{",
+    "    int k;",
+    "    float r = faustfastreduce((x < 0.0f) ? -x : x, k);",
+    "    float v = faustfastquadrant(r, k);",
+    "    return (x < 0.0f) ? -v : v;",
+    "}",
+    "inline float faustfastcos(float x)",
+    "{",
+    "    int k;",
+    "    float r = faustfastreduce((x < 0.0f) ? -x : x, k);",
+    "    return faustfastquadrant(r, k + 1);",
+    "}",
+    "inline float faustfasttan(float x) { return faustfastsin(x) / faustfastcos(x); }",
+    0
+};
+
+/**
+ * Fast functions in double precision : same algorithms with a polynomial of
+ * degree 13 (exp), a 21st order atanh series (log), and the double precision
+ * Cephes polynomials for sin and cos (accurate for |x| < 1e6)
+ */
+static const char* gFastMathDouble[] = {
+    "inline double faustfastexp(double x)",
+    "{",
+    "    int n = int(x * 1.4426950408889634 + 1024.5) - 1024;",
+    "    n = (n < -1022) ? -1022 : ((n > 1023) ? 1023 : n);",
+    "    double f = (x - double(n) * 6.93147180369123816490e-01) - double(n) * 1.90821492927058770002e-10;",
+    "    f = (f < -0.5) ? -0.5 : ((f > 0.5) ? 0.5 : f);",
+    "    double p = 1.0 + f * (1.0 + f * (0.5 + f * (0.16666666666666666 + f * (0.041666666666666664 + f * (0.008333333333333333",
+    "             + f * (0.001388888888888889 + f * (0.0001984126984126984 + f * (2.48015873015873e-05 + f * (2.7557319223985893e-06",
+    "             + f * (2.755731922398589e-07 + f * (2.505210838544172e-08 + f * (2.08767569878681e-09 + f * 1.6059043836821613e-10))))))))))));",
+    "    union { double f; long long i; } u;",
+    "    u.i = (long long)(n + 1023) << 52;",
+    "    return p * u.f;",
+    "}",
+    "inline double faustfastlog(double x)",
+    "{",
+    "    union { double f; long long i; } u;",
+    "    u.f = x;",
+    "    int e = int((u.i >> 52) & 2047) - 1023;",
+    "    u.i = (u.i & 0xfffffffffffffLL) | 0x3ff0000000000000LL;",
+    "    double m = (u.f > 1.4142135623730951) ? u.f * 0.5 : u.f;",
+    "    e = (u.f > 1.4142135623730951) ? e + 1 : e;",
+    "    double s = (m - 1.0) / (m + 1.0);",
+    "    double s2 = s * s;",
+    "    return (double(e) * 6.93147180369123816490e-01 + double(e) * 1.90821492927058770002e-10)",
+    "           + 2.0 * s * (1.0 + s2 * (0.3333333333333333 + s2 * (0.2 + s2 * (0.14285714285714285 + s2 * (0.1111111111111111",
+    "           + s2 * (0.09090909090909091 + s2 * (0.07692307692307693 + s2 * (0.06666666666666667 + s2 * (0.058823529411764705",
+    "           + s2 * (0.05263157894736842 + s2 * 0.047619047619047616))))))))));",
+    "}",
+    "inline double faustfastlog10(double x) { return faustfastlog(x) * 0.43429448190325176; }",
+    "inline double faustfastreduce(double a, int& k)",
+    "{",
+    "    k = int(a * 0.63661977236758134 + 0.5);",
+    "    double y = double(k);",
+    "    return ((a - y * 1.57079625129699707031) - y * 7.54978941586159635336e-08) - y * 5.39030285815811905290e-15;",
+    "}",
+    "inline double faustfastquadrant(double r, int k)",
+    "{",
+    "    double r2 = r * r;",
+    "    double s = r + r * r2 * (-1.66666666666666307295e-1 + r2 * (8.33333333332211858878e-3 + r2 * (-1.98412698295895385996e-4",
+    "             + r2 * (2.75573136213857245213e-6 + r2 * (-2.50507477628578072866e-8 + r2 * 1.58962301576546568060e-10)))));",
+    "    double c = (1.0 - 0.5 * r2) + r2 * r2 * (4.16666666666665929218e-2 + r2 * (-1.38888888888730564116e-3 + r2 * (2.48015872888517045348e-5",
+    "             + r2 * (-2.75573141792967388112e-7 + r2 * (2.08757008419747316778e-9 + r2 * -1.13585365213876817300e-11)))));",
+    "    double v = (k & 1) ? c : s;",
+    "    return (k & 2) ? -v : v;",
+    "}",
+    "inline double faustfastsin(double x)",
+    "{",
+    "    int k;",
+    "    double r = faustfastreduce((x < 0.0) ? -x : x, k);",
+    "    double v = faustfastquadrant(r, k);",
+    "    return (x < 0.0) ? -v : v;",
+    "}",
+    "inline double faustfastcos(double x)",
+    "{",
+    "    int k;",
+    "    double r = faustfastreduce((x < 0.0) ? -x : x, k);",
+    "    return faustfastquadrant(r, k + 1);",
+    "}",
+    "inline double faustfasttan(double x) { return faustfastsin(x) / faustfastcos(x); }",
+    0
+};
+
+/**
+ * Linear interpolation in a table of n+1 values of a function sampled over
+ * [lo, lo + n/scale], the argument being clamped to this interval
+ */
+static const char* gMathTable[] = {
+    "inline $0 faustmathtable(const $0* tbl, $0 lo, $0 scale, int n, $0 x)",
+    "{",
+    "    $0 p = (x - lo) * scale;",
+    "    p = (p < 0) ? 0 : ((p > n) ? n : p);",
+    "    int i = int(p);",
+    "    i = (i < n) ? i : n - 1;",
+    "    $0 f = p - i;",
+    "    return tbl[i] + f * (tbl[i + 1] - tbl[i]);",
+    "}",
+    0
+};
+
+static set<int> gFastMathPrecisions;      ///< precisions of the fast functions used by the generated code
+static set<int> gMathTablePrecisions;     ///< precisions of the table interpolations used by the generated code
+
+static map<string, string> gMathTables;    ///< names of the static tables already generated, indexed by function and interval
+
+static bool isFastFunction (const string& fun)
+{
+    return (fun == "sin") || (fun == "cos") || (fun == "tan") || (fun == "exp") || (fun == "log") || (fun == "log10");
+}
+
+/**
+ * Size of the table of fun over the interval i such that the error of the linear
+ * interpolation, h^2/8 max|f''|, stays below 1e-6 (relative for exp). Returns
+ * false when the interval is not bounded, is outside of the domain of the
+ * function or needs a table larger than 65536.
+ */
+static bool mathTableSize (const string& fun, const interval& i, int& size)
+{
+    if (!i.valid || !(i.lo < i.hi) || (i.lo < -1e6) || (i.hi > 1e6)) return false;
+
+    double d2;      // upper bound of |f''| on the interval
+
+    if ((fun == "sin") || (fun == "cos") || (fun == "exp")) {
+        d2 = 1;
+    } else if ((fun == "log") && (i.lo > 0)) {
+        d2 = 1/(i.lo*i.lo);
+    } else if ((fun == "log10") && (i.lo > 0)) {
+        d2 = 1/(i.lo*i.lo*log(10.0));
+    } else if ((fun == "tan") && (max(fabs(i.lo), fabs(i.hi)) < 1.5)) {
+        double t = tan(max(fabs(i.lo), fabs(i.hi)));
+        d2 = 2*t*(1 + t*t);
+    } else {
+        return false;
+    }
+
+    double n = (i.hi - i.lo) * sqrt(d2/8e-6);
+    if (n > 65536) return false;
+    for (size = 64; size < n; size *= 2) {}
+    return true;
+}
+
+/**
+ * Generates (once per function and interval) the static table used in the
+ * table mode, filled with the exact function in the classInit method
+ */
+static string generateMathTable (Klass* klass, const string& fun, const interval& i, int size, int precision)
+{
+    string key = subst("$0 $1 $2 $3", fun, T(i.lo), T(i.hi), ifloat(precision));
+    map<string, string>::iterator p = gMathTables.find(key);
+    if (p != gMathTables.end()) return p->second;
+
+    string vname = subst("fMathTable$0", T(int(gMathTables.size())));
+    Klass* k = klass->getTopParentKlass();
+
+    k->addDeclCode(subst("static $0 \t$1[$2];", ifloat(precision), vname, T(size+1)));
+    k->addStaticFields(subst("$0 \t$1::$2[$3];", ifloat(precision), k->getFullClassName(), vname, T(size+1)));
+    k->addStaticInitCode(subst("for (int i=0; i<$0; i++) $1[i] = $2$3($4 + i*$5);",
+                               T(size+1), vname, fun, isuffix(precision), T(i.lo, precision), T((i.hi - i.lo)/size, precision)));
+    gMathTables[key] = vname;
+    return vname;
+}
+
+string generateMathCall (Klass* klass, const string& fun, const string& arg, const interval& i, int variability, int precision)
+{
+    int size;
+
+    if (variability < kSamp) {
+        return subst("$0$1($2)", fun, isuffix(precision), arg);
+
+    } else if ((gMathMode == kMathFast) && (precision < 3) && isFastFunction(fun)) {
+        gFastMathPrecisions.insert(precision);
+        klass->rememberNeedMathDef();
+        return subst("faustfast$0($1)", fun, arg);
+
+    } else if ((gMathMode == kMathTable) && mathTableSize(fun, i, size)) {
+        gMathTablePrecisions.insert(precision);
+        klass->rememberNeedMathDef();
+        string vname = generateMathTable(klass, fun, i, size, precision);
+        return subst("faustmathtable($0, $1, $2, $3, $4)", vname, T(i.lo, precision), T(size/(i.hi - i.lo), precision), T(size), arg);
+
+    } else {
+        return subst("$0$1($2)", fun, isuffix(precision), arg);
+    }
+}
+
+/**
+ * True when the generated code may compute fun with one of the approximations
+ * of the -mm option (pow being rewritten as exp(y*log(x)))
+ */
+bool isApproximatedFunction (const string& fun)
+{
+    return (gMathMode != kMathExact) && (isFastFunction(fun) || (fun == "pow"));
+}
+
+/**
+ * Forgets the definitions and the tables needed by the previous compilation
+ * (each file of a -batch compilation starts from scratch)
+ */
+void resetMathDefs ()
+{
+    gFastMathPrecisions.clear();
+    gMathTablePrecisions.clear();
+    gMathTables.clear();
+}
+
+void printMathDef (ostream& fout)
+{
+    if (gFastMathPrecisions.size() > 0) {
+        fout << "#ifndef FAUSTFASTMATH" << endl;
+        fout << "#define FAUSTFASTMATH" << endl;
+        for (set<int>::iterator p = gFastMathPrecisions.begin(); p != gFastMathPrecisions.end(); p++) {
+            const char** lines = (*p == 1) ? gFastMathFloat : gFastMathDouble;
+            for (int k = 0; lines[k]; k++) fout << lines[k] << endl;
+        }
+        fout << "#endif" << endl;
+    }
+    if (gMathTablePrecisions.size() > 0) {
+        fout << "#ifndef FAUSTMATHTABLE" << endl;
+        fout << "#define FAUSTMATHTABLE" << endl;
+        for (set<int>::iterator p = gMathTablePrecisions.begin(); p != gMathTablePrecisions.end(); p++) {
+            for (int k = 0; gMathTable[k]; k++) fout << subst(gMathTable[k], ifloat(*p)) << endl;
+        }
+        fout << "#endif" << endl;
+    }
+}
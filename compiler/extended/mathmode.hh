@@ -0,0 +1,68 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#ifndef _MATHMODE_
+#define _MATHMODE_
+
+#include <iostream>
+#include <string>
+#include "klass.hh"
+#include "interval.hh"
+#include "sigtype.hh"
+
+// Implementation of the elementary functions sin, cos, tan, exp, log and log10
+// in the generated code (-mm option) :
+//  - exact : the functions of the C math library
+//  - fast  : inline polynomial approximations (faustfastsin(), ...). Maximum errors
+//            measured against the long double functions, on all the floats of the
+//            supported range in single precision and on 1e9 random samples in double
+//            precision :
+//              function  range                     single       double
+//              exp       -87.3 <= x <= 88.37       1.22 ulp     1.18 ulp (x <= 709.43)
+//              log       normal x > 0              2.85 ulp     2.94 ulp
+//              log10     normal x > 0              4.33 ulp     5.41 ulp
+//              sin, cos  |x| <= pi                 1.56 ulp     1.58 ulp
+//              sin, cos  |x| <= 1000               478 ulp      1.58 ulp
+//              tan       |x| < pi/2                3.24 ulp     3.33 ulp
+//            The single precision sin and cos lose accuracy near their zeros for large
+//            arguments, because of the argument reduction. Outside of these ranges the
+//            results are wrong : exp saturates its exponent (x above 88.37 in single
+//            precision and 709.43 in double precision), and log and log10 are not
+//            supported for x <= 0 (and the denormals), where they return finite values
+//            instead of -inf or NaN. The quad precision always uses the exact functions.
+//  - table : linear interpolation in a static table filled at class init time
+//            when the interval of the argument is bounded, with an absolute error
+//            below 1e-6 (relative for exp), which is not bounded in ulp near the
+//            zeros of the function. The other arguments use the exact functions.
+// The arguments computed at control rate always use the exact functions.
+
+enum { kMathExact, kMathFast, kMathTable };
+
+extern int gMathMode;
+
+std::string generateMathCall (Klass* klass, const std::string& fun, const std::string& arg, const interval& i, int variability, int precision);
+void        printMathDef (std::ostream& fout);     ///< definitions of the fast functions and of the table interpolation
+void        resetMathDefs ();                      ///< forgets the definitions and tables of the previous compilation
+bool        isApproximatedFunction (const std::string& fun);  ///< fun may not be computed by the C math library
+
+#endif
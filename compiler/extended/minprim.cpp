@@ -4,6 +4,7 @@
 #include "sigtyperules.hh"
 
 #include "floats.hh"
+#include "intervalreport.hh"
 
 class MinPrim : public xtended
 {
@@ -65,11 +66,20 @@ class MinPrim : public xtended
 		}
 	}
 		
-    virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+    virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
     {
         assert (args.size() == arity());
         assert (types.size() == arity());
 
+        // a min that can't change one of its arguments is removed
+        if (isAlwaysLower(types[0], types[1])) {
+            countIntervalUse("useless min/max removed");
+            return argAsResult(args[0], types[0], types, precision);
+        } else if (isAlwaysLower(types[1], types[0])) {
+            countIntervalUse("useless min/max removed");
+            return argAsResult(args[1], types[1], types, precision);
+        }
+
         // generates code compatible with overloaded min
         int n0 = types[0]->nature();
         int n1 = types[1]->nature();
@@ -79,11 +89,11 @@ class MinPrim : public xtended
                 return subst("min($0, $1)", args[0], args[1]);
             } else {
                 assert(n1==kInt); // second argument is not float, cast it to float
-                return subst("min($0, $2$1)", args[0], args[1], icast());
+                return subst("min($0, $2$1)", args[0], args[1], icast(precision));
             }
         } else if (n1==kReal) {
             assert(n0==kInt); // first not float but second is, cast first to float
-            return subst("min($2$0, $1)", args[0], args[1], icast());
+            return subst("min($2$0, $1)", args[0], args[1], icast(precision));
         } else {
             assert(n0==kInt);  assert(n1==kInt);   // both are integers, check for booleans
             int b0 = types[0]->boolean();
@@ -98,7 +108,7 @@ class MinPrim : public xtended
                 }
             } else if (b1==kNum) {
                 assert(b0==kBool);    // first is boolean, cast to int
-                return subst("min((int)$0, $1)", args[0], args[1], icast());
+                return subst("min((int)$0, $1)", args[0], args[1], icast(precision));
             } else {
                 // both are booleans, theoratically no need to cast, but we still do it to be sure 'true' is actually '1'
                 // and 'false' is actually '0' (which is not the case if compiled in SSE mode)
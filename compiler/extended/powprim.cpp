@@ -3,6 +3,8 @@
 #include <math.h>
 
 #include "floats.hh"
+#include "mathmode.hh"
+#include "signals.hh"
 
 class PowPrim : public xtended
 {
@@ -37,24 +39,46 @@ class PowPrim : public xtended
 	
 	virtual Tree	computeSigOutput (const vector<Tree>& args) {
 		num n,m;
+		double r;
 		assert (args.size() == arity());
 		if (isNum(args[0],n) & isNum(args[1],m)) {
 			return tree(pow(double(n), double(m)));
+		} else if (isSigReal(args[1], &r) && (r == 0.5)) {
+			// pow(x,0.5) => sqrt(x)
+			return gSqrtPrim->computeSigOutput(vector<Tree>(1, args[0]));
+		} else if (isSigReal(args[1], &r) && (r == -0.5)) {
+			// pow(x,-0.5) => 1/sqrt(x)
+			return sigDiv(sigReal(1.0), gSqrtPrim->computeSigOutput(vector<Tree>(1, args[0])));
+		} else if (getUserData(args[0]) == gExpPrim) {
+			// pow(exp(x),y) => exp(x*y)
+			return gExpPrim->computeSigOutput(vector<Tree>(1, sigMul(args[0]->branch(0), args[1])));
 		} else {
 			return tree(symbol(), args[0], args[1]);
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
 
+        interval i = types[0]->getInterval();
+        // The integer powers would no longer be exact, as needed when they are used as delays, so
+        // only the powers computed at sample rate are rewritten, and never in exact mode
+        bool sample = ((types[0]|types[1])->variability() == kSamp);
+
         if ((types[1]->nature() == kInt) && (types[1]->variability() == kKonst) && (types[1]->computability() == kComp)) {
-            klass->rememberNeedPowerDef();
+            klass->rememberNeedPowerDef(precision);
             return subst("faustpower<$1>($0)", args[0], args[1]);
+        } else if ((gMathMode != kMathExact) && sample && i.isconst() && (i.lo > 0) && (i.lo != 1) && ((types[0]|types[1])->nature() == kReal)) {
+            // pow(c,y) => exp(y*log(c)) for a positive constant c
+            return generateMathCall(klass, "exp", subst("($0 * $1)", args[1], T(log(i.lo), precision)), types[1]->getInterval() * interval(log(i.lo)), kSamp, precision);
+        } else if ((gMathMode == kMathFast) && sample && i.valid && (i.lo > 0)) {
+            // pow(x,y) => exp(y*log(x)) for a positive x
+            return generateMathCall(klass, "exp", subst("($0 * $1)", args[1], generateMathCall(klass, "log", args[0], i, kSamp, precision)),
+                                    types[1]->getInterval() * interval(log(i.lo), log(i.hi)), kSamp, precision);
         } else {
-            return subst("pow$2($0,$1)", args[0], args[1], isuffix());
+            return subst("pow$2($0,$1)", args[0], args[1], isuffix(precision));
         }
     }
 	
@@ -4,6 +4,7 @@
 #include <math.h>
 
 #include "floats.hh"
+#include "intervalreport.hh"
 
 class RemainderPrim : public xtended
 {
@@ -40,12 +41,21 @@ class RemainderPrim : public xtended
 		}
 	}
 		
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types)
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision)
 	{
 		assert (args.size() == arity());
 		assert (types.size() == arity());
+
+        interval i = types[0]->getInterval();
+        interval j = types[1]->getInterval();
+        if (i.valid && j.valid && (j.lo > 0 || j.hi < 0)
+            && max(fabs(i.lo), fabs(i.hi)) < min(fabs(j.lo), fabs(j.hi))/2) {
+            // |x| < |y|/2 : remainder(x,y) = x
+            countIntervalUse("useless fmod/remainder removed");
+            return argAsResult(args[0], types[0], types, precision);
+        }
         
-		return subst("remainder$2($0,$1)", args[0], args[1], isuffix());
+		return subst("remainder$2($0,$1)", args[0], args[1], isuffix(precision));
 	}
 	
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types)
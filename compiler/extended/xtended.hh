@@ -8,6 +8,7 @@
 #include "sigvisitor.hh"
 #include <vector>
 #include "lateq.hh"
+#include "floats.hh"
 
 class xtended 
 {
@@ -32,7 +33,7 @@ class xtended
 	
 	// virtual method to be implemented by subclasses
 	virtual unsigned int 	arity () = 0;
-	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types) = 0;
+	virtual string 	generateCode (Klass* klass, const vector<string>& args, const vector<Type>& types, int precision) = 0;   ///< precision of the real values (see floats.hh)
 	virtual string 	generateLateq (Lateq* lateq, const vector<string>& args, const vector<Type>& types) = 0;
 	virtual int 	infereSigOrder (const vector<int>& args) = 0;
 	virtual Type 	infereSigType (const vector<Type>& args) = 0;
@@ -40,6 +41,19 @@ class xtended
 	virtual bool	needCache () = 0;
 
     virtual bool    isSpecialInfix()    { return false; }   ///< generaly false, but true for binary op # such that #(x) == _#x
+
+    /// code of an argument returned as the result (when the intervals prove the call useless), cast to the nature of the result
+    string          argAsResult (const string& arg, Type targ, const vector<Type>& types, int precision)
+                    {
+                        Type t = infereSigType(types);
+                        if (t->nature() == kReal && targ->nature() == kInt) {
+                            return string(icast(precision)) + arg;
+                        } else if (t->nature() == kInt && targ->boolean() == kBool) {
+                            return "(int)" + arg;
+                        } else {
+                            return arg;
+                        }
+                    }
 };
 
 // -- Trigonometric Functions
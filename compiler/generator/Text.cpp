@@ -187,22 +187,31 @@ static void ensureFloat(char* c)
  * f if single-precision is required.
  */
 string T(double n)
+{
+    return T(n, gFloatSize);
+}
+
+/**
+ * Convert a double-precision float into a constant of the given
+ * precision (1 : float, 2 : double, 3 : long double)
+ */
+string T(double n, int precision)
 {
     char    c[64];
     char*   endp;
     int     p = 1;
 
-    if (gFloatSize==1) {
+    if (precision==1) {
         float v = (float)n;
         do { snprintf(c, 32, "%.*g", p++, v); endp=0; } while (strtof(c, &endp) != v);
-    } else if (gFloatSize==2) {
+    } else if (precision==2) {
         do { snprintf(c, 32, "%.*g", p++, n); endp=0; } while (strtod(c, &endp) != n);
-    } if (gFloatSize==3) {
+    } if (precision==3) {
         long double q = n;
         do { snprintf(c, 32, "%.*Lg", p++, q); endp=0; } while (strtold(c, &endp) != q);
     }
     ensureFloat(c);
-    return string(c)+inumix();
+    return string(c)+inumix(precision);
 }
 
 
@@ -51,6 +51,7 @@ string T (int n);
 string T (long n);
 //string T (float n);
 string T (double n);
+string T (double n, int precision);     ///< constant of the given precision (see floats.hh)
 
 // add and remove quotes of a string
 string unquote(const string& s);
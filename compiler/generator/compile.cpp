@@ -47,6 +47,7 @@ Compile a list of FAUST signals into a C++ class .
 #include "sigtyperules.hh"
 #include "simplify.hh"
 #include "privatise.hh"
+#include "lanesklass.hh"
 
 /*****************************************************************************
 ******************************************************************************
@@ -57,8 +58,9 @@ Compile a list of FAUST signals into a C++ class .
 *****************************************************************************/
 
 extern int 		gDetailsSwitch;
+extern int 		gLanes;
 extern string 	gMasterName;
-extern map<Tree, set<Tree> > gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 
 /*****************************************************************************
 ******************************************************************************
@@ -74,7 +76,7 @@ extern map<Tree, set<Tree> > gMetaDataSet;
 *****************************************************************************/
 
 Compiler::Compiler(const string& name, const string& super, int numInputs, int numOutputs, bool vec)
-                : fClass(new Klass(name, super, numInputs, numOutputs, vec)),
+                : fClass((gLanes > 1) ? new LanesKlass(name, super, numInputs, numOutputs, vec) : new Klass(name, super, numInputs, numOutputs, vec)),
                 fNeedToDeleteClass(true), 
                 fUIRoot(uiFolder(cons(tree(0), tree("")))),
                 fDescription(0),fJSON(numInputs, numOutputs)
@@ -139,14 +141,14 @@ static string wdel(const string& s)
 void Compiler::generateMetaData()
 {
     // Add global metadata
-    for (map<Tree, set<Tree> >::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
+    for (map<Tree, set<Tree, treeLess>, treeLess>::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
         if (i->first != tree("author")) {
             stringstream str1, str2;
             str1 << *(i->first);
             str2 << **(i->second.begin());
             fJSON.declare(str1.str().c_str(), unquote(str2.str()).c_str());
         } else {
-            for (set<Tree>::iterator j = i->second.begin(); j != i->second.end(); j++) {
+            for (set<Tree, treeLess>::iterator j = i->second.begin(); j != i->second.end(); j++) {
                 if (j == i->second.begin()) {
                     stringstream str1, str2;
                     str1 << *(i->first);
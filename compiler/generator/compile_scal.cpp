@@ -50,6 +50,8 @@
 #include "compatibility.hh"
 #include "ppsig.hh"
 #include "sigToGraph.hh"
+#include "sigeval.hh"
+#include "intervalreport.hh"
 
 using namespace std;
 
@@ -58,6 +60,16 @@ extern bool     gDrawSignals;
 extern bool     gPrintJSONSwitch;
 extern bool     gDrawSignals;
 extern int      gMaxCopyDelay;
+extern int      gDelayStrategy;
+extern bool     gDelayReport;
+extern bool     gDelayPool;
+extern int      gConstTableSize;
+extern int      gKRate;
+extern bool     gKRateInterpolation;
+extern int      gFloatSize;
+extern bool     gMixedPrecision;
+extern bool     gMixedPrecisionReport;
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 extern string   gClassName;
 extern string   gMasterDocument;
 
@@ -164,12 +176,11 @@ void ScalarCompiler::compileMultiSignal (Tree L)
 {
 	//contextor recursivness(0);
 	L = prepare(L);		// optimize, share and annotate expression
+    prepareKRate(L);
+    preparePrecision(L);
 
     for (int i = 0; i < fClass->inputs(); i++) {
         fClass->addZone3(subst("$1* input$0 = input[$0];", T(i), xfloat()));
-        if (gInPlace) {
-        	CS(sigInput(i));
-        }
     }
     for (int i = 0; i < fClass->outputs(); i++) {
         fClass->addZone3(subst("$1* output$0 = output[$0];", T(i), xfloat()));
@@ -179,7 +190,14 @@ void ScalarCompiler::compileMultiSignal (Tree L)
 		Tree sig = hd(L);
 		fClass->addExecCode(subst("output$0[i] = $2$1;", T(i), CS(sig), xcast()));
 	}
-    
+    if (gInPlace) {
+        generateInPlaceCache();
+    }
+    declareDelayPools();
+    if (gMixedPrecisionReport) {
+        printPrecisionReport();
+    }
+
     generateMetaData();
 	generateUserInterfaceTree(prepareUserInterfaceTree(fUIRoot));
 	generateMacroInterfaceTree("", prepareUserInterfaceTree(fUIRoot));
@@ -203,6 +221,7 @@ void ScalarCompiler::compileSingleSignal (Tree sig)
 	//contextor recursivness(0);
 	sig = prepare2(sig);		// optimize and annotate expression
 	fClass->addExecCode(subst("output[i] = $0;", CS(sig)));
+	declareDelayPools();
 	generateUserInterfaceTree(prepareUserInterfaceTree(fUIRoot));
 	generateMacroInterfaceTree("", prepareUserInterfaceTree(fUIRoot));
 	if (fDescription) {
@@ -258,7 +277,19 @@ string  ScalarCompiler::CS (Tree sig)
 /*        if (getRecursivness(sig) != contextRecursivness.get()) {
             contextRecursivness.set(getRecursivness(sig));
         }*/
-        code = generateCode(sig);
+        if (fMixedPrecision) {
+            // real constants take the precision of the expression using them
+            double r;
+            if (isSigReal(sig, &r) && fOccMarkup.retrieve(sig)->getMaxDelay() == 0) {
+                return T(r, fUserPrecision);
+            }
+            int user = fUserPrecision;
+            fUserPrecision = precision(sig);
+            code = generateCode(sig);
+            fUserPrecision = user;
+        } else {
+            code = generateCode(sig);
+        }
         setCompiledExpression(sig, code);
     }
     return code;
@@ -289,7 +320,7 @@ string	ScalarCompiler::generateCode (Tree sig)
 
 		 if ( getUserData(sig) ) 					{ return generateXtended(sig); }
 	else if ( isSigInt(sig, &i) ) 					{ return generateNumber(sig, T(i)); }
-	else if ( isSigReal(sig, &r) ) 					{ return generateNumber(sig, T(r)); }
+	else if ( isSigReal(sig, &r) ) 					{ return generateNumber(sig, T(r, precision(sig))); }
     else if ( isSigWaveform(sig) )                  { return generateWaveform(sig); }
 	else if ( isSigInput(sig, &i) ) 				{ return generateInput 	(sig, T(i)); 			}
 	else if ( isSigOutput(sig, &i, x) ) 			{ return generateOutput 	(sig, T(i), CS(x));}
@@ -349,7 +380,7 @@ string ScalarCompiler::generateNumber (Tree sig, const string& exp)
 
 	// check for number occuring in delays
 	if (o->getMaxDelay()>0) {
-		getTypedNames(getCertifiedSigType(sig), "Vec", ctype, vname);
+		getTypedNames(sig, "Vec", ctype, vname);
 		generateDelayVec(sig, exp, ctype, vname, o->getMaxDelay());
 	}
 	return exp;
@@ -368,7 +399,7 @@ string ScalarCompiler::generateFConst (Tree sig, const string& file, const strin
     addIncludeFile(file);
 
     if (o->getMaxDelay()>0) {
-        getTypedNames(getCertifiedSigType(sig), "Vec", ctype, vname);
+        getTypedNames(sig, "Vec", ctype, vname);
         generateDelayVec(sig, exp, ctype, vname, o->getMaxDelay());
     }
     return exp;
@@ -394,12 +425,7 @@ string ScalarCompiler::generateFVar (Tree sig, const string& file, const string&
 
 string ScalarCompiler::generateInput (Tree sig, const string& idx)
 {
-    if (gInPlace) {
-        // inputs must be cached for in-place transformations
-        return forceCacheCode(sig, subst("$1input$0[i]", idx, icast()));
-    } else {
-        return generateCacheCode(sig, subst("$1input$0[i]", idx, icast()));
-    }
+    return generateCacheCode(sig, subst("$1input$0[i]", idx, icast(precision(sig))));
 }
 
 
@@ -410,6 +436,41 @@ string ScalarCompiler::generateOutput (Tree sig, const string& idx, const string
 	return dst;
 }
 
+/**
+ * In-place computations (-inpl option) : an input buffer can be an output buffer.
+ * The samples of an input read after the write of an output in the sample loop
+ * are then read at the beginning of the loop. The other inputs are not cached.
+ */
+void ScalarCompiler::generateInPlaceCache()
+{
+    list<string>&   code = fClass->topLoop()->fExecCode;
+    list<string>    cache;
+
+    for (int k = 0; k < fClass->inputs(); k++) {
+        string  input = subst("input$0[i]", T(k));
+        bool    written = false;
+        bool    hazard = false;
+
+        for (list<string>::iterator p = code.begin(); p != code.end() && !hazard; p++) {
+            hazard = written && (p->find(input) != string::npos);
+            written |= (p->compare(0, 6, "output") == 0);
+        }
+        if (hazard) {
+            string vname = subst("f$0", getFreshID("Temp"));
+            cache.push_back(subst("$0 $1 = $2$3;", ifloat(), vname, icast(), input));
+            string read[] = { icast() + input, input };
+            for (list<string>::iterator p = code.begin(); p != code.end(); p++) {
+                for (int r = 0; r < 2; r++) {
+                    for (size_t pos = p->find(read[r]); pos != string::npos; pos = p->find(read[r], pos)) {
+                        p->replace(pos, read[r].size(), vname);
+                    }
+                }
+            }
+        }
+    }
+    code.insert(code.begin(), cache.begin(), cache.end());
+}
+
 
 /*****************************************************************************
 							   BINARY OPERATION
@@ -432,13 +493,13 @@ string ScalarCompiler::generateBinOp(Tree sig, int opcode, Tree arg1, Tree arg2)
 
 
         if (t1->nature()==kInt && t2->nature()==kInt ) {
-            return generateCacheCode(sig, subst("($3($0) $1 $3($2))", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat()));
+            return generateCacheCode(sig, subst("($3($0) $1 $3($2))", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat(precision(sig))));
         } else if (t1->nature()==kInt && t2->nature()==kReal ) {
-            return generateCacheCode(sig, subst("($3($0) $1 $2)", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat()));
+            return generateCacheCode(sig, subst("($3($0) $1 $2)", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat(precision(sig))));
         } else if (t1->nature()==kReal && t2->nature()==kInt ) {
-            return generateCacheCode(sig, subst("($0 $1 $3($2))", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat()));
+            return generateCacheCode(sig, subst("($0 $1 $3($2))", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat(precision(sig))));
         } else  {
-            return generateCacheCode(sig, subst("($0 $1 $2)", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat()));
+            return generateCacheCode(sig, subst("($0 $1 $2)", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2), ifloat(precision(sig))));
         }
     } else {
         return generateCacheCode(sig, subst("($0 $1 $2)", CS(arg1), gBinOpTable[opcode]->fName, CS(arg2)));
@@ -472,12 +533,15 @@ string ScalarCompiler::generateFFun(Tree sig, Tree ff, Tree largs)
 							   CACHE CODE
 *****************************************************************************/
 
-void ScalarCompiler::getTypedNames(Type t, const string& prefix, string& ctype, string& vname)
+void ScalarCompiler::getTypedNames(Tree sig, const string& prefix, string& ctype, string& vname)
 {
-    if (t->nature() == kInt) {
+    if (getCertifiedSigType(sig)->nature() == kInt) {
         ctype = "int"; vname = subst("i$0", getFreshID(prefix));
     } else {
-        ctype = ifloat(); vname = subst("f$0", getFreshID(prefix));
+        ctype = ifloat(precision(sig)); vname = subst("f$0", getFreshID(prefix));
+        if (isPromoted(sig)) {
+            fPromotedNames.push_back(vname);
+        }
     }
 }
 
@@ -492,10 +556,15 @@ string ScalarCompiler::generateCacheCode(Tree sig, const string& exp)
         return code;
     }
 
+    // slowly varying expression computed every fKRate samples
+    if (fKRateRoots.find(sig) != fKRateRoots.end()) {
+        return generateKRateCode(sig, exp);
+    }
+
 	// check for expression occuring in delays
 	if (o->getMaxDelay()>0) {
 
-        getTypedNames(getCertifiedSigType(sig), "Vec", ctype, vname);
+        getTypedNames(sig, "Vec", ctype, vname);
         if (sharing>1) {
             return generateDelayVec(sig, generateVariableStore(sig,exp), ctype, vname, o->getMaxDelay());
         } else {
@@ -532,7 +601,7 @@ string ScalarCompiler::forceCacheCode(Tree sig, const string& exp)
 	// check for expression occuring in delays
 	if (o->getMaxDelay()>0) {
 
-        getTypedNames(getCertifiedSigType(sig), "Vec", ctype, vname);
+        getTypedNames(sig, "Vec", ctype, vname);
         return generateDelayVec(sig, generateVariableStore(sig,exp), ctype, vname, o->getMaxDelay());
 
 	} else  {
@@ -552,27 +621,47 @@ string ScalarCompiler::generateVariableStore(Tree sig, const string& exp)
 
         case kKonst :
 
-            getTypedNames(t, "Const", ctype, vname);
-            fClass->addDeclCode(subst("$0 \t$1;", ctype, vname));
+            getTypedNames(sig, "Const", ctype, vname);
+            fClass->addDeclCode(subst("$0 \t$1;", ctype, vname), fieldCategory(sig));
+            fClass->shareFieldByLanes(vname);
             fClass->addInitCode(subst("$0 = $1;", vname, exp));
             break;
 
         case kBlock :
 
-            getTypedNames(t, "Slow", ctype, vname);
+            getTypedNames(sig, "Slow", ctype, vname);
             fClass->addFirstPrivateDecl(vname);
             fClass->addZone2(subst("$0 \t$1 = $2;", ctype, vname, exp));
             break;
 
         case kSamp :
 
-            getTypedNames(t, "Temp", ctype, vname);
+            getTypedNames(sig, "Temp", ctype, vname);
             fClass->addExecCode(subst("$0 $1 = $2;", ctype, vname, exp));
             break;
     }
     return vname;
 }
 
+/**
+ * Access category (-fl option) of the field storing a constant sig, given by the
+ * contexts of its occurences : a constant used in a sample rate expression is read
+ * in the sample loop, in a block rate expression once per block, and otherwise only
+ * by the init code of other constants.
+ */
+int ScalarCompiler::fieldCategory(Tree sig)
+{
+    Occurences* o = fOccMarkup.retrieve(sig);
+
+    if (!o || o->getOccurences(kSamp) + o->getOccurences(kBlock+1) > 0) {
+        return FieldLayout::kHotField;
+    } else if (o->getOccurences(kBlock) > 0) {
+        return FieldLayout::kBlockField;
+    } else {
+        return FieldLayout::kColdField;
+    }
+}
+
 
 /*****************************************************************************
 							   	    CASTING
@@ -586,7 +675,7 @@ string ScalarCompiler::generateIntCast(Tree sig, Tree x)
 
 string ScalarCompiler::generateFloatCast (Tree sig, Tree x)
 {
-	return generateCacheCode(sig, subst("$1($0)", CS(x), ifloat()));
+	return generateCacheCode(sig, subst("$1($0)", CS(x), ifloat(precision(sig))));
 }
 
 /*****************************************************************************
@@ -596,64 +685,64 @@ string ScalarCompiler::generateFloatCast (Tree sig, Tree x)
 string ScalarCompiler::generateButton(Tree sig, Tree path)
 {
 	string varname = getFreshID("fbutton");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	fClass->addInitUICode(subst("$0 = 0.0;", varname));
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
     //return generateCacheCode(sig, varname);
-    return generateCacheCode(sig, subst("$1($0)", varname, ifloat()));
+    return generateCacheCode(sig, subst("$1($0)", varname, ifloat(precision(sig))));
 }
 
 string ScalarCompiler::generateCheckbox(Tree sig, Tree path)
 {
 	string varname = getFreshID("fcheckbox");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	fClass->addInitUICode(subst("$0 = 0.0;", varname));
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
     //return generateCacheCode(sig, varname);
-    return generateCacheCode(sig, subst("$1($0)", varname, ifloat()));
+    return generateCacheCode(sig, subst("$1($0)", varname, ifloat(precision(sig))));
 }
 
 
 string ScalarCompiler::generateVSlider(Tree sig, Tree path, Tree cur, Tree min, Tree max, Tree step)
 {
 	string varname = getFreshID("fslider");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	fClass->addInitUICode(subst("$0 = $1;", varname, T(tree2float(cur))));
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
     //return generateCacheCode(sig, varname);
-    return generateCacheCode(sig, subst("$1($0)", varname, ifloat()));
+    return generateCacheCode(sig, subst("$1($0)", varname, ifloat(precision(sig))));
 }
 
 string ScalarCompiler::generateHSlider(Tree sig, Tree path, Tree cur, Tree min, Tree max, Tree step)
 {
 	string varname = getFreshID("fslider");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	fClass->addInitUICode(subst("$0 = $1;", varname, T(tree2float(cur))));
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
     //return generateCacheCode(sig, varname);
-    return generateCacheCode(sig, subst("$1($0)", varname, ifloat()));
+    return generateCacheCode(sig, subst("$1($0)", varname, ifloat(precision(sig))));
 }
 
 string ScalarCompiler::generateNumEntry(Tree sig, Tree path, Tree cur, Tree min, Tree max, Tree step)
 {
 	string varname = getFreshID("fentry");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	fClass->addInitUICode(subst("$0 = $1;", varname, T(tree2float(cur))));
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
     //return generateCacheCode(sig, varname);
-    return generateCacheCode(sig, subst("$1($0)", varname, ifloat()));
+    return generateCacheCode(sig, subst("$1($0)", varname, ifloat(precision(sig))));
 }
 
 
 string ScalarCompiler::generateVBargraph(Tree sig, Tree path, Tree min, Tree max, const string& exp)
 {
 	string varname = getFreshID("fbargraph");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
 	Type t = getCertifiedSigType(sig);
@@ -680,7 +769,7 @@ string ScalarCompiler::generateVBargraph(Tree sig, Tree path, Tree min, Tree max
 string ScalarCompiler::generateHBargraph(Tree sig, Tree path, Tree min, Tree max, const string& exp)
 {
 	string varname = getFreshID("fbargraph");
-	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()));
+	fClass->addDeclCode(subst("$1 \t$0;", varname, xfloat()), FieldLayout::kUIField);
 	addUIWidget(reverse(tl(path)), uiWidget(hd(path), tree(varname), sig));
 
 	Type t = getCertifiedSigType(sig);
@@ -747,22 +836,12 @@ string ScalarCompiler::generateStaticSigGen(Tree sig, Tree content)
 
 string ScalarCompiler::generateTable(Tree sig, Tree tsize, Tree content)
 {
-	string 		generator(CS(content));
     Tree		g;
     string 		cexp;
     string		ctype, vname;
 	int 		size;
 
-    // already compiled but check if we need to add declarations
-
     assert ( isSigGen(content, g) );
-    pair<string,string> kvnames;
-    if ( ! fInstanceInitProperty.get(g, kvnames)) {
-        // not declared here, we add a declaration
-        bool b = fStaticInitProperty.get(g, kvnames);
-        assert(b);
-        fClass->addInitCode(subst("$0 $1;", kvnames.first, kvnames.second));
-    }
 
 	if (!isSigInt(tsize, &size)) {
 		//fprintf(stderr, "error in ScalarCompiler::generateTable()\n"); exit(1);
@@ -784,7 +863,27 @@ string ScalarCompiler::generateTable(Tree sig, Tree tsize, Tree content)
 	}
 
 	// declaration de la table
-	fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(size)));
+	fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(size)), fieldCategory(sig));
+	fClass->addLaneTable(vname);
+
+	// initial content computed by the compiler : the table is copied at init time
+	string init = vname + "Init";
+	if (declareConstTable(ctype, init, size, g)) {
+		fClass->addInitCode(subst("for (int i=0; i<$0; i++) $1[i] = $2[i];", T(size), vname, init));
+		return vname;
+	}
+
+	string 		generator(CS(content));
+
+    // already compiled but check if we need to add declarations
+
+    pair<string,string> kvnames;
+    if ( ! fInstanceInitProperty.get(g, kvnames)) {
+        // not declared here, we add a declaration
+        bool b = fStaticInitProperty.get(g, kvnames);
+        assert(b);
+        fClass->addInitCode(subst("$0 $1;", kvnames.first, kvnames.second));
+    }
 
 	// initialisation du generateur de contenu
 	fClass->addInitCode(subst("$0.init(samplingFreq);", generator));
@@ -805,19 +904,6 @@ string ScalarCompiler::generateStaticTable(Tree sig, Tree tsize, Tree content)
 
 	assert ( isSigGen(content, g) );
 
-	if (!getCompiledExpression(content, cexp)) {
-		cexp = setCompiledExpression(content, generateStaticSigGen(content, g));
-    } else {
-        // already compiled but check if we need to add declarations
-        pair<string,string> kvnames;
-        if ( ! fStaticInitProperty.get(g, kvnames)) {
-            // not declared here, we add a declaration
-            bool b = fInstanceInitProperty.get(g, kvnames);
-            assert(b);
-            fClass->addStaticInitCode(subst("$0 $1;", kvnames.first, kvnames.second));
-        }
-    }
-
     if (!isSigInt(tsize, &size)) {
 		//fprintf(stderr, "error in ScalarCompiler::generateTable()\n"); exit(1);
 		cerr << "error in ScalarCompiler::generateTable() : "
@@ -837,6 +923,24 @@ string ScalarCompiler::generateStaticTable(Tree sig, Tree tsize, Tree content)
 		ctype = ifloat();
 	}
 
+	// content computed by the compiler : no generator needed
+	if (declareConstTable(ctype, vname, size, g)) {
+		return vname;
+	}
+
+	if (!getCompiledExpression(content, cexp)) {
+		cexp = setCompiledExpression(content, generateStaticSigGen(content, g));
+    } else {
+        // already compiled but check if we need to add declarations
+        pair<string,string> kvnames;
+        if ( ! fStaticInitProperty.get(g, kvnames)) {
+            // not declared here, we add a declaration
+            bool b = fInstanceInitProperty.get(g, kvnames);
+            assert(b);
+            fClass->addStaticInitCode(subst("$0 $1;", kvnames.first, kvnames.second));
+        }
+    }
+
 	// declaration de la table
 	fClass->addDeclCode(subst("static $0 \t$1[$2];", ctype, vname, T(size)));
     fClass->addStaticFields(subst("$0 \t$1::$2[$3];", ctype, fClass->getClassName(), vname, T(size) ));
@@ -851,6 +955,41 @@ string ScalarCompiler::generateStaticTable(Tree sig, Tree tsize, Tree content)
 }
 
 
+/**
+ * Tables whose content doesn't depend on the user interface nor on the sampling
+ * rate are computed by the compiler, up to gConstTableSize elements, and declared
+ * as static const arrays : they are shared by all the instances, placed in read
+ * only data by the C++ compiler and no generator has to run at init time. The
+ * elements are computed in the precision of the generated code, with the same
+ * math functions, so the folding doesn't change the output (-cts option, off by default).
+ * @param ctype the type of the elements
+ * @param vname the name of the array
+ * @param size the number of elements
+ * @param g the content generator
+ * @return true if the array has been declared, false if the table must be filled by its generator
+ */
+bool ScalarCompiler::declareConstTable(const string& ctype, const string& vname, int size, Tree g)
+{
+	vector<Node> values;
+
+	// the values are computed in double, the quad precision keeps its generators
+	if (size > gConstTableSize || gFloatSize == 3 || !evalConstantSignal(g, size, values)) {
+		return false;
+	}
+
+	string elements;
+	for (int i = 0; i < size; i++) {
+		elements += (i == 0) ? "" : (i % 8 == 0) ? ",\n\t" : ", ";
+		elements += (ctype == "int") ? T(int(values[i])) : T(double(values[i]));
+	}
+
+	fClass->addDeclCode(subst("static const $0 \t$1[$2];", ctype, vname, T(size)));
+	// defined after the toplevel class, tables of the generators being nested classes
+	fClass->getTopParentKlass()->addStaticFields(subst("const $0 \t$1::$2[$3] = {\n\t$4\n};", ctype, fClass->getFullClassName(), vname, T(size), elements));
+	return true;
+}
+
+
 /*----------------------------------------------------------------------------
 						sigWRTable : table assignement
 ----------------------------------------------------------------------------*/
@@ -858,6 +997,7 @@ string ScalarCompiler::generateStaticTable(Tree sig, Tree tsize, Tree content)
 string ScalarCompiler::generateWRTbl(Tree sig, Tree tbl, Tree idx, Tree data)
 {
 	string tblName(CS(tbl));
+	countTableIndex(tbl, idx);
 	fClass->addExecCode(subst("$0[$1] = $2;", tblName, CS(idx), CS(data)));
 	return tblName;
 }
@@ -877,6 +1017,7 @@ string ScalarCompiler::generateRDTbl(Tree sig, Tree tbl, Tree idx)
 	// test the special case of a read only table that can be compiled
 	// has a static member
 	Tree 	id, size, content;
+	countTableIndex(tbl, idx);
 	if(	isSigTable(tbl, id, size, content) ) {
 		string tblname;
 		if (!getCompiledExpression(tbl, tblname)) {
@@ -890,6 +1031,26 @@ string ScalarCompiler::generateRDTbl(Tree sig, Tree tbl, Tree idx)
 
 
 
+/**
+ * Count the table accesses whose index is proven in range by its interval
+ * (the generated code never checks the indices)
+ */
+void ScalarCompiler::countTableIndex(Tree tbl, Tree idx)
+{
+	Tree	id, size, content, t, i, s;
+	int		n;
+
+	if (isSigWRTbl(tbl, id, t, i, s)) {
+		tbl = t;
+	}
+	if (isSigTable(tbl, id, size, content) && isSigInt(size, &n)) {
+		interval j = getCertifiedSigType(idx)->getInterval();
+		countIntervalUse((j.valid && j.lo >= 0 && j.hi < n) ? "table index proven in range" : "table index not proven in range");
+	}
+}
+
+
+
 /*****************************************************************************
 							   RECURSIONS
 *****************************************************************************/
@@ -930,9 +1091,10 @@ void ScalarCompiler::generateRec(Tree sig, Tree var, Tree le)
         if (fOccMarkup.retrieve(e)) {
             // this projection is used
             used[i] = true;
-            getTypedNames(getCertifiedSigType(e), "Rec", ctype[i],  vname[i]);
+            getTypedNames(e, "Rec", ctype[i],  vname[i]);
             setVectorNameProperty(e, vname[i]);
             delay[i] = fOccMarkup.retrieve(e)->getMaxDelay();
+            fDelayReads[vname[i]] = fOccMarkup.retrieve(e)->getDelayOccurences();
         } else {
             // this projection is not used therefore
             // we should not generate code for it
@@ -962,7 +1124,7 @@ string ScalarCompiler::generatePrefix (Tree sig, Tree x, Tree e)
 
 	string type = cType(te);
 
-	fClass->addDeclCode(subst("$0 \t$1;", type, vperm));
+	fClass->addDeclCode(subst("$0 \t$1;", type, vperm), FieldLayout::kHotField);
 	fClass->addInitCode(subst("$0 = $1;", vperm, CS(x)));
 
 	fClass->addExecCode(subst("$0 $1 = $2;", type, vtemp, vperm));
@@ -986,7 +1148,7 @@ string ScalarCompiler::generateIota (Tree sig, Tree n)
 
 	string vperm = getFreshID("iota");
 
-	fClass->addDeclCode(subst("int \t$0;",  vperm));
+	fClass->addDeclCode(subst("int \t$0;",  vperm), FieldLayout::kHotField);
 	fClass->addClearCode(subst("$0 = 0;", vperm));
 
 	if (isPowerOf2(size)) {
@@ -1008,7 +1170,31 @@ string ScalarCompiler::generateIota (Tree sig, Tree n)
 
 string ScalarCompiler::generateSelect2  (Tree sig, Tree sel, Tree s1, Tree s2)
 {
-    return generateCacheCode(sig, subst( "(($0)?$1:$2)", CS(sel), CS(s2), CS(s1) ) );
+    Type        t = getCertifiedSigType(sig);
+    interval    i = getCertifiedSigType(sel)->getInterval();
+
+    if (i.valid && (i.lo > 0 || i.hi < 0 || i.lo == i.hi)) {
+        // constant selector : only the selected signal is computed
+        countIntervalUse("select2 with a constant selector removed");
+        Tree s = (i.lo == 0 && i.hi == 0) ? s1 : s2;
+        if (t->nature() == kReal && getCertifiedSigType(s)->nature() == kInt) {
+            return generateCacheCode(sig, subst("$1($0)", CS(s), ifloat(precision(sig))));
+        } else {
+            return generateCacheCode(sig, CS(s));
+        }
+    } else if (i.valid && i.lo >= 0 && i.hi <= 1 && getCertifiedSigType(sel)->nature() == kInt
+               && getCertifiedSigType(s1)->nature() == kInt && getCertifiedSigType(s2)->nature() == kInt) {
+        // selector 0 or 1 and integer signals : branch free selection with a mask
+        countIntervalUse("integer select2 made branch free");
+        string v1 = CS(s1);
+        string v2 = CS(s2);
+        // each branch is used twice, its code is not duplicated
+        if (getSharingCount(s1) == 1 && !verySimple(s1)) v1 = generateVariableStore(s1, v1);
+        if (getSharingCount(s2) == 1 && !verySimple(s2)) v2 = generateVariableStore(s2, v2);
+        return generateCacheCode(sig, subst( "($1 ^ (($1 ^ $2) & -($0)))", CS(sel), v1, v2 ) );
+    } else {
+        return generateCacheCode(sig, subst( "(($0)?$1:$2)", CS(sel), CS(s2), CS(s1) ) );
+    }
 }
 
 
@@ -1037,7 +1223,7 @@ string ScalarCompiler::generateSelect3  (Tree sig, Tree sel, Tree s1, Tree s2, T
     switch (w->variability())
     {
         case kKonst :
-            fClass->addDeclCode(subst("$0 \t$1[3];", type, var));
+            fClass->addDeclCode(subst("$0 \t$1[3];", type, var), fieldCategory(sig));
             break;
         case kBlock :
             //fClass->addLocalDecl(type, subst("$0[3]", var));
@@ -1102,16 +1288,21 @@ string ScalarCompiler::generateXtended 	(Tree sig)
 	xtended* 		p = (xtended*) getUserData(sig);
 	vector<string> 	args;
 	vector<Type> 	types;
+	double			r;
 
 	for (int i=0; i<sig->arity(); i++) {
 		args.push_back(CS(sig->branch(i)));
 		types.push_back(getCertifiedSigType(sig->branch(i)));
+		// in mixed precision, the overloaded functions are called with arguments of the same precision
+		if (fMixedPrecision && types[i]->nature() == kReal && !isSigReal(sig->branch(i), &r)) {
+			args[i] = subst("$0($1)", ifloat(precision(sig)), args[i]);
+		}
 	}
 
 	if (p->needCache()) {
-		return generateCacheCode(sig, p->generateCode(fClass, args, types));
+		return generateCacheCode(sig, p->generateCode(fClass, args, types, precision(sig)));
 	} else {
-		return p->generateCode(fClass, args, types);
+		return p->generateCode(fClass, args, types, precision(sig));
 	}
 }
 
@@ -1174,6 +1365,7 @@ int ScalarCompiler::pow2limit(int x)
 		Y(t-0)	Y(t-1)	Y(t-2)  ...
 		Temp	V[0]	V[1]	...		gLessTempSwitch = false
 		V[0]	V[1]	V[2]	...		gLessTempSwitch = true
+		(or a ring or mirrored buffer, see generateShortDelayLine)
 
 	case max delay >= gMaxCopyDelay :
 		Y(t-0)	Y(t-1)	Y(t-2)  ...
@@ -1217,15 +1409,24 @@ string ScalarCompiler::generateFixDelay (Tree sig, Tree exp, Tree delay)
 
 	} else if (mxd < gMaxCopyDelay) {
 		if (isSigInt(delay, &d)) {
-			return subst("$0[$1]", vecname, CS(delay));
+			return generateShortDelayRead(vecname, mxd, fOccMarkup.retrieve(exp)->getDelayOccurences(), CS(delay));
 		} else {
-			return generateCacheCode(sig, subst("$0[$1]", vecname, CS(delay)));
+			return generateCacheCode(sig, generateShortDelayRead(vecname, mxd, fOccMarkup.retrieve(exp)->getDelayOccurences(), CS(delay)));
 		}
 
 	} else {
 
-		// long delay : we use a ring buffer of size 2^x
+		// long delay : we use a ring buffer of size 2^x or a part of the delay line pool
 		int 	N 	= pow2limit( mxd+1 );
+		if (gDelayPool) {
+			// the reads of a recursive signal are generated before its line
+			allocatePoolDelayLine((getCertifiedSigType(exp)->nature() == kInt) ? "int" : realType(exp), vecname, mxd+1);
+			if (isSigInt(delay, &d)) {
+				return generateCacheCode(sig, poolDelayAccess(vecname, "IOTA", d));
+			} else {
+				return generateCacheCode(sig, poolDelayAccess(vecname, subst("IOTA-$0", CS(delay)), 0));
+			}
+		}
 		return generateCacheCode(sig, subst("$0[(IOTA-$1)&$2]", vecname, CS(delay), T(N-1)));
 	}
 }
@@ -1258,22 +1459,10 @@ string ScalarCompiler::generateDelayVecNoTemp(Tree sig, const string& exp, const
 
     if (mxd < gMaxCopyDelay) {
 
-        // short delay : we copy
-        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(mxd+1)));
-        fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(mxd+1)));
-        fClass->addExecCode(subst("$0[0] = $1;", vname, exp));
-
-        // generate post processing copy code to update delay values
-        if (mxd == 1) {
-            fClass->addPostCode(subst("$0[1] = $0[0];", vname));
-        } else if (mxd == 2) {
-            //fClass->addPostCode(subst("$0[2] = $0[1];", vname));
-            fClass->addPostCode(subst("$0[2] = $0[1]; $0[1] = $0[0];", vname));
-        } else {
-            fClass->addPostCode(subst("for (int i=$0; i>0; i--) $1[i] = $1[i-1];", T(mxd), vname));
-        }
+        // short delay : shift, ring or mirrored buffer
+        string current = generateShortDelayLine(ctype, vname, mxd, fOccMarkup.retrieve(sig)->getDelayOccurences(), exp);
         setVectorNameProperty(sig, vname);
-        return subst("$0[0]", vname);
+        return current;
 
     } else {
 
@@ -1283,8 +1472,15 @@ string ScalarCompiler::generateDelayVecNoTemp(Tree sig, const string& exp, const
         // we need a iota index
         ensureIotaCode();
 
+        if (gDelayPool) {
+            allocatePoolDelayLine(ctype, vname, mxd+1);
+            fClass->addExecCode(subst("$0 = $1;", poolDelayAccess(vname, "IOTA", 0), exp));
+            setVectorNameProperty(sig, vname);
+            return poolDelayAccess(vname, "IOTA", 0);
+        }
+
         // declare and init
-        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(N)));
+        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(N)), FieldLayout::kHotField);
         fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(N)));
 
         // execute
@@ -1310,19 +1506,9 @@ void ScalarCompiler::generateDelayLine(const string& ctype, const string& vname,
     } else if (mxd < gMaxCopyDelay) {
         // cerr << "small delay : " << vname << "[" << mxd << "]" << endl;
 
-        // short delay : we copy
-        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(mxd+1)));
-        fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(mxd+1)));
-        fClass->addExecCode(subst("$0[0] = $1;", vname, exp));
-
-        // generate post processing copy code to update delay values
-        if (mxd == 1) {
-            fClass->addPostCode(subst("$0[1] = $0[0];", vname));
-        } else if (mxd == 2) {
-            fClass->addPostCode(subst("$0[2] = $0[1]; $0[1] = $0[0];", vname));
-        } else {
-            fClass->addPostCode(subst("for (int i=$0; i>0; i--) $1[i] = $1[i-1];", T(mxd), vname));
-        }
+        // short delay : shift, ring or mirrored buffer
+        map<string, int>::const_iterator reads = fDelayReads.find(vname);
+        generateShortDelayLine(ctype, vname, mxd, (reads != fDelayReads.end()) ? reads->second : 1, exp);
 
     } else {
 
@@ -1332,8 +1518,14 @@ void ScalarCompiler::generateDelayLine(const string& ctype, const string& vname,
         // we need a iota index
         ensureIotaCode();
 
+        if (gDelayPool) {
+            allocatePoolDelayLine(ctype, vname, mxd+1);
+            fClass->addExecCode(subst("$0 = $1;", poolDelayAccess(vname, "IOTA", 0), exp));
+            return;
+        }
+
         // declare and init
-        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(N)));
+        fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(N)), FieldLayout::kHotField);
         fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(N)));
 
         // execute
@@ -1341,6 +1533,193 @@ void ScalarCompiler::generateDelayLine(const string& ctype, const string& vname,
     }
 }
 
+/*****************************************************************************
+							   SHORT DELAY LINES : max delay < gMaxCopyDelay
+
+	shift :		V[0] V[1] ... V[mxd], the values are moved at the end of each
+				sample, reads are done at constant addresses
+	ring :		V[IOTA&(N-1)] with N = 2^x > mxd, one write per sample but each
+				read computes (IOTA-d)&(N-1)
+	mirror :	V[I] and V[I+L] with L = mxd+1, two writes per sample and an index
+				I decreased at each sample (shared by the lines of the same length),
+				reads V[I+d] don't need any mask
+
+*****************************************************************************/
+
+/**
+ * Choose the implementation of a short delay line, as requested by --delay-strategy
+ * or according to its estimated cost per sample. The choice is done once, by the first
+ * read or the write of the line (the reads of a recursive signal are generated first). The moves of shift are vectorized by
+ * the C++ compiler (4 per operation) when there are more than 2 of them. A ring buffer
+ * costs a write and the masked index of each read. A mirrored buffer costs two writes,
+ * the index update and an addition for each read (often done by the addressing mode).
+ */
+int ScalarCompiler::chooseDelayStrategy(const string& vname, int mxd, int reads)
+{
+    map<string, int>::const_iterator chosen = fDelayStrategy.find(vname);
+    if (chosen != fDelayStrategy.end()) {
+        return chosen->second;
+    }
+
+    double shift = (mxd <= 2) ? mxd : 1 + mxd/4.0;
+    double ring = 1 + 1.5*reads;
+    double mirror = 3 + 0.5*reads;
+
+    int strategy = gDelayStrategy;
+    if (strategy == kDelayAuto) {
+        strategy = kDelayShift;
+        if (ring < shift) strategy = kDelayRing;
+        if (mirror < min(shift, ring)) strategy = kDelayMirror;
+    }
+    fDelayStrategy[vname] = strategy;
+
+    if (gDelayReport) {
+        static const char* names[] = { "auto", "shift", "ring", "mirror" };
+        cerr << fClass->getFullClassName() << "::" << vname << " : max delay " << mxd << ", " << reads << " delayed read(s), "
+             << names[strategy] << " (cost shift " << shift << ", ring " << ring << ", mirror " << mirror << ")" << endl;
+    }
+    return strategy;
+}
+
+/**
+ * Generate code for a short delay line, returns the expression of its current value
+ */
+string ScalarCompiler::generateShortDelayLine(const string& ctype, const string& vname, int mxd, int reads, const string& exp)
+{
+    switch (chooseDelayStrategy(vname, mxd, reads)) {
+
+        case kDelayRing : {
+            // ring buffer of size N = 2**x > mxd
+            int N = pow2limit(mxd+1);
+            ensureIotaCode();
+            fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(N)), FieldLayout::kHotField);
+            fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(N)));
+            fClass->addExecCode(subst("$0[IOTA&$1] = $2;", vname, T(N-1), exp));
+            return subst("$0[IOTA&$1]", vname, T(N-1));
+        }
+
+        case kDelayMirror : {
+            // buffer of size 2*L, each value is written twice
+            int L = mxd+1;
+            string index = mirrorIndex(L);
+            fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(2*L)), FieldLayout::kHotField);
+            fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(2*L)));
+            fClass->addExecCode(subst("$0[$1] = $0[$1+$2] = $3;", vname, index, T(L), exp));
+            return subst("$0[$1]", vname, index);
+        }
+
+        default : {
+            // we copy
+            fClass->addDeclCode(subst("$0 \t$1[$2];", ctype, vname, T(mxd+1)), FieldLayout::kHotField);
+            fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", vname, T(mxd+1)));
+            fClass->addExecCode(subst("$0[0] = $1;", vname, exp));
+
+            // generate post processing copy code to update delay values
+            if (mxd == 1) {
+                fClass->addPostCode(subst("$0[1] = $0[0];", vname));
+            } else if (mxd == 2) {
+                fClass->addPostCode(subst("$0[2] = $0[1]; $0[1] = $0[0];", vname));
+            } else {
+                fClass->addPostCode(subst("for (int i=$0; i>0; i--) $1[i] = $1[i-1];", T(mxd), vname));
+            }
+            return subst("$0[0]", vname);
+        }
+    }
+}
+
+/**
+ * Generate the code reading a short delay line
+ */
+string ScalarCompiler::generateShortDelayRead(const string& vname, int mxd, int reads, const string& delay)
+{
+    switch (chooseDelayStrategy(vname, mxd, reads)) {
+        case kDelayRing :
+            ensureIotaCode();
+            return subst("$0[(IOTA-$1)&$2]", vname, delay, T(pow2limit(mxd+1)-1));
+        case kDelayMirror :
+            return subst("$0[$1+$2]", vname, mirrorIndex(mxd+1), delay);
+        default :
+            return subst("$0[$1]", vname, delay);
+    }
+}
+
+/**
+ * The index of the mirrored delay lines of a given size, decreased at each sample
+ */
+string ScalarCompiler::mirrorIndex(int size)
+{
+    if (fMirrorIndex.find(size) == fMirrorIndex.end()) {
+        string index = getFreshID("iMirror");
+        fMirrorIndex[size] = index;
+        fClass->addDeclCode(subst("int \t$0;", index), FieldLayout::kHotField);
+        fClass->addClearCode(subst("$0 = 0;", index));
+        fClass->addPostCode(subst("$0 = ($0 == 0) ? $1 : $0-1;", index, T(size-1)));
+    }
+    return fMirrorIndex[size];
+}
+
+/*****************************************************************************
+							   DELAY LINE POOL (--delay-line-pool)
+
+	The long delay lines of a class are packed in one pool per C++ type, the size
+	of the pool is the power of 2 above the sum of the sizes of its lines. All the
+	lines move with the same write index W (IOTA in scalar mode, the index of the
+	line in vector mode, that has the same value for all the lines at the beginning
+	of each vector). A line of size L at offset B is written at (W-B) and its value
+	delayed by d is read at (W-B-d) : its samples stay in [W-B-L+1, W-B], that
+	doesn't overlap the next line which is at offset B+L.
+
+*****************************************************************************/
+
+bool ScalarCompiler::isPoolDelayLine(const string& vname)
+{
+    return fDelayPoolLine.find(vname) != fDelayPoolLine.end();
+}
+
+/**
+ * Allocate a delay line of the given size (max delay + 1 in scalar mode, max delay
+ * + vector size in vector mode) in the pool of its type, unless already done by a read
+ */
+void ScalarCompiler::allocatePoolDelayLine(const string& ctype, const string& vname, int size)
+{
+    if (isPoolDelayLine(vname)) {
+        return;
+    }
+    string pool = (ctype == "int") ? "iDelayPool" : ((ctype == "double" && fMixedPrecision) ? "dDelayPool" : "fDelayPool");
+    fDelayPoolLine[vname] = make_pair(pool, fDelayPoolSize[pool]);
+    fDelayPoolSize[pool] += size;
+}
+
+/**
+ * Generate the access to a pool delay line, for the write index (as a C++ expression)
+ * and the delay
+ */
+string ScalarCompiler::poolDelayAccess(const string& vname, const string& index, int delay)
+{
+    pair<string,int> line = fDelayPoolLine[vname];
+    int offset = line.second + delay;
+    if (offset == 0) {
+        return subst("$0[($1)&$0Mask]", line.first, index);
+    } else {
+        return subst("$0[($1-$2)&$0Mask]", line.first, index, T(offset));
+    }
+}
+
+/**
+ * Declare the delay line pools, once all the delay lines have been generated
+ */
+void ScalarCompiler::declareDelayPools()
+{
+    for (map<string, int>::const_iterator p = fDelayPoolSize.begin(); p != fDelayPoolSize.end(); p++) {
+        string ctype = (p->first == "iDelayPool") ? "int" : ((p->first == "dDelayPool") ? "double" : ifloat());
+        int size = pow2limit(p->second);
+        fClass->rememberNeedAlignedDef();
+        fClass->addDeclCode(subst("static const int 	$0Mask = $1;", p->first, T(size-1)));
+        fClass->addDeclCode(subst("FAUSTALIGNED $0 	$1[$2];", ctype, p->first, T(size)), FieldLayout::kHotField);
+        fClass->addClearCode(subst("for (int i=0; i<$1; i++) $0[i] = 0;", p->first, T(size)));
+    }
+}
+
 /**
  * Generate code for a unique IOTA variable increased at each sample
  * and used to index ring buffers.
@@ -1349,9 +1728,10 @@ void ScalarCompiler::ensureIotaCode()
 {
     if (!fHasIota) {
         fHasIota = true;
-        fClass->addDeclCode("int \tIOTA;");
+        fClass->addDeclCode("int \tIOTA;", FieldLayout::kHotField);
+        fClass->shareFieldByLanes("IOTA");
         fClass->addClearCode("IOTA = 0;");
-        fClass->addPostCode("IOTA = IOTA+1;");
+        fClass->addSharedPostCode("IOTA = IOTA+1;");
     }
 }
 
@@ -1363,7 +1743,7 @@ void ScalarCompiler::declareWaveform(Tree sig, string& vname, int& size)
 {
     // computes C type and unique name for the waveform
     string ctype;
-    getTypedNames(getCertifiedSigType(sig), "Wave", ctype, vname);
+    getTypedNames(sig, "Wave", ctype, vname);
 
     size = sig->arity();
 
@@ -1379,7 +1759,7 @@ void ScalarCompiler::declareWaveform(Tree sig, string& vname, int& size)
   
     // Declares the Waveform
     fClass->addDeclCode(subst("static $0 \t$1[$2];", ctype, vname, T(size)));
-    fClass->addDeclCode(subst("int \tidx$0;", vname));
+    fClass->addDeclCode(subst("int \tidx$0;", vname), FieldLayout::kHotField);
     fClass->addInitCode(subst("idx$0 = 0;", vname));
     fClass->getTopParentKlass()->addStaticFields(
                 subst("$0 \t$1::$2[$3] = ", ctype, fClass->getFullClassName(), vname, T(size) )
@@ -1395,3 +1775,326 @@ string ScalarCompiler::generateWaveform(Tree sig)
     fClass->addPostCode(subst("idx$0 = (idx$0 + 1) % $1;", vname, T(size)));
     return generateCacheCode(sig, subst("$0[idx$0]", vname));
 }
+
+
+/*****************************************************************************
+                    K-RATE : SLOWLY VARYING SIGNALS
+*****************************************************************************/
+
+/**
+ * Select the signals computed every fKRate samples (-kr option or 'declare krate "K";'
+ * metadata). They are the expensive operations (divisions and math functions) of
+ * signals depending only on the controls, possibly through one pole smoothers.
+ */
+void ScalarCompiler::prepareKRate(Tree L)
+{
+    map<Tree, set<Tree, treeLess>, treeLess>::iterator m = gMetaDataSet.find(tree("krate"));
+
+    // the metadata only applies to this compilation (each file of a -batch compilation)
+    fKRate = gKRate;
+    if (fKRate == 1 && m != gMetaDataSet.end()) {
+        int k = atoi(unquote(tree2str(*m->second.begin())).c_str());
+        if (k > 1 && isPowerOf2(k)) {
+            fKRate = k;
+        } else {
+            cerr << "WARNING : 'krate' metadata ignored, a power of 2 is expected" << endl;
+        }
+    }
+    if (fKRate > 1) {
+        for (; isList(L); L = tl(L)) markKRateRoots(hd(L), true);
+    }
+}
+
+/**
+ * A signal varies slowly when it is computed at control rate, when it is a one pole
+ * smoother of a slowly varying signal, or when all its subsignals vary slowly.
+ */
+bool ScalarCompiler::isKRateSignal(Tree sig)
+{
+    map<Tree, int>::iterator p = fKRateSignal.find(sig);
+    if (p != fKRateSignal.end()) {
+        return p->second > 0;
+    }
+    fKRateSignal[sig] = -1;     // a recursive signal met again during its own analysis is not eligible
+
+    bool    slow = false;
+    int     i, opcode;
+    Tree    x, y, z, r, var, le;
+
+    if (getCertifiedSigType(sig)->variability() < kSamp) {
+        slow = true;
+    } else if (getUserData(sig)) {
+        slow = true;
+        for (int b = 0; b < sig->arity(); b++) slow &= isKRateSignal(sig->branch(b));
+    } else if (isSigBinOp(sig, &opcode, x, y)) {
+        slow = isKRateSignal(x) && isKRateSignal(y);
+    } else if (isSigIntCast(sig, x) || isSigFloatCast(sig, x)) {
+        slow = isKRateSignal(x);
+    } else if (isSigFixDelay(sig, x, y)) {
+        slow = isKRateSignal(x) && (getCertifiedSigType(y)->variability() < kSamp);
+    } else if (isSigSelect2(sig, x, y, z)) {
+        slow = isKRateSignal(x) && isKRateSignal(y) && isKRateSignal(z);
+    } else if (isProj(sig, &i, r) && isRec(r, var, le)) {
+        slow = isKRateSmoother(sig, nth(le, i));
+    }
+
+    fKRateSignal[sig] = slow;
+    return slow;
+}
+
+/**
+ * Test if the definition of a recursive signal is a one pole smoother y = a + c*y'
+ * with a slowly varying input a and a constant pole c in [0,1[.
+ */
+bool ScalarCompiler::isKRateSmoother(Tree sig, Tree body)
+{
+    int     opcode;
+    Tree    x, y;
+
+    if (!isSigBinOp(body, &opcode, x, y) || opcode != kAdd) return false;
+
+    for (int k = 0; k < 2; k++) {
+        Tree a = (k == 0) ? x : y;
+        Tree m = (k == 0) ? y : x;
+        Tree u, v, d, n;
+        if (isSigBinOp(m, &opcode, u, v) && opcode == kMul) {
+            for (int l = 0; l < 2; l++) {
+                Tree c = (l == 0) ? u : v;
+                Tree p = (l == 0) ? v : u;
+                Type t = getCertifiedSigType(c);
+                interval j = t->getInterval();
+                int delay = 0;
+                bool mem = isSigDelay1(p, d) || (isSigFixDelay(p, d, n) && isSigInt(n, &delay) && delay == 1);
+                if (mem && (d == sig) && (t->variability() < kSamp)
+                    && j.valid && (j.lo >= 0) && (j.hi < 1)) {
+                    return isKRateSignal(a);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * The expensive slowly varying signals computed at sample rate and never delayed.
+ */
+bool ScalarCompiler::isKRateRoot(Tree sig)
+{
+    static const char* expensive[] = { "sin", "cos", "tan", "exp", "log", "log10", "pow", "sqrt",
+                                       "asin", "acos", "atan", "atan2", 0 };
+    int         opcode;
+    Tree        x, y;
+    bool        costly = false;
+    Occurences* o = fOccMarkup.retrieve(sig);
+
+    if (getUserData(sig)) {
+        string name = ((xtended*)getUserData(sig))->name();
+        for (int i = 0; expensive[i]; i++) costly |= (name == expensive[i]);
+    } else if (isSigBinOp(sig, &opcode, x, y)) {
+        costly = (opcode == kDiv);
+    }
+    return costly && o && (o->getMaxDelay() == 0)
+        && (getCertifiedSigType(sig)->variability() == kSamp) && isKRateSignal(sig);
+}
+
+/**
+ * Mark the k-rate signals reachable from sig. When interpolation is requested, it
+ * is used for the k-rate signals read at sample rate, the ones only read by other
+ * k-rate computations are held, so that these computations use their exact values.
+ */
+void ScalarCompiler::markKRateRoots(Tree sig, bool sample)
+{
+    int level = sample ? 2 : 1;
+    if (fKRateVisit[sig] >= level) return;
+    fKRateVisit[sig] = level;
+
+    int     i;
+    Tree    r, var, le;
+    bool    root = isKRateRoot(sig);
+
+    if (root) {
+        fKRateRoots[sig] = fKRateRoots[sig] || (sample && gKRateInterpolation
+                                                && getCertifiedSigType(sig)->nature() == kReal);
+    }
+
+    if (isProj(sig, &i, r) && isRec(r, var, le)) {
+        // the recursive definitions are computed at sample rate
+        markKRateRoots(nth(le, i), true);
+    } else {
+        vector<Tree> subsigs;
+        int n = getSubSignals(sig, subsigs, false);
+        for (int k = 0; k < n; k++) markKRateRoots(subsigs[k], sample && !root);
+    }
+}
+
+/**
+ * Compute a k-rate signal in a field updated every fKRate samples. When interpolated,
+ * the field ramps linearly to each new value during the following fKRate samples.
+ */
+string ScalarCompiler::generateKRateCode(Tree sig, const string& exp)
+{
+    string ctype, vname;
+
+    if (!fHasKRate) {
+        fHasKRate = true;
+        fClass->addDeclCode("int \tiKRate;", FieldLayout::kHotField);
+        fClass->addClearCode("iKRate = 0;");
+        fClass->addPostCode(subst("iKRate = ((iKRate + 1) & $0);", T(fKRate-1)));
+        if (gKRateInterpolation) {
+            fClass->addDeclCode("int \tiKRateInit;", FieldLayout::kHotField);
+            fClass->addClearCode("iKRateInit = 0;");
+            fClass->addPostCode("iKRateInit = 1;");
+        }
+    }
+
+    getTypedNames(sig, "Kr", ctype, vname);
+    fClass->addDeclCode(subst("$0 \t$1;", ctype, vname), FieldLayout::kHotField);
+    fClass->addClearCode(subst("$0 = 0;", vname));
+
+    if (fKRateRoots[sig]) {
+        fClass->addDeclCode(subst("$0 \t$1Step;", ctype, vname), FieldLayout::kHotField);
+        fClass->addClearCode(subst("$0Step = 0;", vname));
+        fClass->addExecCode(subst("if (iKRate == 0) { $0 $1Next = $2; $1Step = (iKRateInit) ? (($1Next - $1) * $3) : $4; $1 = (iKRateInit) ? $1 : $1Next; }",
+                                  ctype, vname, exp, T(1.0/fKRate, precision(sig)), T(0.0, precision(sig))));
+        fClass->addPostCode(subst("$0 = ($0 + $0Step);", vname));
+    } else {
+        fClass->addExecCode(subst("if (iKRate == 0) $0 = $1;", vname, exp));
+    }
+    return vname;
+}
+
+/*****************************************************************************
+                    MIXED PRECISION : DOUBLE PRECISION FEEDBACK LOOPS
+*****************************************************************************/
+
+/**
+ * Select the signals computed in double precision in a single precision program
+ * (-mp option or 'declare precision "mixed";' metadata) : the real recursive signals,
+ * and the parts of their definitions that depend on the recursion or only on the
+ * controls and the other recursive signals (the filter coefficients). The other signals
+ * stay in single precision.
+ */
+void ScalarCompiler::preparePrecision(Tree L)
+{
+    map<Tree, set<Tree, treeLess>, treeLess>::iterator m = gMetaDataSet.find(tree("precision"));
+
+    if (m != gMetaDataSet.end() && unquote(tree2str(*m->second.begin())) == "mixed") {
+        if (gFloatSize == 1) {
+            fMixedPrecision = true;
+        } else {
+            cerr << "WARNING : 'precision' metadata ignored, only single precision programs can use mixed precision" << endl;
+        }
+    }
+    if (gMixedPrecision) {
+        fMixedPrecision = true;
+    }
+    if (fMixedPrecision) {
+        set<Tree> visited;
+        for (; isList(L); L = tl(L)) promoteRecursions(hd(L), visited);
+    }
+}
+
+/**
+ * Promote the real recursive signals used by sig and their feedback paths
+ */
+void ScalarCompiler::promoteRecursions(Tree sig, set<Tree>& visited)
+{
+    int     i;
+    Tree    r, var, le;
+
+    if (visited.count(sig)) return;
+    visited.insert(sig);
+
+    if (isProj(sig, &i, r) && isRec(r, var, le)) {
+        if (getCertifiedSigType(sig)->nature() == kReal) {
+            set<Tree> feedback;
+            fPromoted[sig] = true;
+            promoteFeedback(nth(le, i), feedback);
+        }
+        promoteRecursions(nth(le, i), visited);
+    } else {
+        vector<Tree> v; getSubSignals(sig, v);
+        for (size_t k = 0; k < v.size(); k++) promoteRecursions(v[k], visited);
+    }
+}
+
+/**
+ * Promote the real signals of a recursive definition that depend on the recursion
+ * or are not computed from the audio inputs (the filter coefficients). Tables,
+ * waveforms and inputs keep the precision of the program.
+ */
+void ScalarCompiler::promoteFeedback(Tree sig, set<Tree>& visited)
+{
+    int     i;
+    Tree    r, x, y, z;
+
+    if (visited.count(sig)) return;
+    visited.insert(sig);
+
+    if (isProj(sig, &i, r) || isSigInput(sig, &i) || isSigWaveform(sig) || isSigGen(sig, x)
+        || isSigTable(sig, x, y, z) || isSigWRTbl(sig, x, y, z, r) || isSigRDTbl(sig, x, y)) {
+        return;
+    }
+
+    Type t = getCertifiedSigType(sig);
+    if (t->nature() == kReal && (getRecursivness(sig) > 0 || !dependsOnInput(sig))) {
+        fPromoted[sig] = true;
+    }
+    vector<Tree> v; getSubSignals(sig, v);
+    for (size_t k = 0; k < v.size(); k++) promoteFeedback(v[k], visited);
+}
+
+/**
+ * Test if a signal is computed from the audio inputs, the recursive signals being
+ * considered as independent of the inputs
+ */
+bool ScalarCompiler::dependsOnInput(Tree sig)
+{
+    map<Tree, bool>::iterator p = fInputDependency.find(sig);
+    if (p != fInputDependency.end()) {
+        return p->second;
+    }
+
+    int     i;
+    Tree    r;
+    bool    dep = isSigInput(sig, &i);
+
+    if (!dep && !isProj(sig, &i, r)) {
+        vector<Tree> v; getSubSignals(sig, v);
+        for (size_t k = 0; k < v.size() && !dep; k++) dep = dependsOnInput(v[k]);
+    }
+    fInputDependency[sig] = dep;
+    return dep;
+}
+
+bool ScalarCompiler::isPromoted(Tree sig)
+{
+    return fMixedPrecision && fPromoted.find(sig) != fPromoted.end();
+}
+
+/**
+ * C type of a real signal, taking the mixed precision into account
+ */
+string ScalarCompiler::realType(Tree sig)
+{
+    return ifloat(precision(sig));
+}
+
+/**
+ * Precision of a real signal (see floats.hh) : double for the promoted signals
+ * in mixed precision, the precision of the program otherwise
+ */
+int ScalarCompiler::precision(Tree sig)
+{
+    return isPromoted(sig) ? 2 : gFloatSize;
+}
+
+/**
+ * Print the variables declared in double precision (-mpr option)
+ */
+void ScalarCompiler::printPrecisionReport()
+{
+    cerr << fClass->getClassName() << " : " << fPromotedNames.size() << " variables in double precision :";
+    for (size_t i = 0; i < fPromotedNames.size(); i++) cerr << " " << fPromotedNames[i];
+    cerr << endl;
+}
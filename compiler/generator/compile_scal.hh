@@ -31,6 +31,11 @@
 #include "occurences.hh"
 #include "property.hh"
 
+/**
+ * Implementation of the short delay lines (max delay < gMaxCopyDelay) in scalar mode
+ */
+enum { kDelayAuto, kDelayShift, kDelayRing, kDelayMirror };
+
 ////////////////////////////////////////////////////////////////////////
 /**
  * Compile a list of FAUST signals into a scalar C++ class
@@ -49,23 +54,40 @@ class ScalarCompiler : public Compiler
 	Tree                      	fSharingKey;
 	OccMarkup					fOccMarkup;
     bool						fHasIota;
+    map<string, int>            fDelayStrategy;     ///< strategy of each short delay line
+    map<string, int>            fDelayReads;        ///< number of delayed reads of each recursive delay line
+    map<int, string>            fMirrorIndex;       ///< index shared by the mirrored delay lines of the same length
+    map<string, int>            fDelayPoolSize;     ///< size of each delay line pool
+    map<string, pair<string,int> > fDelayPoolLine;  ///< pool and offset of each long delay line
+    map<Tree, int>              fKRateSignal;       ///< k-rate analysis of the signals : 1 slowly varying, 0 not, -1 being analyzed
+    map<Tree, int>              fKRateVisit;        ///< 1 when visited from a k-rate computation, 2 when used at sample rate
+    map<Tree, bool>             fKRateRoots;        ///< signals computed every fKRate samples, true when interpolated
+    bool                        fHasKRate;
+    int                         fKRate;             ///< period of the k-rate signals (-kr option or 'krate' metadata)
+    map<Tree, bool>             fPromoted;          ///< signals computed in double precision in mixed precision mode
+    map<Tree, bool>             fInputDependency;   ///< signals computed from the audio inputs
+    vector<string>              fPromotedNames;     ///< variables declared in double precision in mixed precision mode
+    bool                        fMixedPrecision;    ///< -mp option or 'precision' metadata of this compilation
+    int                         fUserPrecision;     ///< precision of the expression being generated, given to the real constants it uses (mixed precision)
 
 
   public:
 
 	ScalarCompiler ( const string& name, const string& super, int numInputs, int numOutputs) :
 		Compiler(name,super,numInputs,numOutputs,false),
-        fHasIota(false)
+        fHasIota(false), fHasKRate(false), fKRate(1), fMixedPrecision(false), fUserPrecision(1)
 	{}
 	
 	ScalarCompiler ( Klass* k) : 
 		Compiler(k),
-        fHasIota(false)
+        fHasIota(false), fHasKRate(false), fKRate(1), fMixedPrecision(false), fUserPrecision(1)
 	{}
 	
 	virtual void 		compileMultiSignal  (Tree lsig);
 	virtual void		compileSingleSignal (Tree lsig);
 
+	static void			resetFreshIDs()		{ fIDCounters.clear(); }	///< restart the numbering of the variables (batch mode)
+
 
   protected:
 
@@ -75,6 +97,7 @@ class ScalarCompiler : public Compiler
     virtual string      forceCacheCode(Tree sig, const string& exp) ;
 
     virtual string      generateVariableStore(Tree sig, const string& exp);
+    int                 fieldCategory(Tree sig);
 
 	string 		getFreshID (const string& prefix);
 
@@ -108,11 +131,14 @@ class ScalarCompiler : public Compiler
 
     string          generateInput 		(Tree sig, const string& idx);
     string          generateOutput		(Tree sig, const string& idx, const string& arg1);
+    void            generateInPlaceCache();
 	
     string          generateTable 		(Tree sig, Tree tsize, Tree content);
     string          generateStaticTable	(Tree sig, Tree tsize, Tree content);
+    bool            declareConstTable	(const string& ctype, const string& vname, int size, Tree g);
     string          generateWRTbl 		(Tree sig, Tree tbl, Tree idx, Tree data);
     string          generateRDTbl 		(Tree sig, Tree tbl, Tree idx);
+    void            countTableIndex 	(Tree tbl, Tree idx);
     string          generateSigGen		(Tree sig, Tree content);
     string          generateStaticSigGen(Tree sig, Tree content);
 	
@@ -143,12 +169,36 @@ class ScalarCompiler : public Compiler
 	//string		generateDelayVecWithTemp(Tree sig, const string& exp, const string& ctype, const string& vname, int mxd);
     virtual void    generateDelayLine(const string& ctype, const string& vname, int mxd, const string& exp);
 
-    void            getTypedNames(Type t, const string& prefix, string& ctype, string& vname);
+    void            getTypedNames(Tree sig, const string& prefix, string& ctype, string& vname);
     void            ensureIotaCode();
+    int             chooseDelayStrategy(const string& vname, int mxd, int reads);
+    string          generateShortDelayLine(const string& ctype, const string& vname, int mxd, int reads, const string& exp);
+    string          generateShortDelayRead(const string& vname, int mxd, int reads, const string& delay);
+    string          mirrorIndex(int size);
+    bool            isPoolDelayLine(const string& vname);
+    void            allocatePoolDelayLine(const string& ctype, const string& vname, int size);
+    string          poolDelayAccess(const string& vname, const string& index, int delay);
+    void            declareDelayPools();
     int             pow2limit(int x);
 
     void            declareWaveform(Tree sig, string& vname, int& size);
 
+    void            prepareKRate(Tree L);
+    bool            isKRateSignal(Tree sig);
+    bool            isKRateSmoother(Tree sig, Tree body);
+    bool            isKRateRoot(Tree sig);
+    void            markKRateRoots(Tree sig, bool sample);
+    string          generateKRateCode(Tree sig, const string& exp);
+
+    void            preparePrecision(Tree L);
+    void            promoteRecursions(Tree sig, set<Tree>& visited);
+    void            promoteFeedback(Tree sig, set<Tree>& visited);
+    bool            dependsOnInput(Tree sig);
+    bool            isPromoted(Tree sig);
+    string          realType(Tree sig);
+    int             precision(Tree sig);
+    void            printPrecisionReport();
+
 
 
 };
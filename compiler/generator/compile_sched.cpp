@@ -26,6 +26,7 @@
 #include "ppsig.hh"
 
 extern int gVecSize;
+extern bool gDelayPool;
 
 void SchedulerCompiler::compileMultiSignal (Tree L)
 {
@@ -47,9 +48,12 @@ void SchedulerCompiler::compileMultiSignal (Tree L)
         Tree sig = hd(L);
         fClass->openLoop("count");
         fClass->addExecCode(subst("output$0[i] = $2$1;", T(i), CS(sig), xcast()));
+        generateSIMDOutput(i, sig);
         fClass->closeLoop(sig);
     }
     
+    declareDelayPools();
+
     // Build tasks list 
     fClass->buildTasksList();
     
@@ -135,6 +139,11 @@ void  SchedulerCompiler::dlineLoop (const string& tname, const string& dlname, i
     } else {
         
         // Implementation of a ring-buffer delayline
+
+        if (gDelayPool) {
+            poolDlineLoop(tname, dlname, delay, cexp);
+            return;
+        }
         
         // the size should be large enough and aligned on a power of two
         delay   = pow2limit(delay + gVecSize);
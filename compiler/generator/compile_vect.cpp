@@ -26,9 +26,11 @@
 #include "compile_vect.hh"
 #include "floats.hh"
 #include "ppsig.hh"
+#include "sigcost.hh"
 
 extern int gVecSize;
 extern bool gPrintJSONSwitch;
+extern bool gDelayPool;
 
 string makeDrawPath();
 
@@ -52,8 +54,10 @@ void VectorCompiler::compileMultiSignal (Tree L)
         Tree sig = hd(L);
         fClass->openLoop("count");
         fClass->addExecCode(subst("output$0[i] = $2$1;", T(i), CS(sig), xcast()));
+        generateSIMDOutput(i, sig);
         fClass->closeLoop(sig);
     }
+    declareDelayPools();
 
     generateMetaData();
     generateUserInterfaceTree(prepareUserInterfaceTree(fUIRoot));
@@ -185,25 +189,40 @@ string VectorCompiler::generateLoopCode (Tree sig)
             // projection of a recursive group x
             if (l->hasRecDependencyIn(singleton(x))) {
                 // x is already in the loop stack
+                addNodeCost(sig);
                 return ScalarCompiler::generateCode(sig);
             } else {
                 // x must be defined
                 fClass->openLoop(x, "count");
+                addNodeCost(sig);
                 string c = ScalarCompiler::generateCode(sig);
                 fClass->closeLoop(sig);
                 return c;
             }
         } else {
             fClass->openLoop("count");
+            addNodeCost(sig);
             string c = ScalarCompiler::generateCode(sig);
             fClass->closeLoop(sig);
             return c;
         }
     } else {
+        addNodeCost(sig);
         return ScalarCompiler::generateCode(sig);
     }
 }
 
+/**
+ * Add the estimated cost of the top node of a sample rate signal to the
+ * loop that computes it (slower signals are computed outside the loops)
+ */
+void VectorCompiler::addNodeCost(Tree sig)
+{
+    if (getCertifiedSigType(sig)->variability() == kSamp) {
+        fClass->topLoop()->addCost(sigNodeCost(sig));
+    }
+}
+
 
 /**
  * Generate cache code for a signal if needed
@@ -227,19 +246,21 @@ string VectorCompiler::generateCacheCode(Tree sig, const string& exp)
         } else {
             // it is a non-sample expressions but used delayed
             // we need a delay line
-			getTypedNames(getCertifiedSigType(sig), "Vec", ctype, vname);
+			getTypedNames(sig, "Vec", ctype, vname);
             if ((sharing > 1) && !verySimple(sig)) {
                 // first cache this expression because it
                 // it is shared and complex
                 string cachedexp =  generateVariableStore(sig, exp);
                 generateDelayLine(ctype, vname, d, cachedexp);
                 setVectorNameProperty(sig, vname);
+                generateSIMDStore(sig, vname, d, cachedexp);
                 return cachedexp;
             } else {
                 // no need to cache this expression because
                 // it is either not shared or very simple
                 generateDelayLine(ctype, vname, d, exp);
                 setVectorNameProperty(sig, vname);
+                generateSIMDStore(sig, vname, d, exp);
                 return exp;
             }
         }
@@ -247,15 +268,19 @@ string VectorCompiler::generateCacheCode(Tree sig, const string& exp)
         // sample-rate signal
         if (d > 0) {
             // used delayed : we need a delay line
-            getTypedNames(getCertifiedSigType(sig), "Yec", ctype, vname);
+            getTypedNames(sig, "Yec", ctype, vname);
             generateDelayLine(ctype, vname, d, exp);
             setVectorNameProperty(sig, vname);
+            generateSIMDStore(sig, vname, d, exp);
 
             if (verySimple(sig)) {
                 return exp;
             } else {
                 if (d < gMaxCopyDelay) {
                     return subst("$0[i]", vname);
+                } else if (gDelayPool) {
+                    // the ring buffer is a part of the delay line pool
+                    return poolDelayAccess(vname, subst("$0_idx+i", vname), 0);
                 } else {
                     // we use a ring buffer
                     string mask = T(pow2limit(d + gVecSize)-1);
@@ -267,9 +292,10 @@ string VectorCompiler::generateCacheCode(Tree sig, const string& exp)
             if ( sharing > 1 && ! verySimple(sig) ) {
                 // shared and not simple : we need a vector
                 // cerr << "ZEC : " << ppsig(sig) << endl;
-                getTypedNames(getCertifiedSigType(sig), "Zec", ctype, vname);
+                getTypedNames(sig, "Zec", ctype, vname);
                 generateDelayLine(ctype, vname, d, exp);
                 setVectorNameProperty(sig, vname);
+                generateSIMDStore(sig, vname, d, exp);
                 return subst("$0[i]", vname);
            } else {
                 // not shared or simple : no cache needed
@@ -323,6 +349,7 @@ bool VectorCompiler::needSeparateLoop(Tree sig)
 
 void VectorCompiler::generateDelayLine(const string& ctype, const string& vname, int mxd, const string& exp)
 {
+    fClass->topLoop()->addCost(sigStoreCost(mxd, mxd >= gMaxCopyDelay));
     if (mxd == 0) {
         vectorLoop(ctype, vname, exp);
     } else {
@@ -336,8 +363,10 @@ string VectorCompiler::generateVariableStore(Tree sig, const string& exp)
 
     if (getCertifiedSigType(sig)->variability() == kSamp) {
         string      vname, ctype;
-        getTypedNames(t, "Vector", ctype, vname);
+        getTypedNames(sig, "Vector", ctype, vname);
+        fClass->topLoop()->addCost(sigStoreCost(0, false));
         vectorLoop(ctype, vname, exp);
+        generateSIMDStore(sig, vname, 0, exp);
         return subst("$0[i]", vname);
     } else {
         return ScalarCompiler::generateVariableStore(sig, exp);
@@ -388,9 +417,19 @@ string VectorCompiler::generateFixDelay (Tree sig, Tree exp, Tree delay)
 
     } else {
 
-        // long delay : we use a ring buffer of size 2^x
+        // long delay : we use a ring buffer of size 2^x or a part of the delay line pool
         int     N   = pow2limit( mxd+gVecSize );
 
+        if (gDelayPool) {
+            // the reads of a recursive signal are generated before its line
+            allocatePoolDelayLine((getCertifiedSigType(exp)->nature() == kInt) ? "int" : ifloat(), vecname, mxd+gVecSize);
+            if (isSigInt(delay, &d)) {
+                return poolDelayAccess(vecname, subst("$0_idx+i", vecname), d);
+            } else {
+                return poolDelayAccess(vecname, subst("$0_idx+i-$1", vecname, CS(delay)), 0);
+            }
+        }
+
         if (isSigInt(delay, &d)) {
             if (d == 0) {
                 return subst("$0[($0_idx+i)&$1]", vecname, T(N-1));
@@ -415,6 +454,7 @@ string VectorCompiler::generateDelayVec(Tree sig, const string& exp, const strin
     // we need a delay line
     generateDelayLine(ctype, vname, mxd, exp);
     setVectorNameProperty(sig, vname);
+    generateSIMDStore(sig, vname, mxd, exp);
     if (verySimple(sig)) {
         return exp;
     } else {
@@ -506,6 +546,11 @@ void  VectorCompiler::dlineLoop (const string& tname, const string& dlname, int
 
         // Implementation of a ring-buffer delayline
 
+        if (gDelayPool) {
+            poolDlineLoop(tname, dlname, delay, cexp);
+            return;
+        }
+
         // the size should be large enough and aligned on a power of two
         delay   = pow2limit(delay + gVecSize);
         string  dsize   = T(delay);
@@ -537,6 +582,41 @@ void  VectorCompiler::dlineLoop (const string& tname, const string& dlname, int
 }
 
 
+/**
+ * Generate the code for a long delay line in the delay line pool (--delay-line-pool). The line
+ * keeps its own index, updated at the beginning of its loop, to be independent from the other
+ * loops : all the indexes have the same value at the beginning of a vector.
+ * @param tname the name of the C++ type (float or int)
+ * @param dlname the name of the delay line (vector) to be used.
+ * @param delay the maximum delay
+ * @param cexp the content of the signal as a C++ expression
+ */
+void  VectorCompiler::poolDlineLoop (const string& tname, const string& dlname, int delay, const string& cexp)
+{
+    // the line needs delay + gVecSize samples
+    allocatePoolDelayLine(tname, dlname, delay + gVecSize);
+    string  mask    = subst("$0Mask", (tname == "int") ? "iDelayPool" : "fDelayPool");
+
+    // create names for the index
+    string  idx = subst("$0_idx", dlname);
+    string  idx_save = subst("$0_idx_save", dlname);
+
+    fClass->addDeclCode(subst("int \t$0;", idx));
+    fClass->addDeclCode(subst("int \t$0;", idx_save));
+    fClass->addClearCode(subst("$0 = 0;", idx));
+    fClass->addClearCode(subst("$0 = 0;", idx_save));
+
+    // -- update index
+    fClass->addPreCode(subst("$0 = ($0+$1)&$2;", idx, idx_save, mask));
+
+    // -- compute the new samples
+    fClass->addExecCode(subst("$0 = $1;", poolDelayAccess(dlname, subst("$0+i", idx), 0), cexp));
+
+    // -- save index
+    fClass->addPostCode(subst("$0 = count;", idx_save));
+}
+
+
 string VectorCompiler::generateWaveform(Tree sig)
 {
     string  vname;
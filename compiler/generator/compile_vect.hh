@@ -42,10 +42,10 @@ class VectorCompiler : public ScalarCompiler
 public:
 
     VectorCompiler (const string& name, const string& super, int numInputs, int numOutputs)
-        : ScalarCompiler(name,super,numInputs,numOutputs)
+        : ScalarCompiler(name,super,numInputs,numOutputs), fSIMDLaneCount(0)
         {}
     
-    VectorCompiler (Klass* k) : ScalarCompiler(k)
+    VectorCompiler (Klass* k) : ScalarCompiler(k), fSIMDLaneCount(0)
     {}
     virtual void compileMultiSignal (Tree L);
 
@@ -64,9 +64,25 @@ protected:
     virtual string      generateDelayVec(Tree sig, const string& exp, const string& ctype, const string& vname, int mxd);
     virtual void        vectorLoop (const string& tname, const string& dlname, const string& cexp);
     virtual void        dlineLoop ( const string& tname, const string& dlname, int delay, const string& cexp);
+    void                poolDlineLoop ( const string& tname, const string& dlname, int delay, const string& cexp);
     virtual string      generateWaveform(Tree sig);
 
     bool    needSeparateLoop(Tree sig);
+    void    addNodeCost(Tree sig);
+
+    // SIMD kernels (-simd option), see simdkernel.cpp
+    enum { kSIMDUniform, kSIMDReal, kSIMDInt, kSIMDMask };
+
+    void    generateSIMDStore(Tree sig, const string& vname, int mxd, const string& exp);
+    void    generateSIMDOutput(int i, Tree sig);
+    bool    generateSIMDCode(Tree sig, int& kind, string& code);
+    bool    generateSIMDXtended(Tree sig, string& code);
+    string  simdReal(int kind, const string& code);
+
+    map<Tree, string>   fSIMDLoads;         ///< signals stored in a vector, and the vector code loading them
+    list<string>        fSIMDLines;         ///< vector code of the line being translated
+    set<string>         fSIMDShiftedReads;  ///< vectors read at an offset of i by this line
+    int                 fSIMDLaneCount;     ///< to name the arrays used for the lane by lane computations
     
 };
 
@@ -0,0 +1,205 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+/**********************************************************************
+			- fieldlayout.cpp : order of the fields of the dsp class
+			  according to their accesses (-fl option) -
+
+***********************************************************************/
+
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include "fieldlayout.hh"
+
+static const int kCacheLine = 64;
+
+struct Field {
+    string  line;
+    int     category;
+    int     bytes;
+    int     align;
+    int     index;
+};
+
+static string trim (const string& s)
+{
+    size_t b = s.find_first_not_of(" \t");
+    size_t e = s.find_last_not_of(" \t");
+    return (b == string::npos) ? "" : s.substr(b, e-b+1);
+}
+
+/**
+ * Split a declaration "type name;" or "type name[size];" and returns false
+ * when the line has another form.
+ */
+bool splitDecl (const string& line, string& type, string& name, string& size)
+{
+    string s = trim(line);
+    if (s.empty() || s[s.size()-1] != ';' || s.find('=') != string::npos) return false;
+    s = trim(s.substr(0, s.size()-1));
+    size_t p = s.find_last_of(" \t");
+    if (p == string::npos) return false;
+    type = trim(s.substr(0, p));
+    string var = s.substr(p+1);
+    size_t b = var.find('[');
+    name = var.substr(0, b);
+    size = (b == string::npos) ? "" : var.substr(b);
+    return !type.empty() && !name.empty();
+}
+
+/**
+ * Size in bytes and alignment of a field, as laid out by the usual 64 bits ABIs
+ * (FAUSTFLOAT being float)
+ */
+static void fieldSize (const string& type, const string& size, int& bytes, int& align)
+{
+    string  t = type;
+    bool    aligned = (t.compare(0, 12, "FAUSTALIGNED") == 0);
+
+    if (aligned) t = trim(t.substr(12));
+
+    if (t.find('*') != string::npos) {
+        bytes = 8;
+    } else if (t == "int" || t == "float" || t == "FAUSTFLOAT") {
+        bytes = 4;
+    } else if (t == "long double") {
+        bytes = 16;
+    } else if (t == "bool" || t == "char") {
+        bytes = 1;
+    } else {
+        bytes = 8;
+    }
+    align = (aligned) ? kCacheLine : bytes;
+
+    for (size_t b = size.find('['); b != string::npos; b = size.find('[', b+1)) {
+        int count = atoi(size.c_str() + b + 1);
+        if (count > 0) bytes *= count;
+    }
+}
+
+/**
+ * Hottest category first. In a category, the small fields by decreasing alignment
+ * to avoid the padding, then the arrays by increasing size.
+ */
+static bool hotterField (const Field& a, const Field& b)
+{
+    if (a.category != b.category) return a.category < b.category;
+    bool abig = (a.bytes > kCacheLine);
+    bool bbig = (b.bytes > kCacheLine);
+    if (abig != bbig) return bbig;
+    if (abig && a.bytes != b.bytes) return a.bytes < b.bytes;
+    if (!abig && a.align != b.align) return a.align > b.align;
+    return a.index < b.index;
+}
+
+static void alignField (Field& f)
+{
+    if (f.line.find("FAUSTALIGNED") == string::npos) {
+        f.line = "FAUSTALIGNED " + trim(f.line);
+    }
+}
+
+int FieldLayout::category (const string& name) const
+{
+    map<string, int>::const_iterator p = fCategories.find(name);
+    return (p == fCategories.end()) ? kColdField : p->second;
+}
+
+/**
+ * Order the declarations of the fields, the static fields and the unknown
+ * declarations staying first. When align is true, the fields following the
+ * per sample state and the UI zones start on a new cache line : the class is
+ * then aligned on a cache line and its size is a multiple of the cache line,
+ * so that the instances of an array do not share cache lines.
+ */
+void FieldLayout::order (list<string>& decl, bool align) const
+{
+    list<string>    others;
+    vector<Field>   fields;
+
+    for (list<string>::iterator p = decl.begin(); p != decl.end(); p++) {
+        string type, name, size;
+        if (p->compare(0, 6, "static") == 0 || !splitDecl(*p, type, name, size)) {
+            others.push_back(*p);
+        } else {
+            Field f;
+            f.line      = *p;
+            f.category  = category(name);
+            f.index     = int(fields.size());
+            fieldSize(type, size, f.bytes, f.align);
+            fields.push_back(f);
+        }
+    }
+    stable_sort(fields.begin(), fields.end(), hotterField);
+
+    if (align && !fields.empty()) {
+        bool aligned = false;
+        for (size_t i = 1; i < fields.size(); i++) {
+            if (fields[i].category != fields[i-1].category
+                && (fields[i].category == kUIField || fields[i-1].category == kHotField)) {
+                alignField(fields[i]);
+                aligned = true;
+            }
+        }
+        if (!aligned) {
+            alignField(fields[0]);
+        }
+    }
+
+    decl = others;
+    for (size_t i = 0; i < fields.size(); i++) decl.push_back(fields[i].line);
+}
+
+/**
+ * Print the size of the class and of each category of fields (-flr option). The
+ * offsets are computed as the C++ compiler does, after the virtual table pointer,
+ * to give the number of cache lines touched by the per sample state.
+ */
+void FieldLayout::report (const string& klass, const list<string>& decl) const
+{
+    int         offset = 8;
+    int         maxalign = 8;
+    int         bytes[4] = { 0, 0, 0, 0 };
+    set<int>    hotLines;
+
+    for (list<string>::const_iterator p = decl.begin(); p != decl.end(); p++) {
+        string type, name, size;
+        if (p->compare(0, 6, "static") == 0 || !splitDecl(*p, type, name, size)) continue;
+        int b, a, c = category(name);
+        fieldSize(type, size, b, a);
+        offset = (offset + a - 1) / a * a;
+        maxalign = max(maxalign, a);
+        bytes[c] += b;
+        if (c == kHotField) {
+            for (int l = offset / kCacheLine; l <= (offset + b - 1) / kCacheLine; l++) hotLines.insert(l);
+        }
+        offset += b;
+    }
+    offset = (offset + maxalign - 1) / maxalign * maxalign;
+
+    cerr << klass << " : sizeof " << offset << " bytes, per sample state " << bytes[kHotField]
+         << " bytes in " << hotLines.size() << " cache lines, per block " << bytes[kBlockField]
+         << " bytes, init only " << bytes[kColdField] << " bytes, UI zones " << bytes[kUIField] << " bytes" << endl;
+}
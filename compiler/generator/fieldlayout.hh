@@ -0,0 +1,58 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+
+
+#ifndef _FIELDLAYOUT_H
+#define _FIELDLAYOUT_H
+
+#include <string>
+#include <list>
+#include <map>
+
+using namespace std;
+
+/**
+ * Layout of the fields of a dsp class according to their accesses (-fl option) :
+ * per sample state first, then the fields used once per block, the fields only
+ * used by the init methods and the UI zones last. Each category is ordered to
+ * limit the padding, the small fields first. The category of a field is given
+ * by the compiler when the field is declared, the other fields are init only.
+ */
+class FieldLayout
+{
+    map<string, int>    fCategories;    ///< category of the fields, indexed by name
+
+ public:
+
+    enum { kHotField, kBlockField, kColdField, kUIField };
+
+    void    setCategory (const string& name, int category) { fCategories[name] = category; }
+    int     category (const string& name) const;
+    void    order (list<string>& decl, bool align) const;
+    void    report (const string& klass, const list<string>& decl) const;
+};
+
+bool splitDecl (const string& line, string& type, string& name, string& size);
+
+#endif
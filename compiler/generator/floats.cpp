@@ -46,6 +46,12 @@ const char* inumix()  { return numsuffix [gFloatSize]; } ///< suffix for numeric
 const char* ifloat() { return floatname[gFloatSize]; }
 const char* icast()  { return castname[gFloatSize]; }
 
+const char* isuffix(int precision) { return mathsuffix[precision]; }
+const char* inumix(int precision)  { return numsuffix [precision]; }
+
+const char* ifloat(int precision) { return floatname[precision]; }
+const char* icast(int precision)  { return castname[precision]; }
+
 const char* xfloat() { return floatname[0]; }
 const char* xcast()  { return castname[0]; }
 
@@ -32,6 +32,14 @@ const char* inumix();
 const char* ifloat();
 const char* icast();
 
+// same for a given precision (1 : float, 2 : double, 3 : long double), used
+// by the mixed precision code where it differs from the precision of the program
+const char* isuffix(int precision);
+const char* inumix(int precision);
+
+const char* ifloat(int precision);
+const char* icast(int precision);
+
 const char* xfloat();
 const char* xcast();
 
@@ -49,9 +49,12 @@
 #include "signals.hh"
 #include "ppsig.hh"
 #include "recursivness.hh"
+#include "mathmode.hh"
 
 
 extern int  gFloatSize;
+extern int  gFieldLayout;
+extern bool gFieldLayoutReport;
 extern bool gVectorSwitch;
 extern bool gDeepFirstSwitch;
 extern bool gOpenMPSwitch;
@@ -61,8 +64,10 @@ extern int  gVecSize;
 extern bool gUIMacroSwitch;
 extern int  gVectorLoopVariant;
 extern bool	gGroupTaskSwitch;
+extern int  gMinTaskCost;
+extern bool gDelayPool;
 
-extern map<Tree, set<Tree> > gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 static int gTaskCount = 0;
 
 void tab (int n, ostream& fout)
@@ -72,6 +77,18 @@ void tab (int n, ostream& fout)
 }
 
 bool Klass::fNeedPowerDef = false;
+bool Klass::fNeedDoublePowerDef = false;
+bool Klass::fNeedAlignedDef = false;
+bool Klass::fNeedMathDef = false;
+
+void Klass::resetStatics()
+{
+    fNeedPowerDef = false;
+    fNeedDoublePowerDef = false;
+    fNeedAlignedDef = false;
+    fNeedMathDef = false;
+    gTaskCount = 0;
+}
 
 /**
  * Store the loop used to compute a signal
@@ -238,7 +255,8 @@ void Klass::printAdditionalCode(ostream& fout)
             fout << "template <> 	 inline float faustpower<1>(float x)          { return x; }" << endl;
             fout << "template <> 	 inline float faustpower<2>(float x)          { return x*x; }" << endl;
             
-        } else if (gFloatSize==2) {
+        }
+        if (gFloatSize==2 || fNeedDoublePowerDef) {
         
             fout << "template <int N> inline double faustpower(double x)          { return faustpower<N/2>(x) * faustpower<N-N/2>(x); } " << endl;
             fout << "template <> 	 inline double faustpower<0>(double x)        { return 1; }" << endl;
@@ -254,22 +272,70 @@ void Klass::printAdditionalCode(ostream& fout)
 
     }
 
+    if (fNeedAlignedDef || gFieldLayout > 1) {
+        // Cache line alignment of the delay line pools
+        fout << "#ifndef FAUSTALIGNED" << endl;
+        fout << "#if defined(__GNUC__)" << endl;
+        fout << "#define FAUSTALIGNED __attribute__((aligned(64)))" << endl;
+        fout << "#elif defined(_MSC_VER)" << endl;
+        fout << "#define FAUSTALIGNED __declspec(align(64))" << endl;
+        fout << "#else" << endl;
+        fout << "#define FAUSTALIGNED" << endl;
+        fout << "#endif" << endl;
+        fout << "#endif" << endl;
+
+        // The classes with aligned fields are allocated on a cache line (before C++17 new only
+        // guarantees the alignment of the fundamental types)
+        fout << "#ifndef FAUSTALIGNEDNEW" << endl;
+        fout << "#define FAUSTALIGNEDNEW" << endl;
+        fout << "#include <new>" << endl;
+        fout << "#include <stdlib.h>" << endl;
+        fout << "#if defined(_MSC_VER)" << endl;
+        fout << "#include <malloc.h>" << endl;
+        fout << "#endif" << endl;
+        fout << "inline void* faustalignednew(size_t size)" << endl;
+        fout << "{" << endl;
+        fout << "#if defined(_MSC_VER)" << endl;
+        fout << "    void* ptr = _aligned_malloc(size, 64);" << endl;
+        fout << "#else" << endl;
+        fout << "    void* ptr = 0;" << endl;
+        fout << "    if (posix_memalign(&ptr, 64, size) != 0) ptr = 0;" << endl;
+        fout << "#endif" << endl;
+        fout << "    if (!ptr) throw std::bad_alloc();" << endl;
+        fout << "    return ptr;" << endl;
+        fout << "}" << endl;
+        fout << "inline void faustaligneddelete(void* ptr)" << endl;
+        fout << "{" << endl;
+        fout << "#if defined(_MSC_VER)" << endl;
+        fout << "    _aligned_free(ptr);" << endl;
+        fout << "#else" << endl;
+        fout << "    free(ptr);" << endl;
+        fout << "#endif" << endl;
+        fout << "}" << endl;
+        fout << "#endif" << endl;
+    }
+
+    if (fNeedMathDef) {
+        // Fast math functions and table interpolation (-mm)
+        printMathDef(fout);
+    }
+
 }
 
 /**
  * Print metadata declaration
  */
-void Klass::printMetadata(int n, const map<Tree, set<Tree> >& S, ostream& fout)
+void Klass::printMetadata(int n, const map<Tree, set<Tree, treeLess>, treeLess>& S, ostream& fout)
 {
     tab(n,fout); fout << "virtual void metadata(Meta* m) { ";
     
     // We do not want to accumulate metadata from all hierachical levels, so the upper level only is kept
-    for (map<Tree, set<Tree> >::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
+    for (map<Tree, set<Tree, treeLess>, treeLess>::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
         if (i->first != tree("author")) {
             tab(n+1,fout); fout << "m->declare(\"" << *(i->first) << "\", " << **(i->second.begin()) << ");";
         } else {
             // But the "author" meta data is accumulated, the upper level becomes the main author and sub-levels become "contributor"
-            for (set<Tree>::iterator j = i->second.begin(); j != i->second.end(); j++) {
+            for (set<Tree, treeLess>::iterator j = i->second.begin(); j != i->second.end(); j++) {
                 if (j == i->second.begin()) {
                      tab(n+1,fout); fout << "m->declare(\"" << *(i->first) << "\", " << **j << ");" ;
                 } else {
@@ -348,21 +414,109 @@ static void groupSeqLoops(Loop* l, set<Loop*>& visited)
     }
 }
 
+/**
+ * A loop is too cheap to be a task by itself when its estimated cost
+ * for a full vector of samples is below gMinTaskCost
+ */
+static bool cheapLoop(Loop* l)
+{
+    return l->fCost * gVecSize < gMinTaskCost;
+}
+
+/**
+ * Collect the loops of a DAG and the users of each loop
+ */
+static void collectLoops(Loop* l, lvec& loops, map<Loop*, lset, loopLess>& users)
+{
+    if (users.find(l) == users.end()) {
+        users[l];
+        for (lset::const_iterator p =l->fBackwardLoopDependencies.begin(); p!=l->fBackwardLoopDependencies.end(); p++) {
+            collectLoops(*p, loops, users);
+            users[*p].insert(l);
+        }
+        loops.push_back(l);
+    }
+}
+
+/**
+ * Group cheap loops with other loops until a fixpoint is reached :
+ * - a cheap loop used by only one loop is computed in the task of its user
+ * - cheap loops having the same dependencies are computed in the same task
+ */
+static void groupCheapLoops(Loop* top)
+{
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        lvec loops;
+        map<Loop*, lset, loopLess> users;
+        collectLoops(top, loops, users);
+
+        // cheap loops with only one user
+        for (lvec::const_iterator p =loops.begin(); p!=loops.end(); p++) {
+            if (*p != top && cheapLoop(*p) && users[*p].size() == 1) {
+                (*users[*p].begin())->group(*p);
+                changed = true;
+                break;
+            }
+        }
+        if (changed) continue;
+
+        // cheap loops with the same dependencies
+        map<lset, Loop*> siblings;
+        for (lvec::const_iterator p =loops.begin(); p!=loops.end(); p++) {
+            if (*p == top || !cheapLoop(*p)) continue;
+            map<lset, Loop*>::iterator s = siblings.find((*p)->fBackwardLoopDependencies);
+            if (s == siblings.end()) {
+                siblings[(*p)->fBackwardLoopDependencies] = *p;
+            } else {
+                // the users of p now depend on its sibling
+                Loop* q = s->second;
+                for (lset::const_iterator u =users[*p].begin(); u!=users[*p].end(); u++) {
+                    (*u)->fBackwardLoopDependencies.erase(*p);
+                    (*u)->fBackwardLoopDependencies.insert(q);
+                }
+                q->group(*p);
+                changed = true;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Group the loops in tasks (-g option). Done only once, since both the
+ * tasks list and the compute method depend on the resulting graph.
+ */
+void Klass::groupTasks()
+{
+    if (gGroupTaskSwitch && !fTasksGrouped) {
+        fTasksGrouped = true;
+        computeUseCount(fTopLoop);
+        set<Loop*> visited;
+        groupSeqLoops(fTopLoop, visited);
+        if (gMinTaskCost > 0) {
+            groupCheapLoops(fTopLoop);
+        }
+    }
+}
+
 #define WORK_STEALING_INDEX 0
 #define LAST_TASK_INDEX 1
 #define START_TASK_INDEX LAST_TASK_INDEX + 1
 
 #define START_TASK_MAX 2
 
+// Version of the contract between the -sch code and architecture/scheduler.cpp, to be changed with it
+#define FAUST_SCHEDULER_VERSION 2
+
 void Klass::buildTasksList()
 {
     lgraph G;
 
-    if (gGroupTaskSwitch) {
-        computeUseCount(fTopLoop);
-        set<Loop*> visited;
-        groupSeqLoops(fTopLoop, visited);
-    }
+    groupTasks();
 
     sortGraph(fTopLoop, G);
     int index_task = START_TASK_INDEX;
@@ -370,7 +524,7 @@ void Klass::buildTasksList()
     addDeclCode("TaskGraph fGraph;");
     addDeclCode("FAUSTFLOAT** input;");
     addDeclCode("FAUSTFLOAT** output;");
-    addDeclCode("volatile bool fIsFinished;");
+    addDeclCode("std::atomic<bool> fIsFinished;");
     addDeclCode("int fCount;");
     addDeclCode("int fIndex;");
     addDeclCode("DSPThreadPool* fThreadPool;");
@@ -424,7 +578,7 @@ void Klass::buildTasksList()
         }
 
         addZone3("} else {");
-        addZone3("    tasknum = TaskQueue::GetNextTask(cur_thread, fDynamicNumThreads);");
+        addZone3("    tasknum = TaskQueue::GetNextTask(this, cur_thread, fDynamicNumThreads);");
         addZone3("}");
 
     } else {
@@ -466,7 +620,10 @@ void Klass::buildTasksList()
 
     addInitCode("fStaticNumThreads = get_max_cpu();");
     addInitCode("fDynamicNumThreads = getenv(\"OMP_NUM_THREADS\") ? atoi(getenv(\"OMP_NUM_THREADS\")) : fStaticNumThreads;");
-    addInitCode("fThreadPool->StartAll(fStaticNumThreads - 1, false);");
+    addInitCode("fThreadPool->StartAll(max(fStaticNumThreads, fDynamicNumThreads) - 1, false);");
+    // the deques and the activation counters are allocated here, never in compute
+    addInitCode(subst("Prepare(max(fStaticNumThreads, fDynamicNumThreads), $0);", T(index_task)));
+    addInitCode(subst("fGraph.Init($0);", T(index_task)));
 
     gTaskCount = 0;
 }
@@ -476,11 +633,7 @@ void Klass::buildTasksList()
  */
 void Klass::printLoopGraphVector(int n, ostream& fout)
 {
-    if (gGroupTaskSwitch) {
-        computeUseCount(fTopLoop);
-        set<Loop*> visited;
-        groupSeqLoops(fTopLoop, visited);
-    }
+    groupTasks();
 
     lgraph G;
     sortGraph(fTopLoop, G);
@@ -508,11 +661,7 @@ void Klass::printLoopGraphVector(int n, ostream& fout)
  */
 void Klass::printLoopGraphOpenMP(int n, ostream& fout)
 {
-    if (gGroupTaskSwitch) {
-        computeUseCount(fTopLoop);
-        set<Loop*> visited;
-        groupSeqLoops(fTopLoop, visited);
-    }
+    groupTasks();
 
     lgraph G;
     sortGraph(fTopLoop, G);
@@ -529,11 +678,7 @@ void Klass::printLoopGraphOpenMP(int n, ostream& fout)
  */
 void Klass::printLoopGraphScheduler(int n, ostream& fout)
 {
-    if (gGroupTaskSwitch) {
-        computeUseCount(fTopLoop);
-        set<Loop*> visited;
-        groupSeqLoops(fTopLoop, visited);
-    }
+    groupTasks();
 
     lgraph G;
     sortGraph(fTopLoop, G);
@@ -566,7 +711,7 @@ void Klass::printGraphDotFormat(ostream& fout)
         // for each task in the level
         for (lset::const_iterator t =G[l].begin(); t!=G[l].end(); t++) {
             // print task label "Lxxx : 0xffffff"
-            fout << '\t' << 'L'<<(*t)<<"[label=<<font face=\"verdana,bold\">L"<<lnum++<<"</font> : "<<(*t)<<">];"<<endl;
+            fout << '\t' << 'L'<<(*t)<<"[label=<<font face=\"verdana,bold\">L"<<lnum++<<"</font> : "<<(*t)<<"<br/>cost : "<<(*t)->fCost<<">];"<<endl;
             // for each source of the task
             for (lset::const_iterator src = (*t)->fBackwardLoopDependencies.begin(); src!=(*t)->fBackwardLoopDependencies.end(); src++) {
                 // print the connection Lxxx -> Lyyy;
@@ -774,6 +919,13 @@ void Klass::println(int n, ostream& fout)
     fout << "#define FAUSTCLASS "<< fKlassName << endl;
     fout << "#endif" << endl;
 
+    if (gSchedulerSwitch) {
+        // the generated code and the scheduler.cpp runtime must follow the same contract
+        fout << "#if !defined(FAUST_SCHEDULER_VERSION) || (FAUST_SCHEDULER_VERSION != " << FAUST_SCHEDULER_VERSION << ")" << endl;
+        fout << "#error \"scheduler.cpp does not match this code, use the one of the Faust compiler that generated it\"" << endl;
+        fout << "#endif" << endl;
+    }
+
     if (gSchedulerSwitch) {
         tab(n,fout); fout << "class " << fKlassName << " : public " << fSuperKlassName << ", public Runnable {";
     } else {
@@ -788,6 +940,12 @@ void Klass::println(int n, ostream& fout)
 
     for (k = fSubClassList.begin(); k != fSubClassList.end(); k++) 	(*k)->println(n+1, fout);
 
+    if (gFieldLayout) {
+        fieldLayout().order(fDeclCode, gFieldLayout > 1);
+    }
+    if (gFieldLayoutReport) {
+        reportFields(fDeclCode);
+    }
     printlines(n+1, fDeclCode, fout);
     
     tab(n+1,fout); fout << "int fSamplingFreq;\n";
@@ -798,11 +956,13 @@ void Klass::println(int n, ostream& fout)
 
     if (gSchedulerSwitch) {
         tab(n+1,fout); fout << fKlassName << "() { "
-                            << "fThreadPool = DSPThreadPool::Init(); }";
+                            << "fThreadPool = DSPThreadPool::Init(this); }";
         
         tab(n+1,fout); fout << "virtual ~" << fKlassName << "() { "
-                            << "DSPThreadPool::Destroy(); }";
+                            << "DSPThreadPool::Destroy(this); }";
     }
+
+    printAlignedNew(n+1, fDeclCode, fout);
     
     tab(n+1,fout); fout << "virtual int getNumInputs() { "
                     << "return " << fNumInputs
@@ -848,6 +1008,13 @@ void Klass::println(int n, ostream& fout)
         tab(n+2,fout); fout << "return fSamplingFreq;";
     tab(n+1,fout); fout << "}";
 
+    if (gDelayPool) {
+        // size of the state of an instance, to know how many instances fit in memory
+        tab(n+1,fout); fout << "static int getStateSize() {";
+            tab(n+2,fout); fout << "return sizeof(" << fKlassName << ");";
+        tab(n+1,fout); fout << "}";
+    }
+
     tab(n+1,fout); fout << "virtual void buildUserInterface(UI* ui_interface) {";
         printlines (n+2, fUICode, fout);
     tab(n+1,fout); fout << "}";
@@ -872,6 +1039,43 @@ void Klass::println(int n, ostream& fout)
 	fout << endl;
 }
 
+/**
+ * Declare a field and remember how it is accessed, for its place in the -fl layout
+ */
+void Klass::addDeclCode(const string& str, int category)
+{
+    string type, name, size;
+    fDeclCode.push_back(str);
+    if (splitDecl(str, type, name, size)) {
+        fFieldLayout.setCategory(name, category);
+    }
+}
+
+/**
+ * Print the allocation operators of a class with cache line aligned fields
+ * (the placement new of the architectures stays available)
+ */
+void Klass::printAlignedNew(int n, const list<string>& decl, ostream& fout)
+{
+    for (list<string>::const_iterator p = decl.begin(); p != decl.end(); p++) {
+        if (p->find("FAUSTALIGNED") != string::npos) {
+            tab(n,fout); fout << "static void* operator new(size_t size) { return faustalignednew(size); }";
+            tab(n,fout); fout << "static void* operator new[](size_t size) { return faustalignednew(size); }";
+            tab(n,fout); fout << "static void* operator new(size_t size, void* ptr) { return ptr; }";
+            tab(n,fout); fout << "static void operator delete(void* ptr) { faustaligneddelete(ptr); }";
+            tab(n,fout); fout << "static void operator delete[](void* ptr) { faustaligneddelete(ptr); }";
+            tab(n,fout); fout << "static void operator delete(void* ptr, void* place) {}";
+            return;
+        }
+    }
+}
+
+void Klass::reportFields(list<string> decl)
+{
+    decl.push_back("int fSamplingFreq;");
+    fieldLayout().report(fKlassName, decl);
+}
+
 /**
  * Print Compute() method according to the various switch
  */
@@ -1132,17 +1336,17 @@ void Klass::printComputeMethodScheduler (int n, ostream& fout)
         tab(n+2,fout); fout << "for (fIndex = 0; fIndex < fullcount; fIndex += " << gVecSize << ") {";
 
         tab(n+3,fout); fout << "fCount = min ("<< gVecSize << ", fullcount-fIndex);";
-        tab(n+3,fout); fout << "TaskQueue::Init();";
+        tab(n+3,fout); fout << "TaskQueue::Init(this);";
         printlines (n+3, fZone2cCode, fout);
 
         tab(n+3,fout); fout << "fIsFinished = false;";
         tab(n+3,fout); fout << "fThreadPool->SignalAll(fDynamicNumThreads - 1, this);";
         tab(n+3,fout); fout << "computeThread(0);";
-        tab(n+3,fout); fout << "while (!fThreadPool->IsFinished()) {}";
+        tab(n+3,fout); fout << "while (!fThreadPool->IsFinished(this)) {}";
 
         tab(n+2,fout); fout << "}";
 
-        tab(n+2,fout); fout << "StopMeasure(fStaticNumThreads, fDynamicNumThreads);";
+        tab(n+2,fout); fout << "StopMeasure(fStaticNumThreads, fDynamicNumThreads, fullcount, fSamplingFreq);";
 
     tab(n+1,fout); fout << "}";
 
@@ -1156,7 +1360,7 @@ void Klass::printComputeMethodScheduler (int n, ostream& fout)
         tab(n+2,fout); fout << "// Init graph state";
 
         tab(n+2,fout); fout << "{";
-            tab(n+3,fout); fout << "TaskQueue taskqueue(cur_thread);";
+            tab(n+3,fout); fout << "TaskQueue taskqueue(this, cur_thread);";
             tab(n+3,fout); fout << "int tasknum = -1;";
     
             // Init input and output
@@ -1168,7 +1372,7 @@ void Klass::printComputeMethodScheduler (int n, ostream& fout)
 
                     // Work stealing task
                     tab(n+5, fout); fout << "case WORK_STEALING_INDEX: { ";
-                        tab(n+6, fout); fout << "tasknum = TaskQueue::GetNextTask(cur_thread, fDynamicNumThreads);";
+                        tab(n+6, fout); fout << "tasknum = TaskQueue::GetNextTask(this, cur_thread, fDynamicNumThreads);";
                         tab(n+6, fout); fout << "break;";
                     tab(n+5, fout); fout << "} ";
 
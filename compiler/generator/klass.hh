@@ -51,6 +51,7 @@ using namespace std;
 
 #include "loop.hh"
 #include "graphSorting.hh"
+#include "fieldlayout.hh"
 
 class Klass //: public Target
 {
@@ -59,6 +60,9 @@ protected:
     // we make it global because several classes may need
     // power def but we want the code to be generated only once
     static bool     fNeedPowerDef;              ///< true when faustpower definition is needed
+    static bool     fNeedDoublePowerDef;        ///< true when the double faustpower is needed by a single precision program (mixed precision)
+    static bool     fNeedAlignedDef;            ///< true when FAUSTALIGNED definition is needed
+    static bool     fNeedMathDef;               ///< true when the fast math functions or the table interpolation are needed
 
 
  protected:
@@ -77,6 +81,10 @@ protected:
 	list<Klass* >		fSubClassList;
 
 	list<string>		fDeclCode;
+    FieldLayout         fFieldLayout;           ///< access category of the fields (-fl option)
+    set<string>         fLaneSharedFields;      ///< fields with the same value in all the lanes (-lanes option)
+    set<string>         fLaneTables;            ///< tables filled as a whole by their generator (-lanes option)
+    set<string>         fLaneSharedCode;        ///< post code executed once per sample for all the lanes (-lanes option)
 	list<string>		fStaticInitCode;		///< static init code for class constant tables
 	list<string>		fStaticFields;			///< static fields after class
     list<string>		fInitCode;
@@ -105,13 +113,14 @@ protected:
     property<Loop*>     fLoopProperty;          ///< loops used to compute some signals
 
     bool                fVec;
+    bool                fTasksGrouped;          ///< true when the loops have been grouped in tasks (-g)
 
  public:
 
 	Klass (const string& name, const string& super, int numInputs, int numOutputs, bool __vec = false)
       : 	fParentKlass(0), fKlassName(name), fSuperKlassName(super), fNumInputs(numInputs), fNumOutputs(numOutputs),
             fNumActives(0), fNumPassives(0),
-            fTopLoop(new Loop(0, "count")), fVec(__vec)
+            fTopLoop(new Loop(0, "count")), fVec(__vec), fTasksGrouped(false)
 	{}
 
 	virtual ~Klass() 						{}
@@ -134,13 +143,19 @@ protected:
 
     Loop*   topLoop()   { return fTopLoop; }
     
+    void groupTasks();
     void buildTasksList();
     
 	void addIncludeFile (const string& str) { fIncludeFileSet.insert(str); }
 
 	void addLibrary (const string& str) 	{ fLibrarySet.insert(str); }
 
-    void rememberNeedPowerDef ()            { fNeedPowerDef = true; }
+    void rememberNeedPowerDef (int precision)   { fNeedPowerDef = true; fNeedDoublePowerDef |= (precision == 2); }
+
+    void rememberNeedAlignedDef ()          { fNeedAlignedDef = true; }
+    void rememberNeedMathDef ()             { fNeedMathDef = true; }
+
+    static void resetStatics();             ///< forget the definitions needed by the previous compilation (batch mode)
 
 	void collectIncludeFile(set<string>& S);
 
@@ -149,6 +164,7 @@ protected:
     void addSubKlass (Klass* son)			{ fSubClassList.push_back(son); }
 
 	void addDeclCode (const string& str) 	{ fDeclCode.push_back(str); }
+    void addDeclCode (const string& str, int category);     ///< declaration of a field accessed as category (FieldLayout)
 
 	void addInitCode (const string& str)	{ fInitCode.push_back(str); }
     void addInitUICode (const string& str)	{ fInitUICode.push_back(str); }
@@ -177,8 +193,18 @@ protected:
     void addPreCode ( const string& str)   { fTopLoop->addPreCode(str); }
     void addExecCode ( const string& str)   { fTopLoop->addExecCode(str); }
 	void addPostCode (const string& str)	{ fTopLoop->addPostCode(str); }
+    void addSharedPostCode (const string& str)  { fLaneSharedCode.insert(str); addPostCode(str); }     ///< post code common to all the lanes
+
+    void shareFieldByLanes (const string& name) { fLaneSharedFields.insert(name); }  ///< the field only depends on the sampling rate
+    void addLaneTable (const string& name)      { fLaneTables.insert(name); }       ///< the field is filled by a table generator
+    void addSIMDCode (const list<string>& lines, const string& written, const set<string>& shiftedReads)
+                                            { fTopLoop->addSIMDCode(lines, written, shiftedReads); }
 
 	virtual void println(int n, ostream& fout);
+
+    const FieldLayout& fieldLayout()                { return fFieldLayout; }
+    void        reportFields(list<string> decl);    ///< print the size of the fields (-flr option)
+    void        printAlignedNew(int n, const list<string>& decl, ostream& fout);   ///< cache line aligned allocation of the class
     
     virtual void printComputeMethod (int n, ostream& fout);
     virtual void printComputeMethodScalar (int n, ostream& fout);
@@ -202,7 +228,7 @@ protected:
     virtual void printOneLoopScheduler(lset::const_iterator p, int n, ostream& fout);
     virtual void printLoopLevelOpenMP(int n, int lnum, const lset& L, ostream& fout);
 
-    virtual void printMetadata(int n, const map<Tree, set<Tree> >& S, ostream& fout);
+    virtual void printMetadata(int n, const map<Tree, set<Tree, treeLess>, treeLess>& S, ostream& fout);
 
 	virtual void printIncludeFile(ostream& fout);
 
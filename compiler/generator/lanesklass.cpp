@@ -0,0 +1,333 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+/**********************************************************************
+			- lanesklass.cpp : class computing several instances of
+			  the dsp in lockstep (-lanes option) -
+
+***********************************************************************/
+
+#include <ctype.h>
+#include <iostream>
+#include <sstream>
+#include "lanesklass.hh"
+#include "fieldlayout.hh"
+#include "floats.hh"
+#include "Text.hh"
+
+extern int  gLanes;
+extern bool gDelayPool;
+extern bool gUIMacroSwitch;
+extern int  gFieldLayout;
+extern bool gFieldLayoutReport;
+
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
+
+void tab (int n, ostream& fout);
+void printlines (int n, list<string>& lines, ostream& fout);
+
+/**
+ * Index the per lane variables of a line of code by the lane v :
+ * x -> x[v] and, for the arrays, x[i] -> x[i][v].
+ */
+string LanesKlass::rewrite (const string& line)
+{
+    string res;
+    size_t i = 0, n = line.size();
+
+    while (i < n) {
+        char c = line[i];
+        if (c == '"') {
+            // string literal, copied as it is
+            size_t j = i+1;
+            while (j < n && line[j] != '"') j += (line[j] == '\\') ? 2 : 1;
+            res += line.substr(i, j+1-i);
+            i = j+1;
+        } else if (isdigit(c)) {
+            // numbers like 1.5e+02f
+            size_t j = i;
+            while (j < n && (isalnum(line[j]) || line[j] == '.' || line[j] == '_')) j++;
+            res += line.substr(i, j-i);
+            i = j;
+        } else if (isalpha(c) || c == '_') {
+            size_t j = i;
+            while (j < n && (isalnum(line[j]) || line[j] == '_')) j++;
+            string id = line.substr(i, j-i);
+            bool member = (i > 0 && line[i-1] == '.') || (i > 1 && line[i-2] == '-' && line[i-1] == '>');
+            res += id;
+            i = j;
+            map<string, bool>::iterator p = fLaneVars.find(id);
+            if (!member && p != fLaneVars.end()) {
+                if (p->second && i < n && line[i] == '[') {
+                    size_t k = i+1;
+                    for (int depth = 1; k < n; k++) {
+                        if (line[k] == '[') depth++;
+                        if (line[k] == ']' && --depth == 0) break;
+                    }
+                    res += "[" + rewrite(line.substr(i+1, k-i-1)) + "]";
+                    i = k+1;
+                }
+                res += "[v]";
+            }
+        } else {
+            res += c;
+            i++;
+        }
+    }
+    return res;
+}
+
+/**
+ * Declarations of the fields with one element per lane. The fields declared
+ * as shared by the compiler (the constants, IOTA incremented once per sample
+ * for all the lanes) and the static fields are shared. The arrays are laid
+ * out as [size][lane], except the tables filled by their generator laid out
+ * as [lane][size].
+ */
+void LanesKlass::declareFields (list<string>& decl)
+{
+    for (list<string>::iterator p = fDeclCode.begin(); p != fDeclCode.end(); p++) {
+        string type, name, size;
+        if (p->compare(0, 6, "static") == 0 || !splitDecl(*p, type, name, size) || fLaneSharedFields.count(name)) {
+            decl.push_back(*p);
+        } else if (size.empty() || fLaneTables.count(name)) {
+            fLaneVars[name] = false;
+            decl.push_back(subst("$0 \t$1[$2]$3;", type, name, T(gLanes), size));
+        } else {
+            fLaneVars[name] = true;
+            decl.push_back(subst("$0 \t$1$2[$3];", type, name, size, T(gLanes)));
+        }
+    }
+}
+
+/**
+ * The local variables of the compute method computed before the sample loop
+ * (fSlowN = ..., input0 = ...) become arrays filled in a loop over the lanes.
+ */
+void LanesKlass::declareLocals (list<string>& zone, list<string>& decl, list<string>& code)
+{
+    for (list<string>::iterator p = zone.begin(); p != zone.end(); p++) {
+        size_t eq = p->find(" = ");
+        string type, name, size;
+        if (eq != string::npos && splitDecl(p->substr(0, eq) + ";", type, name, size) && size.empty()) {
+            fLaneVars[name] = false;
+            decl.push_back(subst("$0 \t$1[$2];", type, name, T(gLanes)));
+            code.push_back(name + " = " + p->substr(eq+3));
+        } else {
+            code.push_back(*p);
+        }
+    }
+}
+
+/**
+ * Print lines of code in a loop over the lanes when they use per lane variables
+ */
+void LanesKlass::printLaneLoop (int n, list<string>& lines, ostream& fout)
+{
+    list<string> laned;
+    bool changed = false;
+    for (list<string>::iterator p = lines.begin(); p != lines.end(); p++) {
+        laned.push_back(rewrite(*p));
+        changed |= (laned.back() != *p);
+    }
+    if (changed) {
+        tab(n,fout); fout << "for (int v=0; v<" << gLanes << "; v++) {";
+            printlines(n+1, laned, fout);
+        tab(n,fout); fout << "}";
+    } else {
+        printlines(n, lines, fout);
+    }
+}
+
+/**
+ * Print the class computing gLanes instances in lockstep. The inputs and the
+ * outputs of the lanes are concatenated : lane v uses the channels
+ * [v*numInputs, (v+1)*numInputs) and [v*numOutputs, (v+1)*numOutputs).
+ */
+void LanesKlass::println (int n, ostream& fout)
+{
+	list<Klass* >::iterator k;
+    list<string> decl;
+
+    if (gFieldLayout) {
+        fieldLayout().order(fDeclCode, gFieldLayout > 1);
+    }
+    declareFields(decl);
+    if (gFieldLayoutReport) {
+        reportFields(decl);
+    }
+
+    tab(n,fout); fout << "#ifndef FAUSTCLASS " << endl;
+    fout << "#define FAUSTCLASS "<< fKlassName << endl;
+    fout << "#endif" << endl;
+
+    tab(n,fout); fout << "class " << fKlassName << " : public " << fSuperKlassName << " {";
+
+    if (gUIMacroSwitch) {
+        tab(n,fout); fout << "  public:";
+    } else {
+	    tab(n,fout); fout << "  private:";
+    }
+
+    for (k = fSubClassList.begin(); k != fSubClassList.end(); k++) 	(*k)->println(n+1, fout);
+
+    printlines(n+1, decl, fout);
+
+    tab(n+1,fout); fout << "int fSamplingFreq;\n";
+
+    tab(n,fout); fout << "  public:";
+
+    printMetadata(n+1, gMetaDataSet, fout);
+
+    printAlignedNew(n+1, decl, fout);
+
+    tab(n+1,fout); fout << "virtual int getNumInputs() { "
+                    << "return " << fNumInputs * gLanes
+                    << "; }";
+
+    tab(n+1,fout); fout << "virtual int getNumOutputs() { "
+                    << "return " << fNumOutputs * gLanes
+                    << "; }";
+
+    tab(n+1,fout); fout << "virtual int getNumLanes() { "
+                    << "return " << gLanes
+                    << "; }";
+
+    tab(n+1,fout); fout << "static void classInit(int samplingFreq) {";
+        printlines (n+2, fStaticInitCode, fout);
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void instanceConstants(int samplingFreq) {";
+        tab(n+2,fout); fout << "fSamplingFreq = samplingFreq;";
+        printLaneLoop (n+2, fInitCode, fout);
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void instanceResetUserInterface() {";
+        printLaneLoop (n+2, fInitUICode, fout);
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void instanceClear() {";
+        printLaneLoop (n+2, fClearCode, fout);
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void init(int samplingFreq) {";
+        tab(n+2,fout); fout << "classInit(samplingFreq);";
+        tab(n+2,fout); fout << "instanceInit(samplingFreq);";
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void instanceInit(int samplingFreq) {";
+    tab(n+2,fout); fout << "instanceConstants(samplingFreq);";
+    tab(n+2,fout); fout << "instanceResetUserInterface();";
+    tab(n+2,fout); fout << "instanceClear();";
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual "<< fKlassName <<"* clone() {";
+        tab(n+2,fout); fout << "return new " << fKlassName << "();";
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual int getSampleRate() {";
+        tab(n+2,fout); fout << "return fSamplingFreq;";
+    tab(n+1,fout); fout << "}";
+
+    if (gDelayPool) {
+        tab(n+1,fout); fout << "static int getStateSize() {";
+            tab(n+2,fout); fout << "return sizeof(" << fKlassName << ");";
+        tab(n+1,fout); fout << "}";
+    }
+
+    // one box per lane, the controls of lane v are the elements v of the zones
+    tab(n+1,fout); fout << "virtual void buildUserInterface(UI* ui_interface) {";
+        tab(n+2,fout); fout << "static const char* lanes[] = { ";
+        for (int v = 0; v < gLanes; v++) fout << ((v > 0) ? ", " : "") << "\"lane" << v << "\"";
+        fout << " };";
+        tab(n+2,fout); fout << "ui_interface->openTabBox(\"lanes\");";
+        tab(n+2,fout); fout << "for (int v=0; v<" << gLanes << "; v++) {";
+            tab(n+3,fout); fout << "ui_interface->openVerticalBox(lanes[v]);";
+            tab(n+3,fout); fout << "buildLaneUserInterface(ui_interface, v);";
+            tab(n+3,fout); fout << "ui_interface->closeBox();";
+        tab(n+2,fout); fout << "}";
+        tab(n+2,fout); fout << "ui_interface->closeBox();";
+    tab(n+1,fout); fout << "}";
+
+    tab(n+1,fout); fout << "virtual void buildLaneUserInterface(UI* ui_interface, int v) {";
+        for (list<string>::iterator p = fUICode.begin(); p != fUICode.end(); p++) {
+            tab(n+2,fout); fout << rewrite(*p);
+        }
+    tab(n+1,fout); fout << "}";
+
+    printComputeMethod(n, fout);
+
+	tab(n,fout); fout << "};\n" << endl;
+
+	printlines(n, fStaticFields, fout);
+
+	fout << endl;
+}
+
+/**
+ * The loop over the lanes is the inner loop of the sample loop, the code shared
+ * by the lanes (IOTA incremented) is executed after it. In the loop computing
+ * the locals, input and output point to the channels of lane v.
+ */
+void LanesKlass::printComputeMethod (int n, ostream& fout)
+{
+    list<string> decl, code, body, shared;
+
+    declareLocals(fZone1Code, decl, code);
+    declareLocals(fZone2Code, decl, code);
+    declareLocals(fZone2bCode, decl, code);
+    declareLocals(fZone3Code, decl, code);
+
+    body.insert(body.end(), fTopLoop->fPreCode.begin(), fTopLoop->fPreCode.end());
+    body.insert(body.end(), fTopLoop->fExecCode.begin(), fTopLoop->fExecCode.end());
+    for (list<string>::iterator p = fTopLoop->fPostCode.begin(); p != fTopLoop->fPostCode.end(); p++) {
+        if (fLaneSharedCode.count(*p)) {
+            shared.push_back(*p);
+        } else {
+            body.push_back(*p);
+        }
+    }
+
+    tab(n+1,fout); fout << subst("virtual void compute (int count, $0** lanes_input, $0** lanes_output) {", xfloat());
+        printlines (n+2, decl, fout);
+        if (code.size() > 0) {
+            tab(n+2,fout); fout << "for (int v=0; v<" << gLanes << "; v++) {";
+                if (fNumInputs > 0) {
+                    tab(n+3,fout); fout << subst("$0** input = &lanes_input[v*$1];", xfloat(), T(fNumInputs));
+                }
+                if (fNumOutputs > 0) {
+                    tab(n+3,fout); fout << subst("$0** output = &lanes_output[v*$1];", xfloat(), T(fNumOutputs));
+                }
+                for (list<string>::iterator p = code.begin(); p != code.end(); p++) {
+                    tab(n+3,fout); fout << rewrite(*p);
+                }
+            tab(n+2,fout); fout << "}";
+        }
+        if (body.size() + shared.size() > 0) {
+            tab(n+2,fout); fout << "for (int i=0; i<count; i++) {";
+                printLaneLoop (n+3, body, fout);
+                printlines (n+3, shared, fout);
+            tab(n+2,fout); fout << "}";
+        }
+    tab(n+1,fout); fout << "}";
+}
@@ -0,0 +1,60 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#ifndef _LANESKLASS_H
+#define _LANESKLASS_H
+
+#include <string>
+#include <list>
+#include <map>
+#include "klass.hh"
+
+/**
+ * Class computing gLanes instances of the dsp in lockstep (-lanes option).
+ * The fields of an instance become arrays indexed by the lane, laid out as
+ * [field][lane] so that the loop over the lanes, inside the sample loop, can
+ * be vectorized even when the signals are recursive. The code produced by the
+ * scalar compiler is rewritten when the class is printed. The fields and the
+ * code shared by the lanes (constants, IOTA...) are given by the compiler when
+ * they are declared, the static tables are shared too.
+ */
+class LanesKlass : public Klass
+{
+    map<string, bool>   fLaneVars;          ///< per lane variables, true for the arrays (x[i] -> x[i][v])
+
+    string  rewrite (const string& line);                           ///< index the per lane variables of a line by the lane
+    void    declareFields (list<string>& decl);                     ///< declarations of the fields with one element per lane
+    void    declareLocals (list<string>& zone, list<string>& decl, list<string>& code);
+    void    printLaneLoop (int n, list<string>& lines, ostream& fout);  ///< print lines in a loop over the lanes if needed
+
+ public:
+
+    LanesKlass (const string& name, const string& super, int numInputs, int numOutputs, bool __vec = false)
+      : Klass(name, (super == "dsp") ? "lanes_dsp" : super, numInputs, numOutputs, __vec)
+    {}
+
+    virtual void println (int n, ostream& fout);
+    virtual void printComputeMethod (int n, ostream& fout);
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "occurences.hh"
 #include "sigtype.hh"
 #include "sigtyperules.hh"
+#include "intervalreport.hh"
 #include <iostream>
 
 using namespace std;
@@ -20,6 +21,42 @@ static int xVariability (int v, int r)
 	return min(3, v + r);
 }
 
+/**
+ * Upper bound of a non negative signal. The interval of its type is refined
+ * for the integer casts (truncation) and the integer modulos, whose intervals
+ * are computed as if the values were real.
+ */
+static double maxValue (Tree y)
+{
+	Tree		x, z;
+	int			op;
+	interval	i = getCertifiedSigType(y)->getInterval();
+
+	if (isSigIntCast(y, x)) {
+		interval j = getCertifiedSigType(x)->getInterval();
+		if (j.valid && j.lo >= 0) return min(i.hi, floor(maxValue(x)));
+	} else if (isSigBinOp(y, &op, x, z) && (op == kRem) && (getCertifiedSigType(y)->nature() == kInt)) {
+		interval j = getCertifiedSigType(x)->getInterval();
+		interval k = getCertifiedSigType(z)->getInterval();
+		if (j.valid && k.valid && j.lo >= 0 && k.lo > 0) return min(i.hi, min(maxValue(x), maxValue(z)-1));
+	}
+	return i.hi;
+}
+
+/**
+ * Maximal value of a delay, used to size its delay line
+ */
+static int maxDelayInterval (Tree y)
+{
+	int d = checkDelayInterval(getCertifiedSigType(y));
+	if (d > 0 && maxValue(y) < d) {
+		countIntervalUse("variable delay line narrowed");
+		return int(maxValue(y));
+	} else {
+		return d;
+	}
+}
+
 //-------------------------------------------------
 //	Occurences methods
 //-------------------------------------------------
@@ -28,6 +65,7 @@ Occurences::Occurences(int v, int r) : fXVariability(xVariability(v,r)) {
 	for (int i=0; i<4; i++) fOccurences[i]=0;
 	fMultiOcc = false;
 	fMaxDelay = 0;
+	fDelayOcc = 0;
 	fOutDelayOcc = false;
 }
 
@@ -39,6 +77,8 @@ Occurences* Occurences::incOccurences(int v, int r, int d) {
 	if (d == 0) {
 		//cerr << "Occurence outside a delay " << endl;
 		fOutDelayOcc = true;
+	} else {
+		fDelayOcc += 1;
 	}
 	if (d > fMaxDelay) {
 		//cerr << "Max delay : " << fMaxDelay << " <- " << d << endl;
@@ -56,6 +96,16 @@ int Occurences::getMaxDelay() const
 	return fMaxDelay;
 }
 
+int Occurences::getDelayOccurences() const
+{
+	return fDelayOcc;
+}
+
+int Occurences::getOccurences(int ctxt) const
+{
+	return fOccurences[ctxt];
+}
+
 //--------------------------------------------------
 //	Mark and retrieve occurences of subtrees of root
 //--------------------------------------------------
@@ -63,7 +113,7 @@ int Occurences::getMaxDelay() const
 void OccMarkup::mark(Tree root)
 {
 	fRootTree = root;
-	fPropKey = tree(unique("OCCURRENCES"));
+	fOccProperty.clearAll();
 
 	if (isList(root)) {
 		while (isList(root)) {
@@ -109,8 +159,7 @@ void OccMarkup::incOcc(Tree env, int v, int r, int d, Tree t)
 		// We mark the subtrees of t
         Tree c, x, y, z;
 		if (isSigFixDelay(t,x,y)) {
-			Type g2 = getCertifiedSigType(y);
-			int d2 = checkDelayInterval(g2);
+			int d2 = maxDelayInterval(y);
 			assert(d2>=0);
 			incOcc(env, v0, r0, d2, x);
 			incOcc(env, v0, r0, 0, y);
@@ -143,18 +192,14 @@ void OccMarkup::incOcc(Tree env, int v, int r, int d, Tree t)
 
 Occurences* OccMarkup::getOcc(Tree t)
 {
-	Tree p = t->getProperty(fPropKey);
-	if (p) {
-		return (Occurences*) tree2ptr(p);
-	} else {
-		return 0;
-	}
+	Occurences* p;
+	return (fOccProperty.get(t, p)) ? p : 0;
 }
 
 
 void OccMarkup::setOcc(Tree t, Occurences* occ)
 {
-	t->setProperty(fPropKey, tree(occ));
+	fOccProperty.set(t, occ);
 }
 
 
@@ -2,6 +2,7 @@
 #define __OCCURENCES__
 
 #include "tlib.hh"
+#include "property.hh"
 
 
 class Occurences
@@ -12,6 +13,7 @@ class Occurences
 	bool		fOutDelayOcc;		///< True when exp has at least one occ. outside a delay
     int			fMinDelay;			///< Minimal fix delay usage
     int			fMaxDelay;			///< Maximal fix delay usage
+    int			fDelayOcc;			///< Number of occurences inside a fix delay
 
  public:
  	Occurences(int v, int r);
@@ -22,6 +24,8 @@ class Occurences
 	bool 		hasOutDelayOccurences() const;		///< true if has occurences outside a a delay
     int			getMaxDelay() const;				///< return the maximal delay collected
     int			getMinDelay() const;				///< return the minimal delay collected
+    int			getDelayOccurences() const;			///< return the number of occurences inside a fix delay
+    int			getOccurences(int ctxt) const;		///< return the number of occurences in context ctxt (variability + recursivness)
 };
 
 
@@ -32,14 +36,14 @@ class Occurences
 class OccMarkup
 {
 	Tree 		fRootTree;								///< occurences computed within this tree
-	Tree		fPropKey;								///< key used to store occurences property
+	property<Occurences*>	fOccProperty;				///< occurences property of the subtrees
 
 	void 		incOcc (Tree env, int v, int r, int d, Tree t);	///< inc the occurence of t in context v,r
 	Occurences* getOcc (Tree t);						///< get Occurences property of t or null
 	void 		setOcc (Tree t, Occurences* occ);		///< set Occurences property of t
 
  public:
- 	void 		mark(Tree root);						///< start markup of root tree with new unique key
+ 	void 		mark(Tree root);						///< start markup of root tree, forgetting previous markups
 	Occurences* retrieve(Tree t);						///< occurences of subtree t within root tree
 };
 
@@ -0,0 +1,312 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+/*****************************************************************************
+    SIMD kernels
+
+    With the -simd option, each line of exec code storing a signal in a vector
+    at sample i gets a vector version, computing simdType()::size consecutive
+    samples with the types and functions of architecture/intrinsic.hh. This
+    vector code is generated from the signal and its type, like the scalar
+    code of the line :
+        - signals slower than the samples are uniform, their scalar code is
+          used as it is
+        - signals already stored in a vector, and the inputs, are loaded, at i
+          or at a constant offset of i for the copy based delay lines
+        - real operations, comparisons (giving masks) and select2 use the
+          vector operators
+        - abs, min, max, sqrt and the integer powers have a vector version, the
+          other primitives are computed lane by lane with their own scalar
+          code, so that the math mode (-mm) is kept
+    Integer computations on vectors, tables, ring buffers, ... are not
+    translated. A loop uses its vector code only when all its lines have been
+    translated (Loop::hasSIMDKernel), otherwise it keeps its scalar code.
+*****************************************************************************/
+
+#include "compile_vect.hh"
+#include "simdkernel.hh"
+#include "floats.hh"
+#include "xtended.hh"
+#include "binop.hh"
+
+extern int  gFloatSize;
+extern bool gSIMDSwitch;
+
+const char* simdType()
+{
+    return (gFloatSize == 2) ? "vdouble" : "vfloat";
+}
+
+/**
+ * Generate the vector code of the line of exec code that just stored a signal
+ * in a vector (vname[i] = exp), and make this vector available to the vector
+ * code of the next lines.
+ * @param sig the stored signal
+ * @param vname the name of the vector
+ * @param mxd the maximum delay of the signal, only the copy based delay lines are translated
+ * @param exp the scalar code of the signal
+ */
+void VectorCompiler::generateSIMDStore(Tree sig, const string& vname, int mxd, const string& exp)
+{
+    if (!gSIMDSwitch || mxd >= gMaxCopyDelay) return;
+
+    Type    t = getCertifiedSigType(sig);
+    string  vtype = simdType();
+    int     kind;
+    string  code;
+    bool    translated;
+
+    fSIMDLines.clear();
+    fSIMDShiftedReads.clear();
+
+    if (t->variability() < kSamp) {
+        kind = kSIMDUniform;
+        code = exp;
+        translated = true;
+    } else {
+        translated = generateSIMDCode(sig, kind, code);
+    }
+
+    // the next lines read the vector instead of computing the signal again
+    fSIMDLoads[sig] = subst("$0::load(&$1[i])", vtype, vname);
+
+    if (!translated || fMixedPrecision) return;
+
+    if (t->nature() == kReal) {
+        fSIMDLines.push_back(subst("vstore(&$0[i], $1);", vname, simdReal(kind, code)));
+    } else if (kind == kSIMDUniform) {
+        fSIMDLines.push_back(subst("for (int k=0; k<$0::size; k++) $1[i+k] = $2;", vtype, vname, code));
+    } else if (kind == kSIMDMask) {
+        // a comparison gives 0 or 1, converted to int without loss
+        string lane = subst("fLane$0", T(fSIMDLaneCount++));
+        fSIMDLines.push_back(subst("$0 $1[$2::size];", ifloat(), lane, vtype));
+        fSIMDLines.push_back(subst("vstore($0, vtoreal($1));", lane, code));
+        fSIMDLines.push_back(subst("for (int k=0; k<$0::size; k++) $1[i+k] = int($2[k]);", vtype, vname, lane));
+    } else {
+        // integer computations are not done with reals
+        return;
+    }
+    fClass->addSIMDCode(fSIMDLines, vname, fSIMDShiftedReads);
+}
+
+/**
+ * Generate the vector code of the line of exec code writing an output
+ * @param i the number of the output
+ * @param sig the signal of the output
+ */
+void VectorCompiler::generateSIMDOutput(int i, Tree sig)
+{
+    int     kind;
+    string  code;
+
+    if (!gSIMDSwitch || fMixedPrecision) return;
+
+    fSIMDLines.clear();
+    fSIMDShiftedReads.clear();
+
+    if (generateSIMDCode(sig, kind, code)) {
+        fSIMDLines.push_back(subst("vstore(&output$0[i], $1);", T(i), simdReal(kind, code)));
+        fClass->addSIMDCode(fSIMDLines, subst("output$0", T(i)), fSIMDShiftedReads);
+    }
+}
+
+/**
+ * Generate the vector code of a signal already compiled in scalar. The lines
+ * needed by lane by lane computations are added to fSIMDLines.
+ * @param sig the signal
+ * @param kind the kind of the vector code : uniform (scalar code), vector of reals,
+ * vector of integers held as reals, or mask
+ * @param code the vector code
+ * @return true if the signal can be computed with the same semantic on vectors
+ */
+bool VectorCompiler::generateSIMDCode(Tree sig, int& kind, string& code)
+{
+    Type                        t = getCertifiedSigType(sig);
+    string                      vtype = simdType();
+    string                      scalar, vname, c1, c2, c3;
+    int                         i, opcode, d, k1, k2, k3;
+    Tree                        x, y, sel;
+    map<Tree, string>::iterator p;
+
+    if (t->variability() < kSamp) {
+        kind = kSIMDUniform;
+        return getCompiledExpression(sig, code);
+    }
+
+    if ((p = fSIMDLoads.find(sig)) != fSIMDLoads.end()) {
+        kind = (t->nature() == kReal) ? kSIMDReal : kSIMDInt;
+        code = p->second;
+        return true;
+    }
+
+    // signals not compiled in scalar (like the removed branch of a select2) are not translated
+    if (!getCompiledExpression(sig, scalar)) return false;
+
+    if (getUserData(sig)) {
+        // integer primitives are not computed with reals
+        kind = kSIMDReal;
+        return (t->nature() == kReal) && generateSIMDXtended(sig, code);
+
+    } else if (isSigInput(sig, &i)) {
+        kind = kSIMDReal;
+        code = subst("$0::load(&input$1[i])", vtype, T(i));
+        return true;
+
+    } else if (isSigFixDelay(sig, x, y)) {
+        if (!isSigInt(y, &d)) return false;
+        if (!getVectorNameProperty(x, vname)) {
+            return (d == 0) && generateSIMDCode(x, kind, code);
+        }
+        // the ring buffers are indexed modulo their size
+        if (fOccMarkup.retrieve(x)->getMaxDelay() >= gMaxCopyDelay) return false;
+        if (d > 0) fSIMDShiftedReads.insert(vname);
+        kind = (getCertifiedSigType(x)->nature() == kReal) ? kSIMDReal : kSIMDInt;
+        code = (d == 0) ? subst("$0::load(&$1[i])", vtype, vname) : subst("$0::load(&$1[i-$2])", vtype, vname, T(d));
+        return true;
+
+    } else if (isSigBinOp(sig, &opcode, x, y)) {
+        if (!generateSIMDCode(x, k1, c1) || !generateSIMDCode(y, k2, c2)) return false;
+        bool real = (getCertifiedSigType(x)->nature() == kReal) || (getCertifiedSigType(y)->nature() == kReal);
+        if (opcode >= kGT && opcode <= kNE) {
+            // the comparisons of integers would not be exact with reals
+            if (!real) return false;
+            kind = kSIMDMask;
+        } else if (opcode == kAdd || opcode == kSub || opcode == kMul) {
+            if (t->nature() != kReal) return false;
+            kind = kSIMDReal;
+        } else if (opcode == kDiv) {
+            // always a real division
+            kind = kSIMDReal;
+        } else {
+            return false;
+        }
+        code = subst("($0 $1 $2)", simdReal(k1, c1), gBinOpTable[opcode]->fName, simdReal(k2, c2));
+        return true;
+
+    } else if (isSigFloatCast(sig, x)) {
+        if (!generateSIMDCode(x, k1, c1)) return false;
+        kind = kSIMDReal;
+        code = simdReal(k1, c1);
+        return true;
+
+    } else if (isSigSelect2(sig, sel, x, y)) {
+        if (t->nature() != kReal) return false;
+        kind = kSIMDReal;
+        interval j = getCertifiedSigType(sel)->getInterval();
+        if (j.valid && (j.lo > 0 || j.hi < 0 || j.lo == j.hi)) {
+            // constant selector, as in the scalar code
+            if (!generateSIMDCode((j.lo == 0 && j.hi == 0) ? x : y, k1, c1)) return false;
+            code = simdReal(k1, c1);
+            return true;
+        }
+        if (!generateSIMDCode(sel, k3, c3) || !generateSIMDCode(x, k1, c1) || !generateSIMDCode(y, k2, c2)) return false;
+        if (k3 == kSIMDUniform) {
+            code = subst("(($0) ? $1 : $2)", c3, simdReal(k2, c2), simdReal(k1, c1));
+        } else if (k3 == kSIMDMask) {
+            code = subst("vselect($0, $1, $2)", c3, simdReal(k2, c2), simdReal(k1, c1));
+        } else {
+            code = subst("vselect($0 != $1(0), $2, $3)", c3, vtype, simdReal(k2, c2), simdReal(k1, c1));
+        }
+        return true;
+
+    } else if (isSigAttach(sig, x, y)) {
+        return generateSIMDCode(x, kind, code);
+
+    } else {
+        return false;
+    }
+}
+
+/**
+ * Generate the vector code of a real primitive
+ * @param sig the signal, a real primitive
+ * @param code the vector code
+ * @return true if the primitive could be translated
+ */
+bool VectorCompiler::generateSIMDXtended(Tree sig, string& code)
+{
+    xtended*        p = (xtended*) getUserData(sig);
+    string          name = p->name();
+    string          vtype = simdType();
+    int             n = sig->arity();
+    vector<int>     kinds(n);
+    vector<string>  codes(n);
+    vector<Type>    types(n);
+
+    for (int k = 0; k < n; k++) {
+        if (!generateSIMDCode(sig->branch(k), kinds[k], codes[k])) return false;
+        types[k] = getCertifiedSigType(sig->branch(k));
+    }
+
+    // primitives with a vector version
+    if ((name == "min" || name == "max") && n == 2) {
+        code = subst("v$0($1, $2)", name, simdReal(kinds[0], codes[0]), simdReal(kinds[1], codes[1]));
+        return true;
+    }
+    if ((name == "abs" || name == "sqrt") && n == 1) {
+        code = subst("v$0($1)", name, simdReal(kinds[0], codes[0]));
+        return true;
+    }
+    if (name == "pow" && n == 2 && types[1]->nature() == kInt && types[1]->variability() == kKonst
+        && types[1]->computability() == kComp) {
+        // faustpower<N> in the scalar code
+        code = subst("vpower<$0>($1)", codes[1], simdReal(kinds[0], codes[0]));
+        return true;
+    }
+
+    // the other primitives are computed lane by lane with their scalar code
+    vector<string> args(n);
+    for (int k = 0; k < n; k++) {
+        if (kinds[k] == kSIMDUniform) {
+            args[k] = codes[k];
+        } else if (types[k]->nature() == kReal) {
+            string lane = subst("fLane$0", T(fSIMDLaneCount++));
+            fSIMDLines.push_back(subst("$0 $1[$2::size];", ifloat(), lane, vtype));
+            fSIMDLines.push_back(subst("vstore($0, $1);", lane, codes[k]));
+            args[k] = subst("$0[k]", lane);
+        } else {
+            // the C++ type of an integer argument can't be kept
+            return false;
+        }
+    }
+    string result = subst("fLane$0", T(fSIMDLaneCount++));
+    fSIMDLines.push_back(subst("$0 $1[$2::size];", ifloat(), result, vtype));
+    fSIMDLines.push_back(subst("for (int k=0; k<$0::size; k++) $1[k] = $2;", vtype, result, p->generateCode(fClass, args, types, gFloatSize)));
+    code = subst("$0::load($1)", vtype, result);
+    return true;
+}
+
+/**
+ * Convert a vector code to a vector of reals
+ * @param kind the kind of the vector code
+ * @param code the vector code
+ * @return the vector of reals
+ */
+string VectorCompiler::simdReal(int kind, const string& code)
+{
+    if (kind == kSIMDUniform) {
+        return subst("$0($1)", simdType(), code);
+    } else if (kind == kSIMDMask) {
+        return subst("vtoreal($0)", code);
+    } else {
+        return code;
+    }
+}
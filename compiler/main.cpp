@@ -29,6 +29,10 @@
 #ifndef WIN32
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <fcntl.h>
 #include "libgen.h"
 #endif
 
@@ -37,6 +41,7 @@
 #include "sigtype.hh"
 #include "sigtyperules.hh"
 #include "sigprint.hh"
+#include "property.hh"
 #include "simplify.hh"
 #include "privatise.hh"
 
@@ -60,8 +65,11 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 #include "sourcereader.hh"
+#include "compilecache.hh"
+#include "files.hh"
 
 
 // construction des representations graphiques
@@ -69,6 +77,8 @@
 #include "schema.h"
 #include "drawschema.hh"
 #include "timing.hh"
+#include "intervalreport.hh"
+#include "mathmode.hh"
 
 using namespace std ;
 
@@ -88,7 +98,7 @@ Tree 			gResult2;
 
 SourceReader	gReader;
 
-map<Tree, set<Tree> > gMetaDataSet;
+map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 extern vector<Tree> gDocVector;
 extern string gDocLang;
 tvec gWaveForm;
@@ -131,6 +141,19 @@ bool			gSimpleNames 	= false;
 bool            gSimplifyDiagrams = false;
 bool			gLessTempSwitch = false;
 int				gMaxCopyDelay	= 16;
+int             gDelayStrategy  = kDelayAuto;   // implementation of the short delay lines in scalar mode
+bool            gDelayReport    = false;
+bool            gDelayPool      = false;        // pack the long delay lines in one pool per class
+int             gConstTableSize = 0;            // max size of the constant tables computed by the compiler
+bool            gIntervalReport = false;        // print the rewrites allowed by the intervals of the signals
+int             gMathMode       = kMathExact;   // implementation of the elementary functions in the generated code
+int             gLanes          = 1;            // number of instances computed in lockstep by the generated class
+int             gKRate          = 1;            // slowly varying signals computed every gKRate samples (1 : every sample)
+bool            gKRateInterpolation = false;    // k-rate signals interpolated between their updates instead of held
+bool            gMixedPrecision = false;        // recursive signals and their feedback computations in double precision
+bool            gMixedPrecisionReport = false;  // print the variables computed in double precision
+int             gFieldLayout    = 0;            // fields ordered by access (1), and aligned on cache lines (2)
+bool            gFieldLayoutReport = false;     // print the size of the fields of the class
 string			gArchFile;
 string			gOutputFile;
 list<string>	gInputFiles;
@@ -145,7 +168,9 @@ int             gVectorLoopVariant = 0;
 bool            gOpenMPSwitch   = false;
 bool            gOpenMPLoop     = false;
 bool            gSchedulerSwitch = false;
+bool            gSIMDSwitch     = false;
 bool			gGroupTaskSwitch = false;
+int             gMinTaskCost    = 2048;         // minimum estimated cost of a task (per vector of samples) when grouping tasks
 
 bool            gUIMacroSwitch  = false;
 bool            gDumpNorm       = false;
@@ -162,12 +187,20 @@ bool            gExportDSP      = false;
 
 list<string>    gImportDirList;                 // dir list enrobage.cpp/fopensearch() searches for imports, etc.
 string          gOutputDir;                     // output directory for additionnal generated ressources : -SVG, XML...etc...
-bool            gInPlace        = false;        // add cache to input for correct in-place computations
+bool            gInPlace        = false;        // cache the inputs read after an output is written for correct in-place computations
 
 // source file injection
 bool            gInjectFlag     = false;        // inject an external source file into the architecture file
 string          gInjectFile     = "";           // instead of a compiled dsp file
 
+// persistent compilation cache
+string          gCacheDir       = "";           // directory of the compilation cache, no cache if empty
+bool            gCacheStatsSwitch = false;      // print the statistics of the compilation cache
+
+// batch compilation
+bool            gBatchSwitch    = false;        // compile each input file separately
+int             gBatchJobs      = 1;            // number of worker processes in batch mode
+
 
 //-- command line tools
 
@@ -303,6 +336,85 @@ bool process_cmdline(int argc, char* argv[])
             gMaxCopyDelay = atoi(argv[i+1]);
             i += 2;
 
+        } else if (isCmd(argv[i], "-ds", "--delay-strategy") && (i+1 < argc)) {
+            string strategy = argv[i+1];
+            if (strategy == "auto") {
+                gDelayStrategy = kDelayAuto;
+            } else if (strategy == "shift") {
+                gDelayStrategy = kDelayShift;
+            } else if (strategy == "ring") {
+                gDelayStrategy = kDelayRing;
+            } else if (strategy == "mirror") {
+                gDelayStrategy = kDelayMirror;
+            } else {
+                std::cerr << "ERROR : unknown delay strategy \"" << strategy << "\"" << endl;
+                exit(-1);
+            }
+            i += 2;
+
+        } else if (isCmd(argv[i], "-dr", "--delay-report")) {
+            gDelayReport = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-dlp", "--delay-line-pool")) {
+            gDelayPool = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-cts", "--const-table-size") && (i+1 < argc)) {
+            gConstTableSize = atoi(argv[i+1]);
+            i += 2;
+
+        } else if (isCmd(argv[i], "-mm", "--math-mode") && (i+1 < argc)) {
+            string mode = argv[i+1];
+            if (mode == "exact") {
+                gMathMode = kMathExact;
+            } else if (mode == "fast") {
+                gMathMode = kMathFast;
+            } else if (mode == "table") {
+                gMathMode = kMathTable;
+            } else {
+                std::cerr << "ERROR : unknown math mode \"" << mode << "\"" << endl;
+                exit(-1);
+            }
+            i += 2;
+
+        } else if (isCmd(argv[i], "-lanes", "--lanes") && (i+1 < argc)) {
+            gLanes = std::max(1, atoi(argv[i+1]));
+            i += 2;
+
+        } else if (isCmd(argv[i], "-kr", "--krate") && (i+1 < argc)) {
+            gKRate = std::max(1, atoi(argv[i+1]));
+            if (gKRate & (gKRate-1)) {
+                std::cerr << "ERROR : 'krate' option requires a power of 2" << endl;
+                exit(-1);
+            }
+            i += 2;
+
+        } else if (isCmd(argv[i], "-kri", "--krate-interpolation")) {
+            gKRateInterpolation = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-mp", "--mixed-precision")) {
+            gMixedPrecision = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-mpr", "--mixed-precision-report")) {
+            gMixedPrecision = true;
+            gMixedPrecisionReport = true;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-fl", "--field-layout")) {
+            gFieldLayout = std::max(gFieldLayout, 1);
+            i += 1;
+
+        } else if (isCmd(argv[i], "-fla", "--field-layout-aligned")) {
+            gFieldLayout = 2;
+            i += 1;
+
+        } else if (isCmd(argv[i], "-flr", "--field-layout-report")) {
+            gFieldLayoutReport = true;
+            i += 1;
+
         } else if (isCmd(argv[i], "-sd", "--simplify-diagrams")) {
             gSimplifyDiagrams = true;
             i += 1;
@@ -335,10 +447,18 @@ bool process_cmdline(int argc, char* argv[])
             gSchedulerSwitch = true;
             i += 1;
 
+        } else if (isCmd(argv[i], "-simd", "--simd")) {
+            gSIMDSwitch = true;
+            i += 1;
+
         } else if (isCmd(argv[i], "-g", "--groupTasks")) {
             gGroupTaskSwitch = true;
             i += 1;
 
+        } else if (isCmd(argv[i], "-mtc", "--min-task-cost") && (i+1 < argc)) {
+            gMinTaskCost = atoi(argv[i+1]);
+            i += 2;
+
         } else if (isCmd(argv[i], "-uim", "--user-interface-macros")) {
             gUIMacroSwitch = true;
             i += 1;
@@ -347,6 +467,10 @@ bool process_cmdline(int argc, char* argv[])
             gTimeout = atoi(argv[i+1]);
             i += 2;
             
+        } else if (isCmd(argv[i], "-ir", "--interval-report")) {
+            gIntervalReport = true;
+            i += 1;
+
         } else if (isCmd(argv[i], "-time", "--compilation-time")) {
             gTimingSwitch = true;
             i += 1;
@@ -426,6 +550,30 @@ bool process_cmdline(int argc, char* argv[])
              gInPlace = true;
              i += 1;
 
+         } else if (isCmd(argv[i], "-cache", "--cache-dir") && (i+1 < argc)) {
+            char temp[PATH_MAX+1];
+            makedir(argv[i+1]);
+            char* path = realpath(argv[i+1], temp);
+            if (path == 0) {
+                std::cerr << "ERROR : invalid cache directory path " << argv[i+1] << std::endl;
+                exit(-1);
+            } else {
+                gCacheDir = path;
+                i += 2;
+            }
+
+         } else if (isCmd(argv[i], "-cs", "--cache-stats")) {
+             gCacheStatsSwitch = true;
+             i += 1;
+
+         } else if (isCmd(argv[i], "-batch", "--batch")) {
+             gBatchSwitch = true;
+             i += 1;
+
+         } else if (isCmd(argv[i], "-j", "--jobs") && (i+1 < argc)) {
+             gBatchJobs = std::max(1, atoi(argv[i+1]));
+             i += 2;
+
         } else if (argv[i][0] != '-') {
             const char* url = argv[i];
             if (check_url(url)) {
@@ -442,13 +590,33 @@ bool process_cmdline(int argc, char* argv[])
     }
 
     // adjust related options
-    if (gOpenMPSwitch || gSchedulerSwitch) gVectorSwitch = true;
+    if (gOpenMPSwitch || gSchedulerSwitch || gSIMDSwitch) gVectorSwitch = true;
 
     if (gInPlace && gVectorSwitch) {
         std::cerr << "ERROR : 'in-place' option can only be used in scalar mode" << endl;
         exit(-1);
     }   
 
+    if (gLanes > 1 && gVectorSwitch) {
+        std::cerr << "ERROR : 'lanes' option can only be used in scalar mode" << endl;
+        exit(-1);
+    }
+
+    if (gKRate > 1 && gVectorSwitch) {
+        std::cerr << "ERROR : 'krate' option can only be used in scalar mode" << endl;
+        exit(-1);
+    }
+
+    if (gMixedPrecision && (gVectorSwitch || gFloatSize != 1)) {
+        std::cerr << "ERROR : 'mixed-precision' option can only be used in scalar mode with single precision floats" << endl;
+        exit(-1);
+    }
+
+    if ((gFieldLayout || gFieldLayoutReport) && (gVectorSwitch || gSchedulerSwitch || gOpenMPSwitch)) {
+        std::cerr << "ERROR : 'field-layout' option can only be used in scalar mode" << endl;
+        exit(-1);
+    }
+
     return err == 0;
 }
 
@@ -498,11 +666,25 @@ void printhelp()
 	cout << "-rb \t\tgenerate --right-balanced expressions\n";
 	cout << "-lt \t\tgenerate --less-temporaries in compiling delays\n";
 	cout << "-mcd <n> \t--max-copy-delay <n> threshold between copy and ring buffer implementation (default 16 samples)\n";
+	cout << "-ds <s> \t--delay-strategy <s> implementation of the delay lines shorter than the max copy delay in scalar mode [auto (default, cheapest estimated), shift, ring, mirror]\n";
+	cout << "-dr     \t--delay-report print the strategy chosen for each short delay line\n";
+	cout << "-dlp    \t--delay-line-pool pack the long delay lines of a DSP in one cache line aligned pool with a shared write index, and generate getStateSize()\n";
+	cout << "-cts <n> \t--const-table-size <n> max size of the constant tables computed by the compiler and generated as static const arrays (default 0 : all tables are filled at init time)\n";
+	cout << "-mm <m> \t--math-mode <m> implementation of sin, cos, tan, exp, log, log10 and pow [exact (default, C math library), fast (inline polynomial approximations, within 4.33 ulp in single precision and 5.41 ulp in double, sin and cos for |x| <= pi in single precision, exp for x <= 88.37 in single precision, log and log10 for x > 0 only), table (interpolated tables for bounded arguments, 1e-6 max absolute error)]\n";
+	cout << "-lanes <n> \t--lanes <n> generate a class computing n instances of the dsp in lockstep, with the state laid out as [field][lane] to vectorize the loop over the lanes (scalar mode only, see lanes_dsp)\n";
+	cout << "-kr <k> \t--krate <k> compute the expensive operations (divisions, math functions) of the signals depending only on the controls, possibly through one pole smoothers, every k samples, k is a power of 2 (scalar mode only, also 'declare krate \"k\";')\n";
+	cout << "-kri \t\t--krate-interpolation interpolate linearly the signals computed every k samples instead of holding them\n";
+	cout << "-mp \t\t--mixed-precision compute the recursive signals and their feedback computations (coefficients included) in double precision, the rest in single precision (scalar mode only, also 'declare precision \"mixed\";')\n";
+	cout << "-mpr \t\t--mixed-precision-report same as -mp and print the variables computed in double precision\n";
+	cout << "-fl \t\t--field-layout order the fields of the class by access : per sample state, per block, init only, UI zones (scalar mode only)\n";
+	cout << "-fla \t\t--field-layout-aligned same as -fl with the per sample state and the UI zones on their own cache lines and the class size a multiple of the cache line\n";
+	cout << "-flr \t\t--field-layout-report print the size of the class and of each kind of fields\n";
 	cout << "-a <file> \tC++ architecture file\n";
 	cout << "-i \t\t--inline-architecture-files \n";
 	cout << "-cn <name> \t--class-name <name> specify the name of the dsp class to be used instead of mydsp \n";
 	cout << "-t <sec> \t--timeout <sec>, abort compilation after <sec> seconds (default 120)\n";
 	cout << "-time \t\t--compilation-time, flag to display compilation phases timing information\n";
+	cout << "-ir \t\t--interval-report, print the code rewrites and the table index checks allowed by the intervals of the signals\n";
     cout << "-o <file> \tC++ output file\n";
     cout << "-vec    \t--vectorize generate easier to vectorize code\n";
     cout << "-vs <n> \t--vec-size <n> size of the vector (default 32 samples)\n";
@@ -510,8 +692,10 @@ void printhelp()
     cout << "-omp    \t--openMP generate OpenMP pragmas, activates --vectorize option\n";
     cout << "-pl     \t--par-loop generate parallel loops in --openMP mode\n";
     cout << "-sch    \t--scheduler generate tasks and use a Work Stealing scheduler, activates --vectorize option\n";
+    cout << "-simd   \t--simd generate explicit SIMD code (architecture/intrinsic.hh) for non recursive loops, activates --vectorize option\n";
 	cout << "-dfs    \t--deepFirstScheduling schedule vector loops in deep first order\n";
     cout << "-g    \t\t--groupTasks group single-threaded sequential tasks together when -omp or -sch is used\n";
+    cout << "-mtc <n> \t--min-task-cost <n> with --groupTasks, also group tasks whose estimated cost is lower than n operations per vector (default 2048, 0 to disable)\n";
     cout << "-uim    \t--user-interface-macros add user interface macro definitions in the C++ code\n";
     cout << "-single \tuse --single-precision-floats for internal computations (default)\n";
     cout << "-double \tuse --double-precision-floats for internal computations\n";
@@ -523,6 +707,10 @@ void printhelp()
     cout << "-e       \t--export-dsp export expanded DSP (all included libraries) \n";
     cout << "-inpl    \t--in-place generates code working when input and output buffers are the same (in scalar mode only) \n";
     cout << "-inj <f> \t--inject source file <f> into architecture file instead of compile a dsp file\n";
+    cout << "-cache <dir> \t--cache-dir <dir> reuse the code generated by previous compilations with the same sources and options, stored in <dir>\n";
+    cout << "-cs     \t--cache-stats print the hit rate and size of the compilation cache\n";
+    cout << "-batch  \t--batch compile each input file separately in <name>.cpp (in the output directory if -O is used), the libraries being parsed once and evaluated once per worker\n";
+    cout << "-j <n>  \t--jobs <n> use <n> worker processes in batch mode\n";
   	cout << "\nexample :\n";
 	cout << "---------\n";
 
@@ -541,11 +729,11 @@ void printheader(ostream& dst)
     selectedKeys.insert(tree("version"));
 
     dst << "//----------------------------------------------------------" << endl;
-    for (map<Tree, set<Tree> >::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
+    for (map<Tree, set<Tree, treeLess>, treeLess>::iterator i = gMetaDataSet.begin(); i != gMetaDataSet.end(); i++) {
         if (selectedKeys.count(i->first)) {
             dst << "// " << *(i->first);
             const char* sep = ": ";
-            for (set<Tree>::iterator j = i->second.begin(); j != i->second.end(); ++j) {
+            for (set<Tree, treeLess>::iterator j = i->second.begin(); j != i->second.end(); ++j) {
                 dst << sep << **j;
                 sep = ", ";
             }
@@ -612,24 +800,49 @@ static void initFaustDirectories()
 
 
 
-int main (int argc, char* argv[])
+/**
+ * The compilation cache can only be used when the C++ code, and the XML and JSON
+ * descriptions, are the only files produced by the compilation.
+ */
+static bool isCacheable()
 {
-    ostream*    dst;
-    ifstream*   injcode=0;
-    istream*    enrobage=0;
-
-
-	/****************************************************************
-	 1 - process command line
-	*****************************************************************/
+    return (gCacheDir != "") && !gInjectFlag && !gDrawPSSwitch && !gDrawSVGSwitch && !gGraphSwitch
+        && !gDrawSignals && !gPrintDocSwitch && !gExportDSP && !gPrintFileListSwitch && !gDetailsSwitch;
+}
 
-	process_cmdline(argc, argv);
+static void writeFile(const string& path, const string& content)
+{
+    ofstream out(path.c_str());
+    out << content;
+}
 
-	if (gHelpSwitch) 		{ printhelp(); exit(0); }
-	if (gVersionSwitch) 	{ printversion(); exit(0); }
+/**
+ * With -simd, the generated class uses the vector types of intrinsic.hh
+ */
+static void printSIMDLayer(ostream& dst)
+{
+    if (gSIMDSwitch) {
+        istream* intrinsic = open_arch_stream("intrinsic.hh");
+        if (intrinsic) {
+            streamCopy(*intrinsic, dst);
+            delete intrinsic;
+        } else {
+            cerr << "ERROR : can't include \"intrinsic.hh\", file not found" << endl;
+            exit(1);
+        }
+    }
+}
 
-    initFaustDirectories();
-    alarm(gTimeout);
+/**
+ * Compile the input files into a single DSP (steps 1.5 to 10).
+ * @param args the command line arguments, used as key in the compilation cache
+ * @return 0 if the compilation succeeded, errors usually exit the compiler
+ */
+static int compileDSP(const vector<string>& args)
+{
+    ostream*    dst;
+    ifstream*   injcode=0;
+    istream*    enrobage=0;
 
 
     /****************************************************************
@@ -678,12 +891,41 @@ int main (int argc, char* argv[])
         exit(0);
     }
 
+    /****************************************************************
+     1.8 - Reuse the result of a previous compilation if possible
+    *****************************************************************/
+
+    CompileCache*   cache = 0;
+    ostream*        cachedst = 0;
+    ostringstream   cachecode;
+
+    if (isCacheable() && !gInputFiles.empty()) {
+        string code, xml, json;
+        gMasterDocument = gInputFiles.front();
+        cache = new CompileCache(gCacheDir, args, FAUSTVERSION);
+        if (cache->lookup(code, xml, json)) {
+            *dst << code;
+            if (gPrintXMLSwitch)  writeFile(subst("$0.xml", makeDrawPath()), xml);
+            if (gPrintJSONSwitch) writeFile(subst("$0.json", makeDrawPath()), json);
+            if (gCacheStatsSwitch) CompileCache::printStats(gCacheDir, cerr);
+            if (dst != &cout) delete dst; else dst->flush();
+            delete enrobage;
+            delete cache;
+            return 0;
+        }
+        // capture the generated code to store it in the cache
+        cachedst = dst;
+        dst = &cachecode;
+    }
+
     /****************************************************************
 	 2 - parse source files
 	*****************************************************************/
 
 	startTiming("parser");
 
+	if (gCacheDir != "") gReader.useParseCache(gCacheDir, FAUSTVERSION);
+
 	list<string>::iterator s;
 	gResult2 = nil;
 	yyerr = 0;
@@ -792,6 +1034,9 @@ int main (int argc, char* argv[])
 
 	endTiming("compilation");
 
+	if (gTimingSwitch) { gReader.printStats(cerr); CTree::printStats(cerr); PropertyStats::print(cerr); }
+	if (gIntervalReport) printIntervalReport(cerr);
+
 	/****************************************************************
 	 6 - generate XML description (if required)
 	*****************************************************************/
@@ -853,11 +1098,13 @@ int main (int argc, char* argv[])
 
         streamCopyUntil(*enrobage, *dst, "<<includeclass>>");
         printfloatdef(*dst);
+        printSIMDLayer(*dst);
         C->getClass()->println(0,*dst);
         streamCopyUntilEnd(*enrobage, *dst);
 
     } else {
         printfloatdef(*dst);
+        printSIMDLayer(*dst);
         C->getClass()->println(0,*dst);
     }
 
@@ -870,7 +1117,346 @@ int main (int argc, char* argv[])
         ofstream dotfile(subst("$0.dot", makeDrawPath()).c_str());
         C->getClass()->printGraphDotFormat(dotfile);
     }
-	
+
+    /****************************************************************
+     10 - store the result in the compilation cache
+    *****************************************************************/
+
+    if (cache) {
+        string xml, json;
+        *cachedst << cachecode.str();
+        cachedst->flush();
+        if (gPrintXMLSwitch)  CompileCache::readFile(subst("$0.xml", makeDrawPath()), xml);
+        if (gPrintJSONSwitch) CompileCache::readFile(subst("$0.json", makeDrawPath()), json);
+        cache->store(cachecode.str(), xml, json, gReader.listSrcFiles(), listArchFiles());
+        delete cache;
+        dst = cachedst;
+    }
+    if (gCacheStatsSwitch && gCacheDir != "") CompileCache::printStats(gCacheDir, cerr);
+
+    if (dst != &cout) delete dst; else dst->flush();
+    delete enrobage;
 	delete C;
 	return 0;
 }
+
+
+/****************************************************************
+ 					Batch compilation
+*****************************************************************/
+
+static vector<string>   gBatchFiles;    // the input files in batch mode
+
+extern set<string>      areadyIncluded; // architecture files already inlined (-i)
+
+/**
+ * The arguments of the compilation of one file of the batch : all the options, and the file
+ */
+static vector<string> batchArgs(int argc, char* argv[], const string& file)
+{
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i] == file || find(gBatchFiles.begin(), gBatchFiles.end(), argv[i]) == gBatchFiles.end()) {
+            args.push_back(argv[i]);
+        }
+    }
+    return args;
+}
+
+/**
+ * Reset the global state of the compiler before the compilation of a file of the batch.
+ * The trees and their properties, in particular the results of the evaluation of the
+ * libraries (see setEvalProperty), are kept and shared between the files. The generated
+ * code does not depend on the trees created by the previous files, since the trees are
+ * ordered by their structure (see compareTree).
+ */
+static void startBatchFile(const string& file)
+{
+    gInputFiles.clear();
+    gInputFiles.push_back(file);
+    initFaustDirectories();
+    gOutputFile = (gOutputDir != "") ? gMasterName + ".cpp" : makeDrawPathNoExt() + ".cpp";
+
+    gMetaDataSet.clear();
+    gDocVector.clear();
+    areadyIncluded.clear();
+    gErrorCount = 0;
+    gReader.newCompilation();
+    ScalarCompiler::resetFreshIDs();
+    Klass::resetStatics();
+    resetMathDefs();
+    alarm(gTimeout);
+}
+
+static int compileBatchFile(int argc, char* argv[], int index, double& duration)
+{
+    double start = mysecond();
+    startBatchFile(gBatchFiles[index]);
+    int r = compileDSP(batchArgs(argc, argv, gBatchFiles[index]));
+    duration = mysecond() - start;
+    return r;
+}
+
+static void printBatchResult(int index, int r, double duration)
+{
+    cerr << gBatchFiles[index] << " : " << ((r == 0) ? "ok" : "FAILED") << " (duration : " << duration << ")" << endl;
+}
+
+#ifndef WIN32
+
+/**
+ * A worker process compiles the files whose indexes it receives on its command pipe,
+ * and answers with the result and the duration of each compilation. A compilation
+ * error exits the worker, it is then replaced by a new one.
+ */
+struct BatchWorker
+{
+    pid_t   fPid;
+    int     fCommand;       ///< pipe to send file indexes to the worker
+    int     fResult;        ///< pipe to receive the results from the worker
+    int     fFile;          ///< the file being compiled, -1 if none
+    double  fStart;         ///< when the compilation of fFile started
+    string  fDirectory;     ///< the master directory of the files compiled by the worker
+
+    struct Result { int fIndex; int fStatus; double fDuration; };
+
+    static vector<int> gParentPipes;    ///< pipe ends of all the workers, to be closed in a new worker
+
+    BatchWorker() : fPid(-1), fCommand(-1), fResult(-1), fFile(-1), fStart(0) {}
+
+    bool start(int argc, char* argv[])
+    {
+        int cmd[2], res[2];
+        if (pipe(cmd) != 0) return false;
+        if (pipe(res) != 0) { close(cmd[0]); close(cmd[1]); return false; }
+        cout.flush();
+        cerr.flush();
+        fPid = fork();
+        if (fPid < 0) {
+            close(cmd[0]); close(cmd[1]); close(res[0]); close(res[1]);
+            return false;
+        } else if (fPid == 0) {
+            // the other workers must see the end of their command pipe when the parent closes it
+            for (size_t i = 0; i < gParentPipes.size(); i++) close(gParentPipes[i]);
+            close(cmd[1]);
+            close(res[0]);
+            run(argc, argv, cmd[0], res[1]);
+            exit(0);
+        }
+        close(cmd[0]);
+        close(res[1]);
+        fCommand = cmd[1];
+        fResult = res[0];
+        gParentPipes.push_back(fCommand);
+        gParentPipes.push_back(fResult);
+        return true;
+    }
+
+    static void run(int argc, char* argv[], int cmd, int res)
+    {
+        int index;
+        while (read(cmd, &index, sizeof(int)) == sizeof(int)) {
+            Result r;
+            r.fIndex = index;
+            r.fStatus = compileBatchFile(argc, argv, index, r.fDuration);
+            if (write(res, &r, sizeof(Result)) != sizeof(Result)) exit(1);
+        }
+    }
+
+    /**
+     * The values memoized by a worker depend on the files found in the master directory
+     * of its compilations, so the files of another directory are compiled by a new worker.
+     */
+    void restart(int argc, char* argv[], int index)
+    {
+        if (fResult >= 0 && fDirectory == filedirname(gBatchFiles[index])) return;
+        if (fResult >= 0) stop();
+        if (!start(argc, argv)) {
+            cerr << "ERROR : can't start batch worker process" << endl;
+            exit(1);
+        }
+    }
+
+    void send(int index)
+    {
+        fFile = index;
+        fStart = mysecond();
+        fDirectory = filedirname(gBatchFiles[index]);
+        // if the worker is dead the failure is detected on its result pipe
+        if (write(fCommand, &index, sizeof(int)) != sizeof(int)) return;
+    }
+
+    void stop()
+    {
+        gParentPipes.erase(std::remove(gParentPipes.begin(), gParentPipes.end(), fCommand), gParentPipes.end());
+        gParentPipes.erase(std::remove(gParentPipes.begin(), gParentPipes.end(), fResult), gParentPipes.end());
+        close(fCommand);
+        close(fResult);
+        waitpid(fPid, 0, 0);
+        fPid = fCommand = fResult = fFile = -1;
+    }
+};
+
+vector<int> BatchWorker::gParentPipes;
+
+static int compileBatchFiles(int argc, char* argv[])
+{
+    vector<BatchWorker> workers(std::min<size_t>(gBatchJobs, gBatchFiles.size()));
+    size_t              next = 0;
+    int                 failed = 0;
+    double              start = mysecond();
+
+    signal(SIGPIPE, SIG_IGN);
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].restart(argc, argv, next);
+        workers[w].send(next++);
+    }
+
+    for (size_t active = workers.size(); active > 0; ) {
+        vector<struct pollfd> fds(workers.size());
+        for (size_t w = 0; w < workers.size(); w++) {
+            fds[w].fd = workers[w].fResult;
+            fds[w].events = POLLIN;
+            fds[w].revents = 0;
+        }
+        if (poll(&fds[0], fds.size(), -1) < 0) continue;
+
+        for (size_t w = 0; w < workers.size(); w++) {
+            BatchWorker& worker = workers[w];
+            if (worker.fResult < 0 || fds[w].revents == 0) continue;
+
+            BatchWorker::Result r;
+            if (read(worker.fResult, &r, sizeof(r)) == sizeof(r)) {
+                printBatchResult(r.fIndex, r.fStatus, r.fDuration);
+                if (r.fStatus != 0) failed++;
+            } else {
+                // the worker exited during a compilation
+                printBatchResult(worker.fFile, 1, mysecond() - worker.fStart);
+                failed++;
+                worker.stop();
+            }
+
+            if (next < gBatchFiles.size()) {
+                worker.restart(argc, argv, next);
+                worker.send(next++);
+            } else {
+                if (worker.fResult >= 0) worker.stop();
+                active--;
+            }
+        }
+    }
+
+    cerr << "batch : " << gBatchFiles.size() << " files, " << failed << " failed, "
+         << workers.size() << " worker(s) (duration : " << mysecond() - start << ")" << endl;
+    return (failed > 0) ? 1 : 0;
+}
+
+/**
+ * Parse the files of the batch in the master directory of the first one, and the libraries
+ * they use, and build the environments of the libraries. The errors are not printed, they
+ * are reported by the compilations of the files.
+ */
+static void preloadBatchFiles()
+{
+    int err = dup(2);
+    int null = open("/dev/null", O_WRONLY);
+    if (err < 0 || null < 0 || dup2(null, 2) < 0) exit(1);
+
+    string dir = filedirname(gBatchFiles[0]);
+    Tree masters = nil;
+    for (size_t i = 0; i < gBatchFiles.size(); i++) {
+        if (filedirname(gBatchFiles[i]) != dir) continue;
+        startBatchFile(gBatchFiles[i]);
+        masters = cons(gReader.expandlist(cons(importFile(tree(gBatchFiles[i].c_str())), nil)), masters);
+    }
+    preloadLibraries(masters);
+    alarm(0);
+
+    cerr.flush();
+    dup2(err, 2);
+    close(err);
+    close(null);
+}
+
+/**
+ * The files and libraries of the batch are preloaded before starting the workers, which
+ * inherit them, so that they are parsed once (see preloadBatchFiles). The preload is done
+ * by a child process, which then compiles the batch : a parse error exits it, and the batch
+ * is then compiled without preload. The documentation of the files (-mdoc) is read when they
+ * are parsed, so they are not preloaded in this case.
+ */
+static int compileBatch(int argc, char* argv[])
+{
+    int     ready[2];
+    pid_t   pid;
+
+    if (gPrintDocSwitch || pipe(ready) != 0) return compileBatchFiles(argc, argv);
+    cout.flush();
+    cerr.flush();
+    if ((pid = fork()) < 0) {
+        close(ready[0]);
+        close(ready[1]);
+        return compileBatchFiles(argc, argv);
+    } else if (pid == 0) {
+        char c = 1;
+        close(ready[0]);
+        preloadBatchFiles();
+        if (write(ready[1], &c, 1) != 1) exit(1);
+        close(ready[1]);
+        exit(compileBatchFiles(argc, argv));
+    }
+
+    char c;
+    int  status;
+    close(ready[1]);
+    bool preloaded = (read(ready[0], &c, 1) == 1);
+    close(ready[0]);
+    waitpid(pid, &status, 0);
+    if (!preloaded) return compileBatchFiles(argc, argv);
+    return (WIFEXITED(status)) ? WEXITSTATUS(status) : 1;
+}
+
+#else
+
+// no fork, the files are compiled in sequence by the compiler process, a compilation error ends the batch
+static int compileBatch(int argc, char* argv[])
+{
+    double start = mysecond();
+    for (size_t i = 0; i < gBatchFiles.size(); i++) {
+        double duration;
+        int r = compileBatchFile(argc, argv, i, duration);
+        printBatchResult(i, r, duration);
+    }
+    cerr << "batch : " << gBatchFiles.size() << " files (duration : " << mysecond() - start << ")" << endl;
+    return 0;
+}
+
+#endif
+
+
+/****************************************************************
+ 						MAIN
+*****************************************************************/
+
+int main (int argc, char* argv[])
+{
+	/****************************************************************
+	 1 - process command line
+	*****************************************************************/
+
+	process_cmdline(argc, argv);
+
+	if (gHelpSwitch) 		{ printhelp(); exit(0); }
+	if (gVersionSwitch) 	{ printversion(); exit(0); }
+    if (gCacheStatsSwitch && gInputFiles.empty()) { CompileCache::printStats(gCacheDir, cout); exit(0); }
+
+    initFaustDirectories();
+
+    if (gBatchSwitch && !gInputFiles.empty()) {
+        gBatchFiles.assign(gInputFiles.begin(), gInputFiles.end());
+        return compileBatch(argc, argv);
+    }
+
+    alarm(gTimeout);
+    return compileDSP(vector<string>(argv + 1, argv + argc));
+}
@@ -6,7 +6,7 @@
 
 using namespace std;
 
-typedef map<Tree,mterm> SM;
+typedef map<Tree,mterm,treeLess> SM;
 
 aterm::aterm ()            
 {}
@@ -44,7 +44,7 @@ static Tree simplifyingAdd(Tree t1, Tree t2)
 	} else if (isZero(t2)) {
 		return t1;
 
-	} else if (t1 <= t2) {
+	} else if (compareTree(t1, t2) <= 0) {
 		return sigAdd(t1, t2);
 
 	} else {
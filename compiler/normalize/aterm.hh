@@ -23,7 +23,7 @@ using namespace std;
 class aterm
 {
 
-    map<Tree,mterm> fSig2MTerms;     			///< mapping between signatures and corresponding mterms
+    map<Tree,mterm,treeLess> fSig2MTerms;	///< mapping between signatures and corresponding mterms
 
  public:
     aterm ();									///< create an empty aterm (equivalent to 0)
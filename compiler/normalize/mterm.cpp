@@ -9,7 +9,7 @@
 
 using namespace std;
 
-typedef map<Tree,int> MP;
+typedef map<Tree,int,treeLess> MP;
 
 mterm::mterm ()            		: fCoef(sigInt(0)) {}
 mterm::mterm (int k)            : fCoef(sigInt(k)) {}
@@ -22,7 +22,7 @@ class mterm
 {
 
     Tree            fCoef;    					///< constant part of the term (usually 1 or -1)
-    map<Tree,int>   fFactors;     				///< non constant terms and their power
+    map<Tree,int,treeLess> fFactors;			///< non constant terms and their power
 
  public:
     mterm ();									///< create a 0 mterm
@@ -7,7 +7,7 @@
 
  
 
-typedef set<Loop*>      lset;
+typedef set<Loop*,loopLess> lset;
 typedef vector<Loop*>   lvec;
 typedef vector<lset>    lgraph;    
 
@@ -1,5 +1,7 @@
 #include "loop.hh"
+#include "simdkernel.hh"
 extern bool gVectorSwitch;
+extern bool gSIMDSwitch;
 extern bool gOpenMPSwitch;
 extern bool gOpenMPLoop;
 
@@ -31,6 +33,7 @@ static void printlines (int n, list<string>& lines, ostream& fout)
     }
 }
 
+static int gLoopCount = 0;      ///< number of loops created, numbers the loops
 
 /**
  * Create a recursive loop
@@ -39,7 +42,7 @@ static void printlines (int n, list<string>& lines, ostream& fout)
  * @param size the number of iterations of the loop
  */
 Loop::Loop(Tree recsymbol, Loop* encl, const string& size)
-        : fIsRecursive(true), fRecSymbolSet(singleton(recsymbol)), fEnclosingLoop(encl), fSize(size), fOrder(-1), fIndex(-1), fUseCount(0), fPrinted(0)
+        : fNum(gLoopCount++), fIsRecursive(true), fRecSymbolSet(singleton(recsymbol)), fEnclosingLoop(encl), fSize(size), fSIMDCount(0), fOrder(-1), fIndex(-1), fUseCount(0), fCost(0), fPrinted(0)
 {}
 
 
@@ -49,7 +52,7 @@ Loop::Loop(Tree recsymbol, Loop* encl, const string& size)
  * @param size the number of iterations of the loop
  */
 Loop::Loop(Loop* encl, const string& size) 
-        : fIsRecursive(false), fRecSymbolSet(nil), fEnclosingLoop(encl), fSize(size), fOrder(-1), fIndex(-1), fUseCount(0), fPrinted(0)
+        : fNum(gLoopCount++), fIsRecursive(false), fRecSymbolSet(nil), fEnclosingLoop(encl), fSize(size), fSIMDCount(0), fOrder(-1), fIndex(-1), fUseCount(0), fCost(0), fPrinted(0)
 {}
 
 
@@ -105,6 +108,37 @@ void Loop::addPostCode (const string& str)
 }
 
 
+/**
+ * Add the vector code (-simd option) of the last line of exec code
+ * @param lines the vector code, computing several consecutive samples
+ * @param written the vector written by the line
+ * @param shiftedReads the vectors read by the vector code at an offset of i
+ */
+void Loop::addSIMDCode (const list<string>& lines, const string& written, const set<string>& shiftedReads)
+{
+    fSIMDCode.insert(fSIMDCode.end(), lines.begin(), lines.end());
+    fSIMDCount++;
+    fSIMDWrites.insert(written);
+    fSIMDShiftedReads.insert(shiftedReads.begin(), shiftedReads.end());
+}
+
+
+/**
+ * A loop can be computed by its vector code when every line of exec code has been
+ * translated and when no vector written by the loop is read at another sample than i
+ * (the samples of the other lanes would not be computed yet).
+ * @return true if the vector code can be used
+ */
+bool Loop::hasSIMDKernel()
+{
+    if (fIsRecursive || fExecCode.empty() || fSIMDCount != fExecCode.size()) return false;
+    for (set<string>::iterator p = fSIMDShiftedReads.begin(); p != fSIMDShiftedReads.end(); p++) {
+        if (fSIMDWrites.count(*p)) return false;
+    }
+    return true;
+}
+
+
 /**
  * Absorb a loop by copying its recursive dependencies, its loop dependencies
  * and its lines of exec and post exec code. 
@@ -123,6 +157,11 @@ void Loop::absorb (Loop* l)
     fPreCode.insert(fPreCode.end(), l->fPreCode.begin(), l->fPreCode.end());
     fExecCode.insert(fExecCode.end(), l->fExecCode.begin(), l->fExecCode.end());
     fPostCode.insert(fPostCode.begin(), l->fPostCode.begin(), l->fPostCode.end());
+    fSIMDCode.insert(fSIMDCode.end(), l->fSIMDCode.begin(), l->fSIMDCode.end());
+    fSIMDCount += l->fSIMDCount;
+    fSIMDWrites.insert(l->fSIMDWrites.begin(), l->fSIMDWrites.end());
+    fSIMDShiftedReads.insert(l->fSIMDShiftedReads.begin(), l->fSIMDShiftedReads.end());
+    fCost += l->fCost;
 }
 
 
@@ -149,10 +188,24 @@ void Loop::println(int n, ostream& fout)
             printlines(n, fPreCode, fout);
         }
 
-        tab(n,fout); fout << "// exec code";
-        tab(n,fout); fout << "for (int i=0; i<" << fSize << "; i++) {";
-        printlines(n+1, fExecCode, fout);
-        tab(n,fout); fout << "}";
+        if (gSIMDSwitch && hasSIMDKernel()) {
+            // vectors of samples first, then the remaining samples
+            tab(n,fout); fout << "// exec code (SIMD)";
+            tab(n,fout); fout << "{";
+            tab(n+1,fout); fout << "int i = 0;";
+            tab(n+1,fout); fout << "for (; i+" << simdType() << "::size<=" << fSize << "; i+=" << simdType() << "::size) {";
+            printlines(n+2, fSIMDCode, fout);
+            tab(n+1,fout); fout << "}";
+            tab(n+1,fout); fout << "for (; i<" << fSize << "; i++) {";
+            printlines(n+2, fExecCode, fout);
+            tab(n+1,fout); fout << "}";
+            tab(n,fout); fout << "}";
+        } else {
+            tab(n,fout); fout << "// exec code";
+            tab(n,fout); fout << "for (int i=0; i<" << fSize << "; i++) {";
+            printlines(n+1, fExecCode, fout);
+            tab(n,fout); fout << "}";
+        }
 
         if (fPostCode.size()>0) {
             tab(n,fout); fout << "// post processing";
@@ -242,4 +295,21 @@ void Loop::concat(Loop* l)
 	
 	fExtraLoops.push_front(l);
 	fBackwardLoopDependencies = l->fBackwardLoopDependencies;	
+	fCost += l->fCost;
+}
+
+/**
+ * Group a loop with this one : it will be computed first, in the same task.
+ * Its dependencies are added to the ones of this loop. Contrary to concat(),
+ * l may not be the only dependency of this loop and may not be a dependency
+ * at all (for instance a loop with the same dependencies).
+ * @param l the Loop to be grouped
+ */
+void Loop::group(Loop* l)
+{
+	assert(l != this);
+	fExtraLoops.push_front(l);
+	fBackwardLoopDependencies.erase(l);
+	fBackwardLoopDependencies.insert(l->fBackwardLoopDependencies.begin(), l->fBackwardLoopDependencies.end());
+	fCost += l->fCost;
 }
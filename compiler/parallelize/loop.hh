@@ -45,28 +45,45 @@ using namespace std;
 
 #define kMaxCategory 32
 
+struct Loop;
+
+/*
+ * Order of the sets of loops : the loops are ordered by creation, so that the generated
+ * code doesn't depend on their addresses.
+ */
+struct loopLess
+{
+    bool operator()(const Loop* l1, const Loop* l2) const;
+};
+
 /*
  * Loops are lines of code that correspond to a recursive expression or a vector expression.
  */
 
 struct Loop
 {
+    const int           fNum;               ///< creation number of the loop
     const bool          fIsRecursive;       ///< recursive loops can't be SIMDed
     Tree                fRecSymbolSet;      ///< recursive loops define a set of recursive symbol
     Loop* const         fEnclosingLoop;     ///< Loop from which this one originated
     const string        fSize;              ///< number of iterations of the loop
     // fields concerned by absorbsion
-    set<Loop*>          fBackwardLoopDependencies;  ///< Loops that must be computed before this one
-    set<Loop*>          fForwardLoopDependencies;   ///< Loops that will be computed after this one
+    set<Loop*,loopLess> fBackwardLoopDependencies;  ///< Loops that must be computed before this one
+    set<Loop*,loopLess> fForwardLoopDependencies;   ///< Loops that will be computed after this one
     list<string>        fPreCode;           ///< code to execute at the begin of the loop
     list<string>        fExecCode;          ///< code to execute in the loop
     list<string>        fPostCode;          ///< code to execute at the end of the loop
+    list<string>        fSIMDCode;          ///< vector code of the exec code (-simd option)
+    size_t              fSIMDCount;         ///< number of lines of exec code translated in fSIMDCode
+    set<string>         fSIMDWrites;        ///< vectors written by fSIMDCode
+    set<string>         fSIMDShiftedReads;  ///< vectors read by fSIMDCode at an offset of i
     // for topological sort
     int                 fOrder;             ///< used during topological sort
     int                 fIndex;             ///< used during scheduler mode code generation
     // new fields
     int					fUseCount;			///< how many loops depend on this one
     list<Loop*>			fExtraLoops;		///< extra loops that where in sequences
+    int                 fCost;              ///< estimated cost of one iteration, including the extra loops
 
     int                 fPrinted;           ///< true when loop has been printed (to track multi-print errors)
 
@@ -80,6 +97,9 @@ public:
     void addPreCode (const string& str);        ///< add a line of C++ code pre code
     void addExecCode (const string& str);       ///< add a line of C++ code
     void addPostCode (const string& str);       ///< add a line of C++ post code
+    void addCost (int cost) { fCost += cost; }  ///< add to the estimated cost of one iteration
+    void addSIMDCode (const list<string>& lines, const string& written, const set<string>& shiftedReads);  ///< vector code of the last line of exec code
+    bool hasSIMDKernel();                       ///< true when all the exec code can be computed with fSIMDCode
     void println (int n, ostream& fout);        ///< print the loop
     void printParLoopln(int n, ostream& fout);  ///< print the loop with a #pragma omp loop
 
@@ -88,6 +108,9 @@ public:
     void absorb(Loop* l);                   ///< absorb a loop inside this one
     // new method
     void concat(Loop* l);
+    void group(Loop* l);                    ///< run a loop in the same task, before this one
 };
 
+inline bool loopLess::operator()(const Loop* l1, const Loop* l2) const { return l1->fNum < l2->fNum; }
+
 #endif
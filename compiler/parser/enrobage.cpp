@@ -31,6 +31,7 @@
 #include "sourcefetcher.hh"
 #include <errno.h>
 #include <climits>
+#include <algorithm>
 
 extern string       gFaustSuperSuperDirectory;
 extern string       gFaustSuperDirectory;
@@ -220,7 +221,7 @@ void streamCopyUntilEnd(istream& src, ostream& dst)
 /**
  * Try to open an architecture file searching in various directories
  */
-ifstream* open_arch_stream(const char* filename)
+static ifstream* search_arch_stream(const char* filename)
 {
 	char	buffer[FAUST_PATH_MAX];
     char*	old = getcwd(buffer, FAUST_PATH_MAX);
@@ -270,6 +271,28 @@ ifstream* open_arch_stream(const char* filename)
 	return 0;
 }
 
+static vector<string> gArchFileNames;     ///< architecture files opened so far
+
+/**
+ * Open an architecture file and keep track of its name
+ */
+ifstream* open_arch_stream(const char* filename)
+{
+    ifstream* f = search_arch_stream(filename);
+    if (f && find(gArchFileNames.begin(), gArchFileNames.end(), filename) == gArchFileNames.end()) {
+        gArchFileNames.push_back(filename);
+    }
+    return f;
+}
+
+/**
+ * Return the names of all the architecture files opened so far
+ */
+vector<string> listArchFiles()
+{
+    return gArchFileNames;
+}
+
 /*---------------------------------------------*/
 
 const char* strip_start(const char* filename)
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <iostream>
 
@@ -38,6 +39,7 @@ void streamCopyUntilEnd(istream& src, ostream& dst);
 void streamCopy(istream& src, ostream& dst);
 
 ifstream* open_arch_stream (const char* filename);
+vector<string> listArchFiles();
 
 FILE* fopensearch(const char* filename, string& fullpath);
 
@@ -94,7 +94,7 @@ extern bool         gLstDependenciesSwitch;
 extern bool         gLstDistributedSwitch;
 extern bool        	gLstMdocTagsSwitch;
 	
-extern map<Tree, set<Tree> > gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 extern vector<Tree>          gDocVector;
 extern tvec                  gWaveForm; 
 
@@ -0,0 +1,404 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+/**
+ * @file parsecache.cpp
+ * Binary serialization of the definition lists produced by the parser.
+ */
+
+#include "parsecache.hh"
+#include "compilecache.hh"
+#include "compatibility.hh"
+#include "boxes.hh"
+#include "signals.hh"
+#include "errormsg.hh"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+using namespace std;
+
+extern Tree DEFLINEPROP;
+extern Tree USELINEPROP;
+
+static const unsigned int kMagic = 0x42494c46;      // "FLIB"
+static const unsigned int kFormat = 1;
+
+enum { kDefProp, kUseProp };
+
+/**
+ * The primitives the parser can produce as pointer nodes. Pointers are saved as
+ * an index in this table since their values change from one run to another.
+ */
+static const vector<void*>& primitives()
+{
+    static vector<void*> prims;
+    if (prims.empty()) {
+        prims.push_back((void*)(prim1)sigDelay1);
+        prims.push_back((void*)(prim1)sigIntCast);
+        prims.push_back((void*)(prim1)sigFloatCast);
+        prims.push_back((void*)(prim2)sigAdd);
+        prims.push_back((void*)(prim2)sigSub);
+        prims.push_back((void*)(prim2)sigMul);
+        prims.push_back((void*)(prim2)sigDiv);
+        prims.push_back((void*)(prim2)sigRem);
+        prims.push_back((void*)(prim2)sigFixDelay);
+        prims.push_back((void*)(prim2)sigPrefix);
+        prims.push_back((void*)(prim2)sigAND);
+        prims.push_back((void*)(prim2)sigOR);
+        prims.push_back((void*)(prim2)sigXOR);
+        prims.push_back((void*)(prim2)sigLeftShift);
+        prims.push_back((void*)(prim2)sigRightShift);
+        prims.push_back((void*)(prim2)sigLT);
+        prims.push_back((void*)(prim2)sigLE);
+        prims.push_back((void*)(prim2)sigGT);
+        prims.push_back((void*)(prim2)sigGE);
+        prims.push_back((void*)(prim2)sigEQ);
+        prims.push_back((void*)(prim2)sigNE);
+        prims.push_back((void*)(prim2)sigAttach);
+        prims.push_back((void*)(prim3)sigReadOnlyTable);
+        prims.push_back((void*)(prim3)sigSelect2);
+        prims.push_back((void*)(prim4)sigSelect3);
+        prims.push_back((void*)(prim5)sigWriteReadTable);
+    }
+    return prims;
+}
+
+/**
+ * Serialize a tree DAG as a sequence of 32-bits words
+ */
+class TreeWriter
+{
+    vector<unsigned int>        fWords;
+    map<Tree, unsigned int>     fNodeIndex;
+    map<Sym, unsigned int>      fSymIndex;
+    vector<Sym>                 fSymbols;
+    vector<Tree>                fNodes;         ///< in topological order
+
+ public:
+
+    bool                        fValid;
+
+    TreeWriter() : fValid(true) {}
+
+    unsigned int symbol(Sym s)
+    {
+        map<Sym, unsigned int>::iterator p = fSymIndex.find(s);
+        if (p != fSymIndex.end()) return p->second;
+        unsigned int i = fSymbols.size();
+        fSymIndex[s] = i;
+        fSymbols.push_back(s);
+        return i;
+    }
+
+    // collect t and its subtrees, branches before their parent
+    void visit(Tree t)
+    {
+        if (fNodeIndex.find(t) != fNodeIndex.end()) return;
+        for (int i = 0; i < t->arity(); i++) visit(t->branch(i));
+        if (t->node().type() == kSymNode) symbol(t->node().getSym());
+        Tree p;
+        if (getProperty(t, DEFLINEPROP, p) || getProperty(t, USELINEPROP, p)) symbol(hd(p)->node().getSym());
+        fNodeIndex[t] = fNodes.size();
+        fNodes.push_back(t);
+    }
+
+    unsigned int index(Tree t) { return fNodeIndex[t]; }
+
+    void word(unsigned int w) { fWords.push_back(w); }
+
+    void str(const string& s)
+    {
+        word(s.size());
+        for (size_t i = 0; i < s.size(); i += 4) {
+            unsigned int w = 0;
+            memcpy(&w, s.data() + i, min(s.size() - i, size_t(4)));
+            word(w);
+        }
+    }
+
+    void writeSymbols()
+    {
+        word(fSymbols.size());
+        for (size_t i = 0; i < fSymbols.size(); i++) str(name(fSymbols[i]));
+    }
+
+    void writeNodes()
+    {
+        const vector<void*>& prims = primitives();
+        word(fNodes.size());
+        for (size_t n = 0; n < fNodes.size(); n++) {
+            Tree        t = fNodes[n];
+            const Node& nd = t->node();
+            unsigned int data[2] = {0, 0};
+
+            switch (nd.type()) {
+                case kIntNode :     data[0] = (unsigned int)nd.getInt(); break;
+                case kDoubleNode :  { double x = nd.getDouble(); memcpy(data, &x, sizeof(double)); } break;
+                case kSymNode :     data[0] = symbol(nd.getSym()); break;
+                default : {
+                    // only the primitives produced by the parser can be saved
+                    size_t i = find(prims.begin(), prims.end(), nd.getPointer()) - prims.begin();
+                    if (i == prims.size()) fValid = false;
+                    data[0] = i;
+                }
+            }
+            word(nd.type());
+            word(t->arity());
+            word(data[0]);
+            word(data[1]);
+            for (int i = 0; i < t->arity(); i++) word(index(t->branch(i)));
+        }
+    }
+
+    void writeProperties()
+    {
+        vector<unsigned int> props;
+        for (size_t n = 0; n < fNodes.size(); n++) {
+            Tree p;
+            if (getProperty(fNodes[n], DEFLINEPROP, p)) {
+                props.push_back(n); props.push_back(kDefProp);
+                props.push_back(symbol(hd(p)->node().getSym())); props.push_back(tl(p)->node().getInt());
+            }
+            if (getProperty(fNodes[n], USELINEPROP, p)) {
+                props.push_back(n); props.push_back(kUseProp);
+                props.push_back(symbol(hd(p)->node().getSym())); props.push_back(tl(p)->node().getInt());
+            }
+        }
+        word(props.size() / 4);
+        fWords.insert(fWords.end(), props.begin(), props.end());
+    }
+
+    const vector<unsigned int>& words() const { return fWords; }
+};
+
+/**
+ * Rebuild a tree DAG from a sequence of 32-bits words, checking all indexes
+ */
+class TreeReader
+{
+    const unsigned int*     fCur;
+    const unsigned int*     fEnd;
+    vector<Sym>             fSymbols;
+    vector<Tree>            fNodes;
+
+ public:
+
+    bool                    fValid;
+
+    TreeReader(const unsigned int* begin, const unsigned int* end) : fCur(begin), fEnd(end), fValid(true) {}
+
+    unsigned int word()
+    {
+        if (fCur < fEnd) return *fCur++;
+        fValid = false;
+        return 0;
+    }
+
+    string str()
+    {
+        unsigned int n = word();
+        if (!fValid || n > 4 * (unsigned int)(fEnd - fCur)) { fValid = false; return ""; }
+        string s((const char*)fCur, n);
+        fCur += (n + 3) / 4;
+        return s;
+    }
+
+    Sym symbol(unsigned int i)
+    {
+        if (i < fSymbols.size()) return fSymbols[i];
+        fValid = false;
+        return ::symbol("");
+    }
+
+    Tree node(unsigned int i)
+    {
+        if (i < fNodes.size()) return fNodes[i];
+        fValid = false;
+        return nil;
+    }
+
+    void readSymbols()
+    {
+        unsigned int n = word();
+        for (unsigned int i = 0; fValid && i < n; i++) fSymbols.push_back(::symbol(str()));
+    }
+
+    void readNodes()
+    {
+        const vector<void*>& prims = primitives();
+        unsigned int    n = word();
+        vector<Tree>    br;
+
+        for (unsigned int k = 0; fValid && k < n; k++) {
+            unsigned int type = word();
+            unsigned int arity = word();
+            unsigned int data[2];
+            data[0] = word();
+            data[1] = word();
+            if (!fValid || arity > (unsigned int)(fEnd - fCur)) { fValid = false; return; }
+            br.resize(arity + 1);
+            for (unsigned int i = 0; i < arity; i++) br[i] = node(word());
+
+            Node nd(0);
+            switch (type) {
+                case kIntNode :     nd = Node(int(data[0])); break;
+                case kDoubleNode :  { double x; memcpy(&x, data, sizeof(double)); nd = Node(x); } break;
+                case kSymNode :     nd = Node(symbol(data[0])); break;
+                case kPointerNode :
+                    if (data[0] < prims.size()) nd = Node(prims[data[0]]); else fValid = false;
+                    break;
+                default : fValid = false;
+            }
+            fNodes.push_back(CTree::make(nd, arity, &br[0]));
+        }
+    }
+
+    void readProperties()
+    {
+        unsigned int n = word();
+        for (unsigned int k = 0; fValid && k < n; k++) {
+            Tree t = node(word());
+            unsigned int kind = word();
+            Sym file = symbol(word());
+            int line = int(word());
+            if (fValid) setProperty(t, (kind == kDefProp) ? DEFLINEPROP : USELINEPROP, cons(tree(file), tree(line)));
+        }
+    }
+
+    bool atEnd() const { return fCur == fEnd; }
+};
+
+string ParseCache::entryPath(const string& fullpath) const
+{
+    return fDir + "/" + CompileCache::hashString(fVersion + "\n" + fullpath) + ".flib";
+}
+
+bool ParseCache::save(const string& fullpath, const string& source, Tree ldef, const metalist& meta) const
+{
+    TreeWriter w;
+
+    w.visit(ldef);
+    for (size_t i = 0; i < meta.size(); i++) {
+        w.visit(meta[i].first);
+        w.visit(meta[i].second);
+    }
+    w.word(kMagic);
+    w.word(kFormat);
+    w.str(fVersion);
+    w.str(CompileCache::hashString(source));
+    w.writeSymbols();
+    w.writeNodes();
+    w.writeProperties();
+    w.word(meta.size());
+    for (size_t i = 0; i < meta.size(); i++) {
+        w.word(w.index(meta[i].first));
+        w.word(w.index(meta[i].second));
+    }
+    w.word(w.index(ldef));
+    if (!w.fValid) return false;
+
+    // write a private temporary file and atomically rename it
+    string          path = entryPath(fullpath);
+    stringstream    tmp;
+    tmp << path << ".tmp." << getpid();
+    {
+        ofstream f(tmp.str().c_str(), ios::out | ios::binary);
+        if (!f.is_open()) return false;
+        f.write((const char*)&w.words()[0], w.words().size() * sizeof(unsigned int));
+        if (!f.good()) {
+            f.close();
+            remove(tmp.str().c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.str().c_str(), path.c_str()) != 0) {
+        remove(tmp.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool readEntry(TreeReader& r, const string& version, const string& hash, Tree& ldef, ParseCache::metalist& meta)
+{
+    if (r.word() != kMagic || r.word() != kFormat) return false;
+    if (r.str() != version || r.str() != hash) return false;
+
+    r.readSymbols();
+    r.readNodes();
+    r.readProperties();
+
+    unsigned int n = r.word();
+    for (unsigned int i = 0; r.fValid && i < n; i++) {
+        Tree key = r.node(r.word());
+        Tree value = r.node(r.word());
+        meta.push_back(make_pair(key, value));
+    }
+    ldef = r.node(r.word());
+    return r.fValid && r.atEnd();
+}
+
+bool ParseCache::load(const string& fullpath, const string& source, Tree& ldef, metalist& meta) const
+{
+    string  path = entryPath(fullpath);
+    string  hash = CompileCache::hashString(source);
+    bool    ok = false;
+
+#ifndef WIN32
+    // the entry is mapped in memory and decoded in place
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (st.st_size % sizeof(unsigned int)) == 0) {
+        void* data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            const unsigned int* words = (const unsigned int*)data;
+            TreeReader r(words, words + st.st_size / sizeof(unsigned int));
+            ok = readEntry(r, fVersion, hash, ldef, meta);
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+#else
+    string content;
+    if (CompileCache::readFile(path, content) && content.size() > 0 && (content.size() % sizeof(unsigned int)) == 0) {
+        vector<unsigned int> words(content.size() / sizeof(unsigned int));
+        memcpy(&words[0], content.data(), content.size());
+        TreeReader r(&words[0], &words[0] + words.size());
+        ok = readEntry(r, fVersion, hash, ldef, meta);
+    }
+#endif
+    if (!ok) meta.clear();
+    return ok;
+}
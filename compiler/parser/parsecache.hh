@@ -0,0 +1,68 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+ 
+#ifndef __PARSECACHE__
+#define __PARSECACHE__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "tree.hh"
+
+/**
+ * On-disk cache of parsed source files, used with -cache <dir>.
+ *
+ * The list of definitions produced by the parser for a file is serialized in a
+ * compact binary form : a symbol table followed by the nodes of the tree DAG in
+ * topological order, each node referring to its branches by index. The def/use
+ * line properties and the metadata declared by the file are saved with it.
+ * An entry is only reused if the content of the file is unchanged.
+ */
+class ParseCache
+{
+    std::string     fDir;       ///< the cache directory, no cache if empty
+    std::string     fVersion;   ///< the compiler version, part of the key
+
+    std::string     entryPath(const std::string& fullpath) const;
+
+ public:
+
+    typedef std::vector<std::pair<Tree,Tree> > metalist;
+
+    ParseCache() {}
+
+    void    init(const std::string& dir, const std::string& version) { fDir = dir; fVersion = version; }
+    bool    active() const { return fDir != ""; }
+
+    /**
+     * Load the definitions of a file if it has already been parsed with the same content
+     * @return true if a valid entry was found
+     */
+    bool    load(const std::string& fullpath, const std::string& source, Tree& ldef, metalist& meta) const;
+
+    /**
+     * Save the definitions of a file. Does nothing if the trees can't be serialized.
+     * @return true if the entry was written
+     */
+    bool    save(const std::string& fullpath, const std::string& source, Tree ldef, const metalist& meta) const;
+};
+
+#endif
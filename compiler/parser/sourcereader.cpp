@@ -15,14 +15,20 @@
 #include "sourcefetcher.hh"
 #include "enrobage.hh"
 #include "ppbox.hh"
+#include "compilecache.hh"
+#include "timing.hh"
 
 using namespace std;
 
-extern map<Tree, set<Tree> > gMetaDataSet;
+extern map<Tree, set<Tree, treeLess>, treeLess> gMetaDataSet;
 extern string gMasterDocument;
+extern string gMasterDirectory;
 extern vector<Tree> gDocVector;
 extern bool gLatexDocSwitch;
 
+// metadata declared by the file being parsed, recorded to be saved in the parse cache
+static ParseCache::metalist* gParsedMetadata = 0;
+
 /****************************************************************
  						Parser variables
 *****************************************************************/
@@ -232,7 +238,10 @@ Tree SourceReader::parse(const char* fname)
         }
         yy_scan_string(fileBuf);
         yylineno = 1;
+        ParseCache::metalist meta;
+        gParsedMetadata = &meta;
         int r = yyparse();
+        gParsedMetadata = 0;
         if (r) {
             fprintf(stderr, "Parse error : code = %d\n", r);
         }
@@ -243,6 +252,8 @@ Tree SourceReader::parse(const char* fname)
         
         // we have parsed a valid file
         fFilePathnames.push_back(fullpath);
+        fFileFullpaths[fname] = fullpath;
+        fFileMetadata[fname] = meta;
         // 'http_fetch' result must be deallocated
         free(fileBuf);
         return gResult;
@@ -259,9 +270,35 @@ Tree SourceReader::parse(const char* fname)
             cerr << "ERROR : Unable to open file " << yyfilename << endl;
             exit(1);
         }
+
+        // libraries already parsed with the same content are loaded from the parse cache
+        ParseCache::metalist    meta;
+        string                  source;
+        bool                    cacheable = fParseCache.active() && (gMasterDocument != yyfilename)
+                                            && CompileCache::readFile(fullpath, source);
+        double                  start = mysecond();
+
+        if (cacheable) {
+            Tree ldef;
+            if (fParseCache.load(fullpath, source, ldef, meta)) {
+                for (unsigned int i = 0; i < meta.size(); i++) declareMetadata(meta[i].first, meta[i].second);
+                fFilePathnames.push_back(fullpath);
+                fFileFullpaths[fname] = fullpath;
+                fFileMetadata[fname] = meta;
+                fclose(tmp_file);
+                fLoadedCount++;
+                fLoadTime += mysecond() - start;
+                return ldef;
+            }
+            start = mysecond();
+        }
+
+        size_t docs = gDocVector.size();
+        gParsedMetadata = &meta;
         yyrestart(yyin);	// make sure we scan from file again (in case we scanned a string just before)
         yylineno = 1;
         int r = yyparse();
+        gParsedMetadata = 0;
         if (r) {
             cerr << "ERROR (file " << yyfilename << ":" << yylineno << ") : Parse error code " << r << endl;
         }
@@ -269,9 +306,18 @@ Tree SourceReader::parse(const char* fname)
             //fprintf(stderr, "Erreur de parsing 2, count = %d \n", yyerr); 
             exit(1);
         }
+        fParsedCount++;
+        fParseTime += mysecond() - start;
+
+        // files with documentation have side effects that can't be saved
+        if (cacheable && gDocVector.size() == docs) {
+            fParseCache.save(fullpath, source, gResult, meta);
+        }
 
         // we have parsed a valid file
         fFilePathnames.push_back(fullpath);
+        fFileFullpaths[fname] = fullpath;
+        fFileMetadata[fname] = meta;
         fclose(tmp_file);
         return gResult;
     }
@@ -302,11 +348,38 @@ Tree SourceReader::getlist(const char* fname)
 {
 	if (!cached(fname)) {
 		fFileCache[fname] = parse(fname);
+	} else if (fUsedFiles.find(fname) == fUsedFiles.end()) {
+		// file parsed by a previous compilation (batch mode), its metadata are declared again
+		ParseCache::metalist& meta = fFileMetadata[fname];
+		yyfilename = (strstr(fname,"file://") != 0) ? &fname[7] : fname;
+		for (unsigned int i = 0; i < meta.size(); i++) declareMetadata(meta[i].first, meta[i].second);
+		fFilePathnames.push_back(fFileFullpaths[fname]);
 	}
+	fUsedFiles.insert(fname);
     if (fFileCache[fname] == 0) exit(1);
     return fFileCache[fname];
 }
 
+
+/**
+ * Prepare the reader for the compilation of another master document (batch mode).
+ * The files already parsed are kept unless the master directory, which is part of
+ * the search path, changes.
+ */
+
+void SourceReader::newCompilation()
+{
+	if (gMasterDirectory != fMasterDirectory) {
+		fFileCache.clear();
+		fFileFullpaths.clear();
+		fFileMetadata.clear();
+		fMasterDirectory = gMasterDirectory;
+	}
+	fFilePathnames.clear();
+	fUsedFiles.clear();
+	fReused = true;
+}
+
  
 /**
  * Return a vector of pathnames representing the list 
@@ -326,6 +399,17 @@ vector<string> SourceReader::listSrcFiles()
 	return fFilePathnames;
 }
 
+
+/**
+ * Print the number of files parsed or loaded from the parse cache, and the time spent (-time)
+ */
+
+void SourceReader::printStats(ostream& fout)
+{
+    fout << "parser : " << fParsedCount << " files parsed (" << fParseTime << " s), "
+         << fLoadedCount << " files loaded from the cache (" << fLoadTime << " s)" << endl;
+}
+
  
 /**
  * Return the list of definitions where all imports have been expanded.
@@ -368,6 +452,7 @@ Tree SourceReader::expandrec(Tree ldef, set<string>& visited, Tree lresult)
 
 void declareMetadata(Tree key, Tree value)
 {
+    if (gParsedMetadata) gParsedMetadata->push_back(make_pair(key, value));
     if (gMasterDocument == yyfilename) {
         // inside master document, no prefix needed to declare metadata
         gMetaDataSet[key].insert(value);
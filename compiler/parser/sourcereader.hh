@@ -2,6 +2,7 @@
 #define __SOURCEREADER__
 
 #include "boxes.hh"
+#include "parsecache.hh"
 #include <string>
 #include <set>
 #include <vector>
@@ -16,13 +17,33 @@ void declareDoc(Tree t);
 class SourceReader 
 {
 	map<string, Tree>	fFileCache;
-	vector<string>		fFilePathnames;
+	map<string, string>	fFileFullpaths;		///< pathname of each file of fFileCache
+	map<string, ParseCache::metalist>	fFileMetadata;	///< metadata declared by each file of fFileCache
+	vector<string>		fFilePathnames;		///< files used by the current compilation
+	set<string>			fUsedFiles;			///< names of the files used by the current compilation
+	bool				fReused;			///< true when the files may have been used by a previous compilation
+	string				fMasterDirectory;	///< the directory used to search the files of fFileCache
+	ParseCache			fParseCache;		///< parsed files saved on disk, see useParseCache()
+	int					fParsedCount;		///< number of files parsed
+	int					fLoadedCount;		///< number of files loaded from fParseCache
+	double				fParseTime;			///< time spent parsing files
+	double				fLoadTime;			///< time spent loading files from fParseCache
+
 	Tree parse(const char* fname);
 	Tree expandrec(Tree ldef, set<string>& visited, Tree lresult);
 	bool cached(string fname);
 	
 public:
+	SourceReader() : fReused(false), fParsedCount(0), fLoadedCount(0), fParseTime(0), fLoadTime(0) {}
+
+	void useParseCache(const string& dir, const string& version) { fParseCache.init(dir, version); }
+	void printStats(ostream& fout);
+	void newCompilation();
+
+
 	Tree getlist(const char* fname);
+	bool used(const char* fname) { return fUsedFiles.find(fname) != fUsedFiles.end(); }	///< true when the file is used by the current compilation
+	bool reused() { return fReused; }	///< true when the files may have been used by a previous compilation (batch mode)
 	Tree expandlist(Tree ldef);
 	vector<string>	listSrcFiles();
 };
@@ -169,35 +169,43 @@ inline interval operator>>(const interval&, const interval&)
 // ---------------------comparaisons------------------------------
 // note : les comparaisons ne portent pas sur les intervals 
 // mais l'interval des comparaisons de signaux
+// the result is constant when the intervals prove it
 
-inline interval operator<(const interval&, const interval&)
+inline interval operator<(const interval& x, const interval& y)
 {
+	if (x.valid && y.valid && x.hi < y.lo)	return interval(1);
+	if (x.valid && y.valid && x.lo >= y.hi)	return interval(0);
 	return interval(0,1);
 }
 
-inline interval operator<=(const interval&, const interval&)
+inline interval operator<=(const interval& x, const interval& y)
 {
+	if (x.valid && y.valid && x.hi <= y.lo)	return interval(1);
+	if (x.valid && y.valid && x.lo > y.hi)	return interval(0);
 	return interval(0,1);
 }
 
-inline interval operator>(const interval&, const interval&)
+inline interval operator>(const interval& x, const interval& y)
 {
-	return interval(0,1);
+	return y < x;
 }
 
-inline interval operator>=(const interval&, const interval&)
+inline interval operator>=(const interval& x, const interval& y)
 {
-	return interval(0,1);
+	return y <= x;
 }
 
-inline interval operator==(const interval&, const interval&)
+inline interval operator==(const interval& x, const interval& y)
 {
+	if (x.valid && x.lo == x.hi && y.valid && y.lo == y.hi && x.lo == y.lo)	return interval(1);
+	if (x.valid && y.valid && (x.hi < y.lo || y.hi < x.lo))						return interval(0);
 	return interval(0,1);
 }
 
-inline interval operator!=(const interval&, const interval&)
+inline interval operator!=(const interval& x, const interval& y)
 {
-	return interval(0,1);
+	interval e = (x == y);
+	return (e.lo == e.hi) ? interval(1 - e.lo) : e;
 }
 
 //-----------------------------------------------------------------------
@@ -231,6 +239,12 @@ inline interval iint(const interval& x)
     return interval(double(int(x.lo)), double(int(x.hi)));
 }
 
+// integer bounds rounded outward : int(v), floor(v) and ceil(v) stay in them for any v in x
+inline interval integral(const interval& x)
+{
+    return (x.valid) ? interval(floor(x.lo), ceil(x.hi)) : x;
+}
+
 inline interval fmod(const interval& x, const interval& y)
 {
     interval n = iint(x/y);
@@ -0,0 +1,44 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include <map>
+#include <string>
+#include "intervalreport.hh"
+
+using namespace std;
+
+static map<string, int> gIntervalUses;
+
+void countIntervalUse(const char* what)
+{
+    gIntervalUses[what]++;
+}
+
+void printIntervalReport(ostream& out)
+{
+    out << "interval based rewrites and proofs :" << endl;
+    if (gIntervalUses.empty()) {
+        out << "\tnone" << endl;
+    }
+    for (map<string, int>::const_iterator p = gIntervalUses.begin(); p != gIntervalUses.end(); p++) {
+        out << "\t" << p->second << "\t" << p->first << endl;
+    }
+}
@@ -0,0 +1,37 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#ifndef _INTERVALREPORT_
+#define _INTERVALREPORT_
+
+#include <iostream>
+
+// The code generators use the intervals computed by the type inference to remove
+// clamps and selections that can't change the result, to simplify modulos, to
+// size the variable delay lines and to prove the table indices in range. Each of
+// these rewrites and proofs is counted here.
+
+void countIntervalUse (const char* what);          ///< count one rewrite or proof allowed by the intervals
+void printIntervalReport (std::ostream& out);       ///< print the counts of each kind (-ir)
+
+#endif
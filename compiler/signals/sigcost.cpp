@@ -0,0 +1,92 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include <string.h>
+#include "sigcost.hh"
+#include "signals.hh"
+#include "binop.hh"
+#include "xtended.hh"
+
+extern int gVecSize;
+
+/**
+ * Cost of a call to a primitive math function, according to its name
+ */
+static int xtendedCost(xtended* p)
+{
+    const char* n = p->name();
+    if (strcmp(n, "abs") == 0 || strcmp(n, "min") == 0 || strcmp(n, "max") == 0
+        || strcmp(n, "floor") == 0 || strcmp(n, "ceil") == 0 || strcmp(n, "rint") == 0) {
+        return 2;
+    } else if (strcmp(n, "sqrt") == 0) {
+        return 6;
+    } else if (strcmp(n, "fmod") == 0 || strcmp(n, "remainder") == 0) {
+        return 10;
+    } else {
+        // transcendental functions : sin, cos, tan, exp, log, pow, atan2...
+        return 20;
+    }
+}
+
+int sigNodeCost(Tree sig)
+{
+    int     i, op;
+    double  r;
+    Tree    x, y, z, t;
+
+    if (isSigInt(sig, &i) || isSigReal(sig, &r)) {
+        return 0;
+    } else if (isSigInput(sig, &i)) {
+        return 1;
+    } else if (isSigBinOp(sig, &op, x, y)) {
+        return (op == kDiv || op == kRem) ? 4 : 1;
+    } else if (isSigFixDelay(sig, x, y)) {
+        // read in a delay line, with a computed index when the delay is variable
+        return (isSigInt(y, &i)) ? 1 : 2;
+    } else if (isSigRDTbl(sig, x, y)) {
+        return 3;
+    } else if (isSigWRTbl(sig, x, y, z, t)) {
+        return 3;
+    } else if (isSigSelect2(sig, x, y, z) || isSigSelect3(sig, x, y, z, t)) {
+        return 2;
+    } else if (isSigIntCast(sig) || isSigFloatCast(sig)) {
+        return 1;
+    } else if (isSigFFun(sig, x, y)) {
+        return 20;
+    } else if (getUserData(sig)) {
+        return xtendedCost((xtended*)getUserData(sig));
+    } else {
+        // projections, UI and foreign values, attach...
+        return 1;
+    }
+}
+
+int sigStoreCost(int delay, bool ring)
+{
+    if (delay == 0) {
+        return 1;
+    } else if (ring) {
+        return 2;
+    } else {
+        // the delayed samples are copied before and after each block
+        return 1 + (2 * delay) / gVecSize;
+    }
+}
@@ -0,0 +1,43 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#ifndef _SIGCOST_
+#define _SIGCOST_
+
+#include "tlib.hh"
+
+/**
+ * Rough cost (in elementary operations per sample) of computing the
+ * top node of a signal, its subsignals being accounted separately.
+ * Used to estimate the cost of the loops when grouping tasks (-g).
+ */
+int sigNodeCost(Tree sig);
+
+/**
+ * Cost of storing one sample of a signal in a vector or a delay line
+ * @param delay the maximum delay of the signal (0 for a simple vector)
+ * @param ring true for a ring buffer (masked index), false for a copy based delay line
+ */
+int sigStoreCost(int delay, bool ring);
+
+#endif
@@ -0,0 +1,268 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <map>
+#include "sigeval.hh"
+#include "signals.hh"
+#include "sigtype.hh"
+#include "sigtyperules.hh"
+#include "binop.hh"
+#include "xtended.hh"
+#include "mathmode.hh"
+
+using namespace std;
+
+extern int gFloatSize;
+
+/**
+ * The math functions are computed in the precision of the generated code :
+ * sinf() and not sin() in single precision
+ */
+static double call (double (*fd)(double), float (*ff)(float), double x)
+{
+	return (gFloatSize == 1) ? double(ff(float(x))) : fd(x);
+}
+
+static double call (double (*fd)(double, double), float (*ff)(float, float), double x, double y)
+{
+	return (gFloatSize == 1) ? double(ff(float(x), float(y))) : fd(x, y);
+}
+
+/**
+ * x^n computed like faustpower<n>(x) in the generated code, every product being rounded
+ */
+static double faustpower (double x, int n)
+{
+	if (n == 0) return 1;
+	if (n == 1) return x;
+	double r = faustpower(x, n/2) * faustpower(x, n - n/2);
+	return (gFloatSize == 1) ? double(float(r)) : r;
+}
+
+/**
+ * True when pow(x,y) is generated as faustpower<y>(x) (see powprim.cpp)
+ */
+static bool isFaustPower (Tree sig)
+{
+	Type t = getCertifiedSigType(sig->branch(1));
+	return (t->nature() == kInt) && (t->variability() == kKonst) && (t->computability() == kComp);
+}
+
+/**
+ * Sample by sample evaluation of a signal. The samples computed for each
+ * subsignal are kept so that delays and recursions only read values that
+ * are already known : the signal is computed in time order and the depth
+ * of the evaluation never depends on the number of samples.
+ */
+class SignalEvaluator
+{
+	map<Tree, vector<Node> >	fHistory;		///< samples already computed for each subsignal
+	map<Tree, vector<Node> >	fTables;		///< content of the constant tables read by the signal
+
+  public:
+
+	bool eval(Tree sig, int t, Node& v);
+
+  private:
+
+	bool compute(Tree sig, int t, Node& v);
+	bool computeXtended(Tree sig, const vector<Node>& args, Node& v);
+	bool readTable(Tree tbl, int idx, Node& v);
+	Node coerce(Tree sig, const Node& v);
+};
+
+/**
+ * The value of a signal at time t (0 for negative times)
+ */
+bool SignalEvaluator::eval(Tree sig, int t, Node& v)
+{
+	if (t < 0) {
+		v = Node(0);
+		return true;
+	}
+	vector<Node>& h = fHistory[sig];
+	while (int(h.size()) <= t) {
+		Node x(0);
+		if (!compute(sig, h.size(), x)) return false;
+		h.push_back(x);
+	}
+	v = h[t];
+	return true;
+}
+
+/**
+ * Convert a value according to the nature of the signal, real values
+ * being rounded like in the generated code
+ */
+Node SignalEvaluator::coerce(Tree sig, const Node& v)
+{
+	if (getCertifiedSigType(sig)->nature() == kInt) {
+		return Node(int(v));
+	} else if (gFloatSize == 1) {
+		return Node(double(float(double(v))));
+	} else {
+		return Node(double(v));
+	}
+}
+
+bool SignalEvaluator::compute(Tree sig, int t, Node& v)
+{
+	int		i, op;
+	double	r;
+	Tree	x, y, z, u, var, le;
+	Node	a(0), b(0), c(0);
+
+	if (isSigInt(sig, &i)) {
+		v = Node(i);
+	} else if (isSigReal(sig, &r)) {
+		v = coerce(sig, Node(r));
+	} else if (isSigWaveform(sig)) {
+		// periodic sequence of constant values
+		if (!eval(sig->branch(t % sig->arity()), t, a)) return false;
+		v = coerce(sig, a);
+	} else if (isSigBinOp(sig, &op, x, y)) {
+		if (!eval(x, t, a) || !eval(y, t, b)) return false;
+		// integer division by zero : let the generated code deal with it
+		if ((op == kRem || (op == kDiv && !isDouble(a) && !isDouble(b))) && int(b) == 0) return false;
+		v = coerce(sig, gBinOpTable[op]->compute(a, b));
+	} else if (isSigFixDelay(sig, x, y)) {
+		if (!eval(y, t, b) || !eval(x, t - int(b), v)) return false;
+	} else if (isSigPrefix(sig, x, y)) {
+		if (!((t == 0) ? eval(x, 0, v) : eval(y, t - 1, v))) return false;
+	} else if (isSigIntCast(sig, x)) {
+		if (!eval(x, t, a)) return false;
+		v = Node(int(a));
+	} else if (isSigFloatCast(sig, x)) {
+		if (!eval(x, t, a)) return false;
+		v = coerce(sig, Node(double(a)));
+	} else if (isSigSelect2(sig, x, y, z)) {
+		if (!eval(x, t, a) || !eval(y, t, b) || !eval(z, t, c)) return false;
+		v = coerce(sig, (int(a) != 0) ? c : b);
+	} else if (isSigSelect3(sig, x, y, z, u)) {
+		Node d(0);
+		if (!eval(x, t, a) || !eval(y, t, b) || !eval(z, t, c) || !eval(u, t, d)) return false;
+		v = coerce(sig, (int(a) == 0) ? b : (int(a) == 1) ? c : d);
+	} else if (isSigAttach(sig, x, y)) {
+		if (!eval(x, t, v)) return false;
+	} else if (isSigRDTbl(sig, x, y)) {
+		if (!eval(y, t, b) || !readTable(x, int(b), v)) return false;
+	} else if (isProj(sig, &i, x) && isRec(x, var, le)) {
+		// the recursive references are delayed, they only read past samples
+		if (!eval(nth(le, i), t, v)) return false;
+	} else if (getUserData(sig)) {
+		vector<Node> args;
+		for (int k = 0; k < sig->arity(); k++) {
+			if (!eval(sig->branch(k), t, a)) return false;
+			args.push_back(a);
+		}
+		if (!computeXtended(sig, args, a)) return false;
+		v = coerce(sig, a);
+	} else {
+		// inputs, user interface, sampling rate, foreign functions, read-write tables...
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Compute a primitive math function like the generated code would
+ */
+bool SignalEvaluator::computeXtended(Tree sig, const vector<Node>& args, Node& v)
+{
+	const char* n = ((xtended*)getUserData(sig))->name();
+	bool power = (strcmp(n, "pow") == 0) && isFaustPower(sig);
+
+	// the approximations of the -mm option are left to the generated code
+	if (isApproximatedFunction(n) && !power) return false;
+	// faustpower<n>() is not defined for negative powers
+	if (power && int(args[1]) < 0) return false;
+
+	if (args.size() == 1) {
+		double x = args[0];
+		if (strcmp(n, "abs") == 0) 				v = isDouble(args[0]) ? Node(fabs(x)) : Node(abs(int(args[0])));
+		else if (strcmp(n, "acos") == 0) 		v = Node(call(acos, acosf, x));
+		else if (strcmp(n, "asin") == 0) 		v = Node(call(asin, asinf, x));
+		else if (strcmp(n, "atan") == 0) 		v = Node(call(atan, atanf, x));
+		else if (strcmp(n, "ceil") == 0) 		v = Node(ceil(x));
+		else if (strcmp(n, "cos") == 0) 		v = Node(call(cos, cosf, x));
+		else if (strcmp(n, "exp") == 0) 		v = Node(call(exp, expf, x));
+		else if (strcmp(n, "floor") == 0) 		v = Node(floor(x));
+		else if (strcmp(n, "log") == 0) 		v = Node(call(log, logf, x));
+		else if (strcmp(n, "log10") == 0) 		v = Node(call(log10, log10f, x));
+		else if (strcmp(n, "rint") == 0) 		v = Node(rint(x));
+		else if (strcmp(n, "sin") == 0) 		v = Node(call(sin, sinf, x));
+		else if (strcmp(n, "sqrt") == 0) 		v = Node(sqrt(x));
+		else if (strcmp(n, "tan") == 0) 		v = Node(call(tan, tanf, x));
+		else return false;
+	} else if (args.size() == 2) {
+		double x = args[0];
+		double y = args[1];
+		bool   ints = !isDouble(args[0]) && !isDouble(args[1]);
+		if (strcmp(n, "atan2") == 0) 			v = Node(call(atan2, atan2f, x, y));
+		else if (strcmp(n, "fmod") == 0) 		v = Node(fmod(x, y));
+		else if (strcmp(n, "max") == 0) 		v = ints ? Node(max(int(args[0]), int(args[1]))) : Node(max(x, y));
+		else if (strcmp(n, "min") == 0) 		v = ints ? Node(min(int(args[0]), int(args[1]))) : Node(min(x, y));
+		else if (power) 						v = Node(faustpower(x, int(args[1])));
+		else if (strcmp(n, "pow") == 0) 		v = Node(call(pow, powf, x, y));
+		else if (strcmp(n, "remainder") == 0) 	v = Node(remainder(x, y));
+		else return false;
+	} else {
+		return false;
+	}
+	// values that can't be written as constants are left to the generated code
+	return isfinite(double(v));
+}
+
+/**
+ * Read a constant table, its content being computed the first time
+ */
+bool SignalEvaluator::readTable(Tree tbl, int idx, Node& v)
+{
+	Tree id, size, content, g;
+	int  n;
+
+	if (!isSigTable(tbl, id, size, content) || !isSigGen(content, g) || !isSigInt(size, &n)) return false;
+
+	map<Tree, vector<Node> >::iterator p = fTables.find(tbl);
+	if (p == fTables.end()) {
+		vector<Node> values;
+		if (!evalConstantSignal(g, n, values)) return false;
+		p = fTables.insert(make_pair(tbl, values)).first;
+	}
+	// out of bounds reads are undefined in the generated code
+	if (idx < 0 || idx >= n) return false;
+	v = p->second[idx];
+	return true;
+}
+
+bool evalConstantSignal(Tree sig, int n, vector<Node>& values)
+{
+	SignalEvaluator E;
+	values.clear();
+	for (int t = 0; t < n; t++) {
+		Node v(0);
+		if (!E.eval(sig, t, v) || !isfinite(double(v))) return false;
+		values.push_back(v);
+	}
+	return true;
+}
@@ -0,0 +1,43 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+
+
+#ifndef _SIGEVAL_
+#define _SIGEVAL_
+
+#include <vector>
+#include "tlib.hh"
+
+/**
+ * Compute at compile time the first n samples of a signal that depends
+ * neither on the inputs, the user interface nor the sampling rate
+ * (typically the content generator of a table). Int signals give int
+ * values, real signals are rounded to the precision of the generated code.
+ * @param sig the signal to evaluate
+ * @param n the number of samples to compute
+ * @param values the computed samples
+ * @return true if the n samples could be computed, false if the signal
+ * uses something that can't be evaluated by the compiler (foreign functions...)
+ */
+bool evalConstantSignal(Tree sig, int n, std::vector<Node>& values);
+
+#endif
@@ -336,6 +336,26 @@ int checkDelayInterval(Type t)
 }		
 	
 
+/**
+ * Check if the intervals of two types prove that the values of the first one
+ * never exceed the values of the second one. The comparison is strict for real
+ * values that could be rounded beyond the bounds of their interval.
+ */
+bool isAlwaysLower(Type t1, Type t2)
+{
+	interval i = t1->getInterval();
+	interval j = t2->getInterval();
+
+	if (!i.valid || !j.valid) {
+		return false;
+	} else if (t1->nature() == kInt && t2->nature() == kInt) {
+		return i.hi <= j.lo;
+	} else {
+		return i.hi < j.lo;
+	}
+}
+
+
 // Donne le nom du type C correspondant �la nature d'un signal
 string cType (Type t)
 {
@@ -266,7 +266,7 @@ class SimpleType : public AudioType
 
 };
 
-inline Type intCast (Type t)	{ return makeSimpleType(kInt, t->variability(), t->computability(), t->vectorability(), t->boolean(), t->getInterval()); }
+inline Type intCast (Type t)	{ return makeSimpleType(kInt, t->variability(), t->computability(), t->vectorability(), t->boolean(), integral(t->getInterval())); }
 inline Type floatCast (Type t)	{ return makeSimpleType(kReal, t->variability(), t->computability(), t->vectorability(), t->boolean(), t->getInterval()); }
 inline Type sampCast (Type t)	{ return makeSimpleType(t->nature(), kSamp, t->computability(), t->vectorability(), t->boolean(), t->getInterval()); }
 inline Type boolCast (Type t)   { return makeSimpleType(kInt, t->variability(), t->computability(), t->vectorability(), kBool, t->getInterval()); }
@@ -452,6 +452,8 @@ Type checkWRTbl(Type tbl, Type wr);	///< verifie que wr est compatible avec le c
 
 int checkDelayInterval(Type t);		///< Check if the interval of t is appropriate for a delay 
 
+bool isAlwaysLower(Type t1, Type t2);	///< Check if the intervals prove that t1 never exceeds t2
+
 
 //--------------------------------------------------
 // conversion de type
@@ -0,0 +1,40 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+/**
+ * @file property.cpp
+ * Counters shared by all the dense property tables.
+ */
+
+#include "property.hh"
+
+unsigned int    PropertyStats::gSlotCount   = 0;
+unsigned int    PropertyStats::gPageCount   = 0;
+unsigned long   PropertyStats::gHits        = 0;
+unsigned long   PropertyStats::gMisses      = 0;
+unsigned long   PropertyStats::gSets        = 0;
+
+void PropertyStats::print(ostream& fout)
+{
+    unsigned long lookups = gHits + gMisses;
+    fout << "properties : " << gSlotCount << " keys, " << gPageCount << " pages, "
+         << gSets << " sets, " << gHits << " hits, " << gMisses << " misses"
+         << " (hit rate : " << ((lookups) ? double(gHits)/lookups : 0.0) << ")" << endl;
+}
@@ -1,140 +1,131 @@
 #ifndef __PROPERTY__
 #define __PROPERTY__
 
+#include <vector>
 #include "tree.hh"
 
-template<class P> class property
+/**
+ * Counters shared by all the properties, printed with -time
+ */
+struct PropertyStats
 {
-    Tree	fKey;
+    static unsigned int     gSlotCount;         ///< number of property keys (slots) allocated so far
+    static unsigned int     gPageCount;         ///< number of pages currently allocated
+    static unsigned long    gHits;              ///< successful get()
+    static unsigned long    gMisses;            ///< unsuccessful get()
+    static unsigned long    gSets;              ///< set()
 
-    P*	access(Tree t)
-    {
-        Tree d = t->getProperty(fKey);
-        return d ? (P*)(d->node().getPointer()) : 0;
-    }
+    static void print(ostream& fout);
+};
 
-public:
+/**
+ * Dense side table associating values of type T to trees. Values are stored unboxed and
+ * indexed by the serial number of the trees, in pages of kPageSize slots allocated on demand.
+ * A lookup is therefore two array accesses instead of a search in the property list of the tree.
+ */
+template<class T> class PropertyTable
+{
+    static const unsigned int kPageBits = 8;
+    static const unsigned int kPageSize = 1 << kPageBits;
+    static const unsigned int kPageMask = kPageSize - 1;
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    struct Page
+    {
+        unsigned int    fPresent[kPageSize/32];     ///< one bit per slot
+        T               fValues[kPageSize];
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
+        Page() { for (unsigned int i = 0; i < kPageSize/32; i++) fPresent[i] = 0; }
+    };
 
-    void set(Tree t, const P& data)
-    {
-        P* p = access(t);
-        if (p) {
-            *p = data;
-        } else {
-            t->setProperty(fKey, tree(Node(new P(data))));
-        }
-    }
+    std::vector<Page*>  fPages;
 
-    bool get(Tree t, P& data)
-    {
-        P* p = access(t);
-        if (p) {
-            data = *p;
-            return true;
-        } else {
-            return false;
-        }
-    }
+    // a table owns its pages and can't be copied
+    PropertyTable(const PropertyTable&);
+    PropertyTable& operator=(const PropertyTable&);
 
-    void clear(Tree t)
+    Page* page(Tree t) const
     {
-        P* p = access(t);
-        if (p) { delete p; }
-        t->clearProperty(fKey);
+        unsigned int p = t->serial() >> kPageBits;
+        return (p < fPages.size()) ? fPages[p] : 0;
     }
-};
 
+ public:
 
-template<> class property<Tree>
-{
-    Tree	fKey;
-
-public:
-
-    property () : fKey(tree(Node(unique("property_")))) {}
-
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
-
-    void set(Tree t, Tree data)
-    {
-        t->setProperty(fKey, data);
-    }
+    PropertyTable() {}
+    ~PropertyTable() { clearAll(); }
 
-    bool get(Tree t, Tree& data)
+    T* find(Tree t)
     {
-        Tree d = t->getProperty(fKey);
-        if (d) {
-            data = d;
-            return true;
+        Page* pg = page(t);
+        unsigned int i = t->serial() & kPageMask;
+        if (pg && (pg->fPresent[i >> 5] & (1U << (i & 31)))) {
+            PropertyStats::gHits++;
+            return &pg->fValues[i];
         } else {
-            return false;
+            PropertyStats::gMisses++;
+            return 0;
         }
     }
 
-    void clear(Tree t)
-    {
-        t->clearProperty(fKey);
-    }
-};
-
-
-template<> class property<int>
-{
-    Tree	fKey;
-
-public:
-
-    property () : fKey(tree(Node(unique("property_")))) {}
-
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
-
-    void set(Tree t, int i)
+    void store(Tree t, const T& data)
     {
-        t->setProperty(fKey, tree(Node(i)));
+        unsigned int p = t->serial() >> kPageBits;
+        unsigned int i = t->serial() & kPageMask;
+        if (p >= fPages.size()) fPages.resize(p + 1, 0);
+        if (fPages[p] == 0) {
+            fPages[p] = new Page();
+            PropertyStats::gPageCount++;
+        }
+        fPages[p]->fPresent[i >> 5] |= (1U << (i & 31));
+        fPages[p]->fValues[i] = data;
+        PropertyStats::gSets++;
     }
 
-    bool get(Tree t, int& i)
+    void erase(Tree t)
     {
-        Tree d = t->getProperty(fKey);
-        if (d) {
-            i = d->node().getInt();
-            return true;
-        } else {
-            return false;
+        Page* pg = page(t);
+        unsigned int i = t->serial() & kPageMask;
+        if (pg) {
+            pg->fPresent[i >> 5] &= ~(1U << (i & 31));
+            pg->fValues[i] = T();
         }
     }
 
-    void clear(Tree t)
+    void clearAll()
     {
-        t->clearProperty(fKey);
+        for (unsigned int p = 0; p < fPages.size(); p++) {
+            if (fPages[p]) {
+                delete fPages[p];
+                PropertyStats::gPageCount--;
+            }
+        }
+        fPages.clear();
     }
 };
 
-
-template<> class property<double>
+/**
+ * A property associates values of type P to trees. Each property is a distinct key
+ * (a slot) with its own dense side table.
+ */
+template<class P> class property
 {
-    Tree	fKey;
+    PropertyTable<P>    fTable;
+    unsigned int        fSlot;
 
 public:
 
-    property () : fKey(tree(Node(unique("property_")))) {}
+    property () : fSlot(PropertyStats::gSlotCount++) {}
 
-    property (const char* keyname) : fKey(tree(Node(keyname))) {}
-
-    void set(Tree t, double x)
+    void set(Tree t, const P& data)
     {
-        t->setProperty(fKey, tree(Node(x)));
+        fTable.store(t, data);
     }
 
-    bool get(Tree t, double& x)
+    bool get(Tree t, P& data)
     {
-        Tree d = t->getProperty(fKey);
-        if (d) {
-            x = d->node().getDouble();
+        P* p = fTable.find(t);
+        if (p) {
+            data = *p;
             return true;
         } else {
             return false;
@@ -143,10 +134,16 @@ public:
 
     void clear(Tree t)
     {
-        t->clearProperty(fKey);
+        fTable.erase(t);
     }
-};
 
+    // remove the property from all trees, as if a new key was used
+    void clearAll()
+    {
+        fTable.clearAll();
+    }
 
+    unsigned int slot() const { return fSlot; }
+};
 
 #endif
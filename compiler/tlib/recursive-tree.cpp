@@ -118,7 +118,7 @@ bool isRef(Tree t, Tree& v)
 // Les references symboliques compte pour zero ce qui veut dire qu'un arbre d'aperture
 // 0 ne compte aucun reference de bruijn libres.
 
-int CTree::calcTreeAperture( const Node& n, const tvec& br  )
+int CTree::calcTreeAperture( const Node& n, int ar, const Tree br[] )
 {
 	int x;
 	if (n == DEBRUIJNREF) {
@@ -136,11 +136,8 @@ int CTree::calcTreeAperture( const Node& n, const tvec& br  )
 	} else {
 		// return max aperture of branches
 		int rc = 0;
-		tvec::const_iterator	b = br.begin();
-		tvec::const_iterator	z = br.end();
-		while (b != z) {
-			if ((*b)->aperture() > rc) rc = (*b)->aperture();
-			++b;
+		for (int i = 0; i < ar; i++) {
+			if (br[i]->aperture() > rc) rc = br[i]->aperture();
 		}
 		return rc;
 	}
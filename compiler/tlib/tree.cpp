@@ -82,6 +82,9 @@ storage of trees.
 #include "tree.hh"
 #include <fstream>
 #include <cstdlib>
+#include <new>
+#include <map>
+#include <algorithm>
 
 Tabber TABBER(1);	
 extern Tabber TABBER;
@@ -96,49 +99,111 @@ static void error(const char * s, Tree t)
 #define ERROR(s,t) { error(s,t); exit(1); }
 
 
-Tree CTree::gHashTable[kHashTableSize];
+//------------------------------------------------------------------------------
+// Tree arena : CTrees and their branches are allocated by bumping a pointer in
+// large chunks of memory that are never released (trees are never deleted)
+//------------------------------------------------------------------------------
+
+static const size_t kArenaChunkSize = 1 << 20;	// 1 MB chunks
+static const size_t kArenaAlign     = 16;
+
+static char*	gArenaPtr 		= 0;			// next free byte in the current chunk
+static char*	gArenaEnd 		= 0;			// end of the current chunk
+static size_t	gArenaChunks 	= 0;			// number of allocated chunks
+static size_t	gArenaReserved	= 0;			// total size of the allocated chunks
+static size_t	gArenaUsed 		= 0;			// total size of the allocated trees
+
+static void* arenaAlloc(size_t size)
+{
+	size = (size + kArenaAlign - 1) & ~(kArenaAlign - 1);
+	if (gArenaPtr + size > gArenaEnd) {
+		size_t chunk = (size > kArenaChunkSize) ? size : kArenaChunkSize;
+		gArenaPtr = (char*)malloc(chunk);
+		if (gArenaPtr == 0) {
+			cerr << "ERROR : out of memory while allocating trees" << endl;
+			exit(1);
+		}
+		gArenaEnd = gArenaPtr + chunk;
+		gArenaChunks++;
+		gArenaReserved += chunk;
+	}
+	void* p = gArenaPtr;
+	gArenaPtr += size;
+	gArenaUsed += size;
+	return p;
+}
+
+//------------------------------------------------------------------------------
+// Hash consing
+//------------------------------------------------------------------------------
+
+// the hash table is allocated on first use, because trees can be created by static initializers
+Tree*			CTree::gHashTable 		= 0;
+unsigned int	CTree::gHashTableBits 	= 0;
+unsigned int	CTree::gHashTableCount 	= 0;
+unsigned int	CTree::gRehashCount 	= 0;
+
 bool CTree::gDetails = false;
 unsigned int  CTree::gVisitTime = 0;
 
 // Constructor : add the tree to the hash table
-CTree::CTree (unsigned int hk, const Node& n, const tvec& br) 
+CTree::CTree (unsigned int hk, const Node& n, int ar, const Tree br[]) 
 	:	fNode(n), 
 		fType(0),
 		fHashKey(hk), 
-	 	fAperture(calcTreeAperture(n,br)), 
+	 	fAperture(calcTreeAperture(n,ar,br)), 
         fVisitTime(0),
-		fBranch(br) 
+		fSerial(gHashTableCount),
+		fArity(ar) 
 { 
+	Tree* b = branchArray();
+	for (int i = 0; i < ar; i++) b[i] = br[i];
+
 	// link dans la hash table
-   	int j = hk % kHashTableSize;
+	unsigned int j = bucket(hk);
 	fNext = gHashTable[j];
 	gHashTable[j] = this;
-
+	gHashTableCount++;
 }
 
-// Destructor : remove the tree form the hash table
-CTree::~CTree () 
+// rehash all the trees in a new table of 2^bits entries
+void CTree::resizeHashTable (unsigned int bits)
 {
-	int		i = fHashKey % kHashTableSize;
-	Tree	t = gHashTable[i];
-	
-	//printf("Delete of "); this->print(); printf("\n");
-	if (t == this) {
-		gHashTable[i] = fNext;
-	} else {
-		Tree p;
-		while (t != this) {
-			p = t;
-			t = t->fNext;
+	Tree*			oldTable = gHashTable;
+	unsigned int	oldSize  = (oldTable) ? (1U << gHashTableBits) : 0;
+
+	gHashTable = (Tree*)calloc(size_t(1) << bits, sizeof(Tree));
+	if (gHashTable == 0) {
+		cerr << "ERROR : out of memory while resizing the tree hash table" << endl;
+		exit(1);
+	}
+	gHashTableBits = bits;
+
+	for (unsigned int i = 0; i < oldSize; i++) {
+		Tree t = oldTable[i];
+		while (t) {
+			Tree next = t->fNext;
+			unsigned int j = bucket(t->fHashKey);
+			t->fNext = gHashTable[j];
+			gHashTable[j] = t;
+			t = next;
 		}
-		p->fNext = fNext;
+	}
+	if (oldTable) {
+		free(oldTable);
+		gRehashCount++;
 	}
 }
 
 // equivalence 
-bool CTree::equiv (const Node& n, const tvec& br) const
+bool CTree::equiv (const Node& n, int ar, const Tree br[]) const
 {
-	return (fNode == n) && (fBranch == br);
+	if ((fNode != n) || (fArity != ar)) return false;
+	const Tree* b = branchArray();
+	for (int i = 0; i < ar; i++) {
+		if (b[i] != br[i]) return false;
+	}
+	return true;
 }
 
 Sym PROCESS = symbol("process"); 
@@ -146,15 +211,20 @@ Sym PROCESS = symbol("process");
 		
 
 
-unsigned int CTree::calcTreeHash( const Node& n, const tvec& br )
+unsigned int CTree::calcTreeHash( const Node& n, int ar, const Tree br[] )
 {
 	unsigned int 			hk = n.type() ^ n.getInt();
-	tvec::const_iterator  b = br.begin();
-	tvec::const_iterator  z = br.end();
+
+	// the low bits of round numbers are all zeros, so we also use the high bits of doubles
+	if (n.type() == kDoubleNode) {
+		double 		x = n.getDouble();
+		uint64_t	bits;
+		memcpy(&bits, &x, sizeof(bits));
+		hk ^= (unsigned int)(bits >> 32);
+	}
 	
-	while (b != z) {
-    	hk = (hk << 1) ^ (hk >> 20) ^ ((*b)->fHashKey);
-		++b;
+	for (int i = 0; i < ar; i++) {
+    	hk ^= br[i]->fHashKey + 0x9e3779b9 + (hk << 6) + (hk >> 2);
 	}
 	return hk;
 }
@@ -162,29 +232,27 @@ unsigned int CTree::calcTreeHash( const Node& n, const tvec& br )
 
 Tree CTree::make(const Node& n, int ar, Tree* tbl)
 {
-	tvec	br(ar); 
-	
-	for (int i=0; i<ar; i++)  br[i] = tbl[i];
-	
-	unsigned int 	hk  = calcTreeHash(n, br);
-	Tree	t = gHashTable[hk % kHashTableSize];
+	if (gHashTable == 0) resizeHashTable(kInitHashTableBits);
+
+	unsigned int 	hk  = calcTreeHash(n, ar, tbl);
+	Tree	t = gHashTable[bucket(hk)];
 	
-	while (t && !t->equiv(n, br)) {
+	while (t && !t->equiv(n, ar, tbl)) {
 		t = t->fNext;
 	}
-	return (t) ? t : new CTree(hk, n, br);
+	if (t) return t;
+
+	// keep the load factor below 1
+	if (gHashTableCount >= (1U << gHashTableBits)) resizeHashTable(gHashTableBits + 1);
+
+	void* mem = arenaAlloc(sizeof(CTree) + ar * sizeof(Tree));
+	return new (mem) CTree(hk, n, ar, tbl);
 }
 
 
 Tree CTree::make(const Node& n, const tvec& br)
 {
-	unsigned int 	hk  = calcTreeHash(n, br);
-	Tree	t = gHashTable[hk % kHashTableSize];
-	
-	while (t && !t->equiv(n, br)) {
-		t = t->fNext;
-	}
-	return (t) ? t : new CTree(hk, n, br);
+	return make(n, (int)br.size(), const_cast<Tree*>(br.empty() ? 0 : &br[0]));
 }
 
 ostream& CTree::print (ostream& fout) const
@@ -210,10 +278,11 @@ ostream& CTree::print (ostream& fout) const
 void CTree::control ()
 {
 	printf("\ngHashTable Content :\n\n");
-	for (int i = 0; i < kHashTableSize; i++) {
+	unsigned int size = (gHashTable) ? (1U << gHashTableBits) : 0;
+	for (unsigned int i = 0; i < size; i++) {
 		Tree t = gHashTable[i];
 		if (t) {
-			printf ("%4d = ", i);
+			printf ("%4u = ", i);
 			while (t) {
 				/*t->print();*/
 				printf(" => ");
@@ -226,6 +295,27 @@ void CTree::control ()
 
 }
 
+void CTree::printStats (ostream& fout)
+{
+	unsigned int size = (gHashTable) ? (1U << gHashTableBits) : 0;
+	unsigned int used = 0, longest = 0;
+
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int len = 0;
+		for (Tree t = gHashTable[i]; t; t = t->fNext) len++;
+		if (len > 0) used++;
+		if (len > longest) longest = len;
+	}
+
+	fout << "tree hash table : " << gHashTableCount << " trees in " << size << " buckets"
+		 << " (load factor : " << ((size) ? double(gHashTableCount)/size : 0.0)
+		 << ", mean chain : " << ((used) ? double(gHashTableCount)/used : 0.0)
+		 << ", longest chain : " << longest
+		 << ", resized " << gRehashCount << " times)" << endl;
+	fout << "tree arena : " << gArenaUsed << " bytes used in " << gArenaChunks << " chunks of "
+		 << gArenaReserved << " bytes" << endl;
+}
+
 // if t has a node of type int, return it otherwise error
 int tree2int (Tree t)
 {
@@ -398,3 +488,88 @@ void CTree::exportProperties(vector<Tree>& keys, vector<Tree>& values)
     }
 }
 
+
+
+//------------------------------------------------------------------------------
+// Structural order of the trees
+//------------------------------------------------------------------------------
+
+static int compareNode(const Node& n1, const Node& n2)
+{
+	if (n1.type() != n2.type()) return (n1.type() < n2.type()) ? -1 : 1;
+
+	switch (n1.type()) {
+		case kIntNode :
+			return (n1.getInt() == n2.getInt()) ? 0 : (n1.getInt() < n2.getInt()) ? -1 : 1;
+		case kDoubleNode :
+			if (n1.getDouble() < n2.getDouble()) return -1;
+			if (n1.getDouble() > n2.getDouble()) return 1;
+			{
+				// -0.0 and 0.0, NaN
+				double x1 = n1.getDouble(), x2 = n2.getDouble();
+				return memcmp(&x1, &x2, sizeof(double));
+			}
+		case kSymNode :
+			return (n1 == n2) ? 0 : strcmp(name(n1.getSym()), name(n2.getSym()));
+		default :
+			return (n1 == n2) ? 0 : (n1.getPointer() < n2.getPointer()) ? -1 : 1;
+	}
+}
+
+// pairs of symbolic recursions being compared, assumed to be equal in their bodies
+static vector<pair<Tree,Tree> > gRecAssumptions;
+
+// results of the comparisons of symbolic recursions made without assumption
+static map<pair<Tree,Tree>, int> gRecComparisons;
+
+static int compareRec(Tree t1, Tree var1, Tree body1, Tree t2, Tree var2, Tree body2)
+{
+	pair<Tree,Tree> p(t1, t2);
+	if (find(gRecAssumptions.begin(), gRecAssumptions.end(), p) != gRecAssumptions.end()) return 0;
+
+	bool toplevel = gRecAssumptions.empty();
+	if (toplevel) {
+		map<pair<Tree,Tree>, int>::iterator r = gRecComparisons.find(p);
+		if (r != gRecComparisons.end()) return r->second;
+	}
+
+	// the variables are fresh names, so the recursions are compared by their definitions,
+	// and only the distinct recursions with the same definitions by their variables
+	gRecAssumptions.push_back(p);
+	int c = compareTree(body1, body2);
+	gRecAssumptions.pop_back();
+	if (c == 0 && toplevel) c = compareTree(var1, var2);
+
+	if (toplevel) {
+		gRecComparisons[p] = c;
+		gRecComparisons[pair<Tree,Tree>(t2, t1)] = -c;
+	}
+	return c;
+}
+
+/**
+ * Compare two trees by their structure : nodes first, then branches from left to right.
+ * The order does not depend on the addresses of the trees or on their creation order, so
+ * the containers of trees ordered this way (sums, metadata) are the same whatever the
+ * trees created before, in particular by the previous files in batch mode. The symbolic
+ * recursions are compared by their definitions, their variables being fresh names.
+ */
+int compareTree(Tree t1, Tree t2)
+{
+	if (t1 == t2) return 0;
+
+	int c = compareNode(t1->node(), t2->node());
+	if (c != 0) return c;
+	if (t1->arity() != t2->arity()) return (t1->arity() < t2->arity()) ? -1 : 1;
+
+	Tree var1, body1, var2, body2;
+	if (isRec(t1, var1, body1) && isRec(t2, var2, body2) && body1 && body2) {
+		return compareRec(t1, var1, body1, t2, var2, body2);
+	}
+
+	for (int i = 0; i < t1->arity(); i++) {
+		c = compareTree(t1->branch(i), t2->branch(i));
+		if (c != 0) return c;
+	}
+	return 0;
+}
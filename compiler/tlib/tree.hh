@@ -103,14 +103,21 @@ typedef vector<Tree>	tvec;
  * a deBruijn representation and progressively build a classical representation such that
  * alpha-equivalent recursive CTrees are necesseraly identical (and therefore shared).
  *
+ * Nodes are interned in a hash table that grows by rehashing as trees are created. The CTree
+ * objects themselves, together with their branches stored inline right after the object, are
+ * allocated from bump-pointer arenas.
+ *
  * WARNING : in the current implementation CTrees are allocated but never deleted
  **/
 
 class CTree
 {
  private:
-	static const int 	kHashTableSize = 2000000; //510511;	///< size of the hash table used for "hash consing"
-	static Tree			gHashTable[kHashTableSize];	///< hash table used for "hash consing"
+	static const unsigned int kInitHashTableBits = 14;		///< log2 of the initial size of the hash table
+	static Tree*		gHashTable;					///< hash table used for "hash consing" (grows by rehashing)
+	static unsigned int	gHashTableBits;				///< log2 of the current size of the hash table
+	static unsigned int	gHashTableCount;			///< number of trees in the hash table (also the next serial number)
+	static unsigned int	gRehashCount;				///< number of times the hash table has been resized
 
  public:
 	static bool			gDetails;					///< Ctree::print() print with more details when true
@@ -125,26 +132,33 @@ class CTree
     unsigned int	fHashKey;			///< the hashtable key
     int             fAperture;			///< how "open" is a tree (synthezised field)
     unsigned int	fVisitTime;			///< keep track of visits
-    tvec            fBranch;			///< the subtrees
+    unsigned int	fSerial;			///< dense creation number of the tree, used to index property tables
+    int             fArity;				///< the number of subtrees, stored inline right after the object
 
-	CTree (unsigned int hk, const Node& n, const tvec& br); 						///< construction is private, uses tree::make instead
+	CTree (unsigned int hk, const Node& n, int ar, const Tree br[]); 		///< construction is private, uses tree::make instead
+	~CTree ();																///< trees are never deleted
 
-	bool 		equiv 				(const Node& n, const tvec& br) const;	///< used to check if an equivalent tree already exists
-	static unsigned int	calcTreeHash 		(const Node& n, const tvec& br);		///< compute the hash key of a tree according to its node and branches
-	static int	calcTreeAperture 	(const Node& n, const tvec& br);		///< compute how open is a tree
+	Tree*		branchArray()				{ return reinterpret_cast<Tree*>(this + 1); }
+	const Tree*	branchArray() const			{ return reinterpret_cast<const Tree*>(this + 1); }
 
- public:
-	~CTree ();
+	bool 		equiv 				(const Node& n, int ar, const Tree br[]) const;	///< used to check if an equivalent tree already exists
+	static unsigned int	calcTreeHash 		(const Node& n, int ar, const Tree br[]);	///< compute the hash key of a tree according to its node and branches
+	static int	calcTreeAperture 	(const Node& n, int ar, const Tree br[]);		///< compute how open is a tree
 
+	static unsigned int	bucket		(unsigned int hk)	{ return (hk * 2654435761U) >> (32 - gHashTableBits); }	///< Fibonacci hashing of a key
+	static void	resizeHashTable		(unsigned int bits);						///< rehash all the trees in a table of 2^bits entries
+
+ public:
 	static Tree make (const Node& n, int ar, Tree br[]);		///< return a new tree or an existing equivalent one
 	static Tree make(const Node& n, const tvec& br);			///< return a new tree or an existing equivalent one
 
  	// Accessors
  	const Node& node() const		{ return fNode; 		}	///< return the content of the tree
- 	int 		arity() const		{ return (int)fBranch.size();}	///< return the number of branches (subtrees) of a tree
-    Tree 		branch(int i) const	{ return fBranch[i];	}	///< return the ith branch (subtree) of a tree
-    const tvec& branches() const	{ return fBranch;	}       ///< return all branches (subtrees) of a tree
+ 	int 		arity() const		{ return fArity;		}	///< return the number of branches (subtrees) of a tree
+    Tree 		branch(int i) const	{ return branchArray()[i]; }	///< return the ith branch (subtree) of a tree
+    tvec        branches() const	{ return tvec(branchArray(), branchArray() + fArity); }	///< return a copy of all branches (subtrees) of a tree
     unsigned int 		hashkey() const		{ return fHashKey; 		}	///< return the hashkey of the tree
+    unsigned int 		serial() const		{ return fSerial; 		}	///< return the dense creation number of the tree
  	int 		aperture() const	{ return fAperture; 	}	///< return how "open" is a tree in terms of free variables
  	void 		setAperture(int a) 	{ fAperture=a; 			}	///< modify the aperture of a tree
 
@@ -152,6 +166,7 @@ class CTree
 	// Print a tree and the hash table (for debugging purposes)
 	ostream& 	print (ostream& fout) const; 					///< print recursively the content of a tree on a stream
 	static void control ();										///< print the hash table content (for debug purpose)
+	static void printStats (ostream& fout);						///< print hash table and arena statistics (-time)
 
 	// type information
 	void		setType(void* t) 	{ fType = t; }
@@ -246,6 +261,14 @@ Tree lift(Tree t); 							////< add 1 to the free de bruijn references of t
 Tree deBruijn2Sym (Tree t);					////< transform a tree from deBruijn to symbolic notation
 void updateAperture (Tree t);				////< update aperture field of a tree in symbolic notation
 
+// structural order
+
+int compareTree(Tree t1, Tree t2);			///< order of the trees by their structure, independent of their addresses
+
+struct treeLess {							///< to order the containers of trees by structure
+	bool operator()(Tree t1, Tree t2) const { return compareTree(t1, t2) < 0; }
+};
+
 //---------------------------------------------------------------------------
 
 class Tabber
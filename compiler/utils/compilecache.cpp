@@ -0,0 +1,235 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+/**
+ * @file compilecache.cpp
+ * Persistent on-disk cache of compilation results.
+ */
+
+#include "compilecache.hh"
+#include "compatibility.hh"
+#include "enrobage.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <fstream>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <dirent.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+using namespace std;
+
+static const char* kCacheMagic = "FAUSTCACHE 1";
+
+//-- options that don't change the generated code and are not part of the key
+
+static bool isIgnoredOption(const char* opt, int& skip)
+{
+    if (!strcmp(opt, "-o") || !strcmp(opt, "-O") || !strcmp(opt, "--output-dir")
+        || !strcmp(opt, "-cache") || !strcmp(opt, "--cache-dir") || !strcmp(opt, "-j") || !strcmp(opt, "--jobs")) {
+        skip = 2;
+        return true;
+    } else if (!strcmp(opt, "-cs") || !strcmp(opt, "--cache-stats") || !strcmp(opt, "-batch") || !strcmp(opt, "--batch")) {
+        skip = 1;
+        return true;
+    } else {
+        skip = 1;
+        return false;
+    }
+}
+
+/**
+ * 64-bits FNV-1a hash of a string, as 16 hexadecimal digits
+ */
+string CompileCache::hashString(const string& s)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < s.size(); i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    char buffer[32];
+    snprintf(buffer, 32, "%016llx", h);
+    return buffer;
+}
+
+bool CompileCache::readFile(const string& path, string& content)
+{
+    if (path == "") return false;
+    ifstream f(path.c_str(), ios::in | ios::binary);
+    if (!f.is_open()) return false;
+    stringstream buffer;
+    buffer << f.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+bool CompileCache::readArchFile(const string& name, string& content)
+{
+    istream* f = open_arch_stream(name.c_str());
+    if (!f) return false;
+    stringstream buffer;
+    buffer << f->rdbuf();
+    content = buffer.str();
+    delete f;
+    return true;
+}
+
+CompileCache::CompileCache(const string& dir, const vector<string>& args, const char* version) : fDir(dir)
+{
+    char    cwd[FAUST_PATH_MAX];
+    string  key = string(version) + "\n" + ((getcwd(cwd, FAUST_PATH_MAX)) ? cwd : "") + "\n";
+    int     skip;
+
+    for (size_t i = 0; i < args.size(); i += skip) {
+        if (!isIgnoredOption(args[i].c_str(), skip)) {
+            key += args[i];
+            key += "\n";
+        }
+    }
+    fKey = hashString(key);
+}
+
+void CompileCache::logAccess(bool hit) const
+{
+    // a single short append is atomic, concurrent compilers can share the log
+    FILE* f = fopen((fDir + "/stats.log").c_str(), "a");
+    if (f) {
+        fputs((hit) ? "H\n" : "M\n", f);
+        fclose(f);
+    }
+}
+
+bool CompileCache::lookup(string& code, string& xml, string& json)
+{
+    string  content;
+    bool    valid = false;
+
+    if (readFile(entryPath(), content)) {
+        istringstream   in(content);
+        string          line;
+        int             ndeps = 0;
+
+        valid = getline(in, line) && (line == kCacheMagic) && (in >> ndeps) && getline(in, line);
+
+        // check that the dependencies are unchanged
+        for (int i = 0; valid && i < ndeps; i++) {
+            string kind, hash, name, data;
+            valid = (in >> kind >> hash) && getline(in, name) && (name.size() > 1);
+            if (valid) {
+                name = name.substr(1);
+                valid = ((kind == "arch") ? readArchFile(name, data) : readFile(name, data))
+                        && (hashString(data) == hash);
+            }
+        }
+
+        // read the code and descriptions
+        string* sections[] = { &code, &xml, &json };
+        for (int i = 0; valid && i < 3; i++) {
+            size_t len;
+            valid = (in >> len) && getline(in, line);
+            if (valid) {
+                sections[i]->resize(len);
+                valid = (len == 0) || in.read(&(*sections[i])[0], len);
+            }
+        }
+    }
+
+    logAccess(valid);
+    return valid;
+}
+
+void CompileCache::store(const string& code, const string& xml, const string& json,
+                         const vector<string>& srcfiles, const vector<string>& archfiles) const
+{
+    stringstream    out;
+    string          data;
+
+    out << kCacheMagic << "\n" << srcfiles.size() + archfiles.size() << "\n";
+    for (size_t i = 0; i < srcfiles.size(); i++) {
+        if (!readFile(srcfiles[i], data)) return;
+        out << "src " << hashString(data) << " " << srcfiles[i] << "\n";
+    }
+    for (size_t i = 0; i < archfiles.size(); i++) {
+        if (!readArchFile(archfiles[i], data)) return;
+        out << "arch " << hashString(data) << " " << archfiles[i] << "\n";
+    }
+    out << code.size() << " cpp\n" << code;
+    out << xml.size() << " xml\n" << xml;
+    out << json.size() << " json\n" << json;
+
+    // write a private temporary file and atomically rename it
+    stringstream tmp;
+    tmp << entryPath() << ".tmp." << getpid();
+    {
+        ofstream f(tmp.str().c_str(), ios::out | ios::binary);
+        if (!f.is_open()) {
+            cerr << "WARNING : can't write in cache directory " << fDir << endl;
+            return;
+        }
+        f << out.str();
+    }
+#ifdef WIN32
+    remove(entryPath().c_str());
+#endif
+    if (rename(tmp.str().c_str(), entryPath().c_str()) != 0) {
+        remove(tmp.str().c_str());
+    }
+}
+
+void CompileCache::printStats(const string& dir, ostream& out)
+{
+    string          log;
+    unsigned long   hits = 0, misses = 0, entries = 0, bytes = 0;
+
+    if (readFile(dir + "/stats.log", log)) {
+        for (size_t i = 0; i < log.size(); i++) {
+            if (log[i] == 'H') hits++;
+            if (log[i] == 'M') misses++;
+        }
+    }
+#ifndef WIN32
+    DIR* d = opendir(dir.c_str());
+    if (d) {
+        struct dirent* e;
+        while ((e = readdir(d))) {
+            string name = e->d_name;
+            struct stat st;
+            if (name.size() > 7 && name.substr(name.size() - 7) == ".fcache"
+                && stat((dir + "/" + name).c_str(), &st) == 0) {
+                entries++;
+                bytes += st.st_size;
+            }
+        }
+        closedir(d);
+    }
+#endif
+    out << "cache " << dir << " : " << entries << " entries, " << bytes << " bytes, "
+        << hits << " hits, " << misses << " misses (hit rate : "
+        << ((hits + misses) ? double(hits)/(hits + misses) : 0.0) << ")" << endl;
+}
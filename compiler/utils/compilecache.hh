@@ -0,0 +1,73 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+	Copyright (C) 2003-2016 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+ 
+#ifndef __COMPILECACHE__
+#define __COMPILECACHE__
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+/**
+ * Persistent on-disk cache of compilation results (option -cache <dir>).
+ *
+ * An entry is keyed by the compiler version, the command line arguments and the
+ * current directory. It records the content hash of every source file (.dsp and
+ * imported .lib) and architecture file used by the compilation, together with
+ * the generated C++ code and the XML and JSON descriptions. An entry is only
+ * reused if all these files still have the same content.
+ *
+ * Entries are written in a temporary file then renamed, and statistics are
+ * appended to a log, so that concurrent compilers can share the same directory.
+ */
+class CompileCache
+{
+    std::string     fDir;       ///< the cache directory
+    std::string     fKey;       ///< the key of the current compilation
+
+    std::string     entryPath() const { return fDir + "/" + fKey + ".fcache"; }
+    void            logAccess(bool hit) const;
+
+ public:
+
+    CompileCache(const std::string& dir, const std::vector<std::string>& args, const char* version);
+
+    /**
+     * Search the cache for a valid entry, and update the statistics.
+     * @return true if the entry exists and all its dependencies are unchanged
+     */
+    bool lookup(std::string& code, std::string& xml, std::string& json);
+
+    /**
+     * Store the result of the current compilation. Does nothing if one of the
+     * dependencies can't be hashed (for instance a file imported from an URL).
+     */
+    void store(const std::string& code, const std::string& xml, const std::string& json,
+               const std::vector<std::string>& srcfiles, const std::vector<std::string>& archfiles) const;
+
+    static void printStats(const std::string& dir, std::ostream& out);
+
+    static std::string hashString(const std::string& s);
+    static bool readFile(const std::string& path, std::string& content);
+    static bool readArchFile(const std::string& name, std::string& content);
+};
+
+#endif
@@ -0,0 +1,14 @@
+// Test of the simplifications driven by the signal intervals :
+// the integer casts, floor and ceil have integer intervals,
+// so that the comparisons on them are not wrongly folded
+
+x = hslider("x", 0.6, 0.5, 0.7, 0.01);
+n = hslider("n", 0, 0, 1, 1) : int;
+
+process = select2(int(x) > 0, 10, 20),
+          select2(floor(x) > 0, 1, 2),
+          select2(ceil(x) < 1, 3, 4),
+          (_ <: select2(n, int(abs(_)*3), int(_*7))),
+          (_ <: select2(int(_*0.4) > 0, 5, 6)),
+          (_ : min(int(x), _*0.5)),
+          (_ : fmod(int(x*10), _+8));
@@ -0,0 +1,218 @@
+#include <libgen.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <ctype.h>
+#include <string>
+#include <map>
+#include <iostream>
+#include <sstream>
+#include <math.h>
+#include <algorithm>
+#include <cfenv>
+#include <cmath>
+#include <cfloat>
+
+#include "faust/gui/console.h"
+#include "faust/dsp/dsp.h"
+#include "faust/gui/FUI.h"
+#include "faust/audio/channels.h"
+
+using std::max;
+using std::min;
+
+#define kFrames 64
+
+using namespace std;
+
+struct Meta: map < const char *, const char *>
+{
+    void declare(const char *key, const char *value)
+    {
+        (*this)[key] = value;
+    }
+};
+
+//----------------------------------------------------------------------------
+//FAUST generated code
+// ----------------------------------------------------------------------------
+
+<<includeIntrinsic>>
+
+<<includeclass>>
+
+#include <vector>
+#include "faust/gui/UI.h"
+
+/******************************************************************************
+    Impulse response of a class generated with the -lanes option. The even
+    lanes receive the impulse, the odd lanes silence, and the controls of all
+    the lanes follow lane 0 : lanes 0 and 2 must give exactly the same output,
+    which is printed as the impulse response of the dsp.
+*******************************************************************************/
+
+// the zones of the controls of one lane
+struct ZoneList : public UI
+{
+    std::vector<FAUSTFLOAT*> fZones;
+
+    void openTabBox(const char* label) {}
+    void openHorizontalBox(const char* label) {}
+    void openVerticalBox(const char* label) {}
+    void closeBox() {}
+    void addButton(const char* label, FAUSTFLOAT* zone) { fZones.push_back(zone); }
+    void addCheckButton(const char* label, FAUSTFLOAT* zone) { fZones.push_back(zone); }
+    void addVerticalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+    void addHorizontalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+    void addNumEntry(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+    void addHorizontalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { fZones.push_back(zone); }
+    void addVerticalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { fZones.push_back(zone); }
+};
+
+// the lanes seen as a single dsp
+struct lanes_test : public dsp
+{
+    mydsp fDSP;
+    int fLanes;
+    int fInputs;
+    int fOutputs;
+    int fTested;                                // lane compared to lane 0 and printed
+    std::vector<ZoneList> fZones;
+    std::vector<FAUSTFLOAT> fSilence;
+    std::vector<std::vector<FAUSTFLOAT> > fBuffers;
+    std::vector<FAUSTFLOAT*> fIns;
+    std::vector<FAUSTFLOAT*> fOuts;
+
+    lanes_test()
+    {
+        fLanes = fDSP.getNumLanes();
+        fInputs = fDSP.getNumInputs()/fLanes;
+        fOutputs = fDSP.getNumOutputs()/fLanes;
+        fTested = (fLanes > 2) ? 2 : 0;
+        fZones.resize(fLanes);
+        for (int v = 0; v < fLanes; v++) fDSP.buildLaneUserInterface(&fZones[v], v);
+        fSilence.resize(kFrames, 0);
+        fBuffers.resize(fLanes*fOutputs, std::vector<FAUSTFLOAT>(kFrames));
+        fIns.resize(fLanes*fInputs);
+        fOuts.resize(fLanes*fOutputs);
+        for (int c = 0; c < fLanes*fOutputs; c++) fOuts[c] = &fBuffers[c][0];
+    }
+
+    int getNumInputs() { return fInputs; }
+    int getNumOutputs() { return fOutputs; }
+    void buildUserInterface(UI* ui_interface) { fDSP.buildLaneUserInterface(ui_interface, 0); }
+    int getSampleRate() { return fDSP.getSampleRate(); }
+    void init(int samplingRate) { fDSP.init(samplingRate); }
+    void instanceInit(int samplingRate) { fDSP.instanceInit(samplingRate); }
+    void instanceConstants(int samplingRate) { fDSP.instanceConstants(samplingRate); }
+    void instanceResetUserInterface() { fDSP.instanceResetUserInterface(); }
+    void instanceClear() { fDSP.instanceClear(); }
+    dsp* clone() { return 0; }
+    void metadata(Meta* m) { fDSP.metadata(m); }
+
+    void compute(int count, FAUSTFLOAT** input, FAUSTFLOAT** output)
+    {
+        for (int v = 1; v < fLanes; v++) {
+            for (size_t k = 0; k < fZones[0].fZones.size(); k++) *fZones[v].fZones[k] = *fZones[0].fZones[k];
+        }
+        for (int v = 0; v < fLanes; v++) {
+            for (int c = 0; c < fInputs; c++) fIns[v*fInputs+c] = (v % 2 == 0) ? input[c] : &fSilence[0];
+        }
+        fDSP.compute(count, &fIns[0], &fOuts[0]);
+        for (int c = 0; c < fOutputs; c++) {
+            for (int i = 0; i < count; i++) {
+                if (fOuts[c][i] != fOuts[fTested*fOutputs+c][i]) {
+                    cerr << "ERROR : lane " << fTested << " differs from lane 0" << std::endl;
+                    exit(1);
+                }
+                output[c][i] = fOuts[fTested*fOutputs+c][i];
+            }
+        }
+    }
+};
+
+lanes_test DSP;
+
+static inline FAUSTFLOAT normalize(FAUSTFLOAT f)
+{
+    if (std::isnan(f)) {
+        cerr << "ERROR : isnan" << std::endl;
+        throw -1;
+    } else if (!std::isfinite(f)) {
+        cerr << "ERROR : !isfinite" << std::endl;
+        throw -1;
+    }
+    return (fabs(f) < FAUSTFLOAT(0.000001) ? FAUSTFLOAT(0.0) : f);
+}
+
+int main(int argc, char* argv[])
+{
+    float fnbsamples;
+    char rcfilename[256];
+  
+    CMDUI* interface = new CMDUI(argc, argv);
+    DSP.buildUserInterface(interface);
+    interface->addOption("-n", &fnbsamples, 16, 0.0, 100000000.0);
+    
+    FUI finterface;
+    snprintf(rcfilename, 255, "%src", argv[0]);
+    
+    DSP.buildUserInterface(&finterface);
+ 
+    // init signal processor and the user interface values
+    DSP.init(44100);
+
+    // modify the UI values according to the command - line options
+    interface->process_command();
+
+    int nins = DSP.getNumInputs();
+    channels ichan(kFrames, nins);
+
+    int nouts = DSP.getNumOutputs();
+    channels ochan(kFrames, nouts);
+
+    int nbsamples = int(fnbsamples);
+    int linenum = 0;
+    int run = 0;
+    
+    // recall saved state
+    finterface.recallState(rcfilename);
+    
+    // print general informations
+    printf("number_of_inputs  : %3d\n", nins);
+    printf("number_of_outputs : %3d\n", nouts);
+    printf("number_of_frames  : %6d\n", nbsamples);
+    
+    // print audio frames
+    int i;
+    try {
+        while (nbsamples > 0) {
+            if (run == 0) {
+                ichan.impulse();
+                finterface.setButtons(true);
+            }
+            if (run == 1) {
+                ichan.zero();
+                finterface.setButtons(false);
+            }
+            int nFrames = min(kFrames, nbsamples);
+            DSP.compute(nFrames, ichan.buffers(), ochan.buffers());
+            run++;
+            for (int i = 0; i < nFrames; i++) {
+                printf("%6d : ", linenum++);
+                for (int c = 0; c < nouts; c++) {
+                    FAUSTFLOAT f = normalize(ochan.buffers()[c][i]);
+                    printf(" %8.6f", f);
+                }
+                printf("\n");
+            }
+            nbsamples -= nFrames;
+        }
+    } catch (...) {
+        cerr << "ERROR in " << argv[1] << " line : " << i << std::endl;
+    }
+    return 0;
+}
@@ -13,5 +13,6 @@ g++ -O3 -std=c++11 filesCompare.cpp -o filesCompare
 cp faust2impulse /usr/local/bin/
 cp faust2valgrind /usr/local/bin/
 cp impulsearch.cpp /usr/local/share/faust/
+cp impulselanes.cpp /usr/local/share/faust/
 cp filesCompare /usr/local/bin/
 
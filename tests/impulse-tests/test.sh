@@ -73,6 +73,11 @@ for f in *.dsp; do
     filesCompare $D/$f.sch.ir ../expected-responses/$f.scal.ir && echo "OK $f scheduler -vs 100 mode" || echo "ERROR $f scheduler -vs 100 mode"
 done
 
+for f in *.dsp; do
+    faust2impulse -double -lanes 4 $f > $D/$f.lanes.ir
+    filesCompare $D/$f.lanes.ir ../expected-responses/$f.scal.ir && echo "OK $f lanes mode" || echo "ERROR $f lanes mode"
+done
+
 
 echo "========================================="
 echo "Test compilation in default mode (float)"
@@ -88,3 +93,21 @@ for f in *.dsp; do
 	filesCompare $D/$f.vec.ir ../expected-responses/$f.scal.ir 0.001 && echo "OK $f vector -lv 0 mode" || echo "ERROR $f vector -lv 0 mode"
 done
 
+# the constant tables computed by the compiler must give exactly the float output
+for f in *.dsp; do
+    faust2impulse $f  -cts 131072  > $D/$f.cts.ir
+	filesCompare $D/$f.cts.ir $D/$f.scal.ir 0 && echo "OK $f const tables mode" || echo "ERROR $f const tables mode"
+done
+
+echo "==============================================================="
+echo "Batch mode : same code as the compilation of each file alone"
+echo "==============================================================="
+
+mkdir $D/batch
+faust -batch -O $D/batch *.dsp 2> /dev/null
+for f in *.dsp; do
+    faust $f -o $D/$f.cpp
+    # the labels of the bargraphs without name are addresses, that change at each compilation
+    cmp -s <(sed -E 's/"0x[0-9a-f]+"/"0x"/' $D/$f.cpp) <(sed -E 's/"0x[0-9a-f]+"/"0x"/' $D/batch/${f%.dsp}.cpp) && echo "OK $f batch mode" || echo "ERROR $f batch mode"
+done
+